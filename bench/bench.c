@@ -0,0 +1,471 @@
+/*
+ * RetroRacer - Benchmark Suite
+ * Micro and macro benchmarks with fixed seeds, results as JSON
+ *
+ * Build and run with "make bench". Each benchmark is calibrated to run
+ * for about BENCH_MIN_US and reports nanoseconds per operation, so two
+ * JSON files from different commits can be diffed directly.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef DREAMCAST
+#include <kos.h>
+#endif
+
+#include "math3d.h"
+#include "fastmath.h"
+#include "render.h"
+#include "track.h"
+#include "game.h"
+#include "rollback.h"
+#include "profiler.h"
+
+/* Target measuring time per benchmark (microseconds) */
+#define BENCH_MIN_US 200000
+
+/* Inputs per micro benchmark, cycled through */
+#define BENCH_INPUTS 256
+
+#define BENCH_SEED 12345u
+
+typedef void (*bench_fn_t)(long iters);
+
+typedef struct {
+    const char *name;
+    double ns_per_op;
+    long ops;
+} bench_result_t;
+
+#define MAX_RESULTS 32
+static bench_result_t results[MAX_RESULTS];
+static int result_count = 0;
+
+/* Keeps results alive so the compiler can't drop the work */
+static volatile float sink;
+
+static uint32_t bench_rng = BENCH_SEED;
+
+static float bench_rand_range(float min, float max) {
+    bench_rng = bench_rng * 1103515245u + 12345u;
+    return min + (float)((bench_rng >> 8) & 0xFFFF) / 65535.0f * (max - min);
+}
+
+/* Time fn, returns its result or NULL if the table is full */
+static bench_result_t *run_bench(const char *name, bench_fn_t fn) {
+    if (result_count == MAX_RESULTS) {
+        fprintf(stderr, "%s: skipped, more than %d benchmarks\n", name, MAX_RESULTS);
+        return NULL;
+    }
+
+    /* Double the batch until it is long enough to time */
+    long iters = 1;
+    uint64_t elapsed;
+    for (;;) {
+        uint64_t start = prof_time_us();
+        fn(iters);
+        elapsed = prof_time_us() - start;
+        if (elapsed >= BENCH_MIN_US / 10 || iters >= (1L << 30)) break;
+        iters *= 2;
+    }
+
+    /* Measured run */
+    iters = (long)((double)iters * BENCH_MIN_US / (elapsed ? elapsed : 1));
+    if (iters < 1) iters = 1;
+    uint64_t start = prof_time_us();
+    fn(iters);
+    elapsed = prof_time_us() - start;
+
+    bench_result_t *r = &results[result_count++];
+    r->name = name;
+    r->ops = iters;
+    r->ns_per_op = (double)elapsed * 1000.0 / iters;
+    fprintf(stderr, "%-28s %12.1f ns/op  (%ld ops)\n", name, r->ns_per_op, iters);
+    return r;
+}
+
+/* ---- math3d ---- */
+
+static mat4_t mats[BENCH_INPUTS];
+static vec3_t vecs[BENCH_INPUTS];
+
+static void setup_math(void) {
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        mat4_t r = mat4_rotate_y(bench_rand_range(-3.14f, 3.14f));
+        mat4_t t = mat4_translate(bench_rand_range(-100, 100), bench_rand_range(-10, 10), bench_rand_range(-100, 100));
+        mats[i] = mat4_multiply(t, r);
+        vecs[i] = vec3_create(bench_rand_range(-50, 50), bench_rand_range(-50, 50), bench_rand_range(-50, 50));
+    }
+}
+
+static void bench_mat4_multiply(long iters) {
+    float acc = 0;
+    for (long i = 0; i < iters; i++) {
+        mat4_t m = mat4_multiply(mats[i & (BENCH_INPUTS - 1)], mats[(i + 1) & (BENCH_INPUTS - 1)]);
+        acc += m.m[12];
+    }
+    sink = acc;
+}
+
+static void bench_mat4_transform_vec3(long iters) {
+    float acc = 0;
+    for (long i = 0; i < iters; i++) {
+        vec3_t v = mat4_transform_vec3(mats[i & (BENCH_INPUTS - 1)], vecs[(i + 7) & (BENCH_INPUTS - 1)]);
+        acc += v.x;
+    }
+    sink = acc;
+}
+
+static void bench_mat4_mul_into(long iters) {
+    float acc = 0;
+    mat4_t m;
+    for (long i = 0; i < iters; i++) {
+        mat4_mul_into(&m, &mats[i & (BENCH_INPUTS - 1)], &mats[(i + 1) & (BENCH_INPUTS - 1)]);
+        acc += m.m[12];
+    }
+    sink = acc;
+}
+
+/* One op is a batch of BENCH_INPUTS points through one matrix */
+static void bench_mat4_transform_points(long iters) {
+    static vec3_t out[BENCH_INPUTS];
+    float acc = 0;
+    for (long i = 0; i < iters; i++) {
+        mat4_transform_points(&mats[i & (BENCH_INPUTS - 1)], vecs, out, BENCH_INPUTS);
+        acc += out[i & (BENCH_INPUTS - 1)].x;
+    }
+    sink = acc;
+}
+
+static void bench_vec3_normalize(long iters) {
+    float acc = 0;
+    for (long i = 0; i < iters; i++) {
+        vec3_t v = vec3_normalize(vecs[i & (BENCH_INPUTS - 1)]);
+        acc += v.y;
+    }
+    sink = acc;
+}
+
+static void bench_fast_sincos(long iters) {
+    float acc = 0;
+    for (long i = 0; i < iters; i++) {
+        float sn, cs;
+        fast_sincos(vecs[i & (BENCH_INPUTS - 1)].x, &sn, &cs);
+        acc += sn + cs;
+    }
+    sink = acc;
+}
+
+static void bench_fast_atan2(long iters) {
+    float acc = 0;
+    for (long i = 0; i < iters; i++) {
+        vec3_t v = vecs[i & (BENCH_INPUTS - 1)];
+        acc += fast_atan2(v.x, v.z);
+    }
+    sink = acc;
+}
+
+/* ---- Track queries ---- */
+
+static track_t *query_track;
+static vec3_t query_pos[BENCH_INPUTS];
+static int query_seg[BENCH_INPUTS];
+static float query_dist[BENCH_INPUTS];
+
+static void setup_track_queries(void) {
+    track_params_t params = track_default_params();
+    params.seed = BENCH_SEED;
+    query_track = track_generate(&params);
+
+    /* Points scattered around the road, like cars drifting off line */
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        vec3_t dir;
+        query_dist[i] = bench_rand_range(0, query_track->total_length);
+        track_get_position(query_track, query_dist[i], &query_pos[i], &dir);
+        query_pos[i].x += bench_rand_range(-8, 8);
+        query_pos[i].z += bench_rand_range(-8, 8);
+        query_seg[i] = track_find_segment(query_track, query_pos[i]);
+    }
+}
+
+static void bench_track_find_segment(long iters) {
+    int acc = 0;
+    for (long i = 0; i < iters; i++) {
+        acc += track_find_segment(query_track, query_pos[i & (BENCH_INPUTS - 1)]);
+    }
+    sink = (float)acc;
+}
+
+static void bench_track_get_position(long iters) {
+    float acc = 0;
+    for (long i = 0; i < iters; i++) {
+        vec3_t pos, dir;
+        track_get_position(query_track, query_dist[i & (BENCH_INPUTS - 1)], &pos, &dir);
+        acc += pos.x;
+    }
+    sink = acc;
+}
+
+static void bench_track_racing_line_at(long iters) {
+    float acc = 0;
+    for (long i = 0; i < iters; i++) {
+        racing_line_sample_t s;
+        track_racing_line_at(query_track, query_dist[i & (BENCH_INPUTS - 1)], &s);
+        acc += s.speed;
+    }
+    sink = acc;
+}
+
+static void bench_track_get_progress(long iters) {
+    float acc = 0;
+    for (long i = 0; i < iters; i++) {
+        int k = i & (BENCH_INPUTS - 1);
+        acc += track_get_progress(query_track, query_pos[k], query_seg[k]);
+    }
+    sink = acc;
+}
+
+/* ---- Track generation ---- */
+
+static int generate_segments;
+
+static void bench_track_generate(long iters) {
+    track_params_t params = track_default_params();
+    params.num_segments = generate_segments;
+    float acc = 0;
+    for (long i = 0; i < iters; i++) {
+        params.seed = BENCH_SEED + (uint32_t)(i & 15);
+        track_t *track = track_generate(&params);
+        acc += track->total_length;
+        track_destroy(track);
+    }
+    sink = acc;
+}
+
+static void bench_track_generate_32(long iters) { generate_segments = 32; bench_track_generate(iters); }
+static void bench_track_generate_128(long iters) { generate_segments = 128; bench_track_generate(iters); }
+static void bench_track_generate_256(long iters) { generate_segments = 256; bench_track_generate(iters); }
+static void bench_track_generate_1024(long iters) { generate_segments = 1024; bench_track_generate(iters); }
+
+/* ---- render_draw_mesh ---- */
+
+static camera_t bench_camera;
+static mesh_t *draw_mesh;
+static mat4_t draw_transforms[BENCH_INPUTS];
+static long vertex_count;
+static float vertex_sum;
+
+#ifndef DREAMCAST
+/* Counting submission stub */
+static void count_vertex(float x, float y, float z, uint32_t color, int last) {
+    (void)color; (void)last;
+    vertex_count++;
+    vertex_sum += x + y + z;
+}
+#endif
+
+static void setup_render(void) {
+    bench_camera.position = vec3_create(0, 3, -8);
+    bench_camera.target = vec3_create(0, 0, 20);
+    bench_camera.up = vec3_create(0, 1, 0);
+    bench_camera.fov = 60.0f;
+    bench_camera.aspect = 640.0f / 480.0f;
+    bench_camera.near_plane = 0.1f;
+    bench_camera.far_plane = 1000.0f;
+    bench_camera.cull_distance = RENDER_DEFAULT_CULL_DISTANCE;
+    camera_update(&bench_camera);
+    render_set_camera(&bench_camera);
+
+    /* Cars ahead of the camera, some crossing the near plane and edges */
+    draw_mesh = mesh_create_vehicle(COLOR_RED);
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        mat4_t t = mat4_translate(bench_rand_range(-15, 15), 0, bench_rand_range(-8.5f, 60));
+        draw_transforms[i] = mat4_multiply(t, mat4_rotate_y(bench_rand_range(-3.14f, 3.14f)));
+    }
+
+#ifndef DREAMCAST
+    render_set_vertex_sink(count_vertex);
+#endif
+}
+
+static void bench_render_draw_mesh(long iters) {
+#ifdef DREAMCAST
+    /* Real submission, a frame is opened every 64 meshes */
+    for (long i = 0; i < iters; i++) {
+        if ((i & 63) == 0) render_begin_frame();
+        render_draw_mesh(draw_mesh, &draw_transforms[i & (BENCH_INPUTS - 1)]);
+        if ((i & 63) == 63 || i == iters - 1) {
+            render_end_frame();
+            render_begin_hud();
+            render_end_hud();
+        }
+    }
+#else
+    for (long i = 0; i < iters; i++) {
+        render_draw_mesh(draw_mesh, &draw_transforms[i & (BENCH_INPUTS - 1)]);
+    }
+#endif
+    sink = vertex_sum;
+}
+
+/* ---- Headless race tick ---- */
+
+static game_t *race;
+
+static void start_bench_race(void) {
+    if (game_sim_start_race(race, MODE_AI_RACE, 3, 7, BENCH_SEED)) {
+        race->state = GAME_STATE_RACING;
+    }
+}
+
+static void setup_race(void) {
+    race = (game_t *)malloc(sizeof(game_t));
+    game_sim_init(race);
+    race->ai_difficulty = AI_MEDIUM;
+    start_bench_race();
+}
+
+static void bench_race_tick(long iters) {
+    for (long i = 0; i < iters; i++) {
+        if (race->state != GAME_STATE_RACING || race->race_time > 300.0f) {
+            start_bench_race();
+        }
+        game_sim_update(race, FRAME_TIME);
+    }
+    sink = race->race_time;
+}
+
+/* ---- Snapshots and rollback ---- */
+
+static sim_snapshot_t snapshot;
+static rollback_t rollback;
+
+static void bench_sim_save(long iters) {
+    for (long i = 0; i < iters; i++) {
+        game_sim_save(race, &snapshot);
+    }
+    sink = snapshot.race_time;
+}
+
+static void bench_sim_restore(long iters) {
+    for (long i = 0; i < iters; i++) {
+        game_sim_restore(race, &snapshot);
+    }
+    sink = race->race_time;
+}
+
+static void setup_rollback(void) {
+    replay_input_t coast = {0, 0, 0};
+
+    start_bench_race();
+    rollback_init(&rollback, race);
+    for (int i = 0; i < ROLLBACK_MAX_TICKS; i++) {
+        rollback_advance(&rollback, &coast);
+    }
+}
+
+/* Worst case correction: the oldest tick in the ring changes every time */
+static void bench_rollback_resim(long iters) {
+    for (long i = 0; i < iters; i++) {
+        replay_input_t in = {(int8_t)((i & 1) ? 64 : -64), 255, 0};
+        rollback_correct(&rollback, rollback.tick - ROLLBACK_MAX_TICKS, &in);
+    }
+    sink = race->race_time;
+}
+
+static void write_json(FILE *out) {
+    fprintf(out, "{\"seed\":%u,\"results\":[\n", BENCH_SEED);
+    for (int i = 0; i < result_count; i++) {
+        fprintf(out, "  {\"name\":\"%s\",\"ns_per_op\":%.2f,\"ops\":%ld}%s\n",
+                results[i].name, results[i].ns_per_op, results[i].ops,
+                i + 1 < result_count ? "," : "");
+    }
+    fprintf(out, "]}\n");
+}
+
+int main(int argc, char *argv[]) {
+    FILE *out = stdout;
+
+#ifndef DREAMCAST
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out = fopen(argv[++i], "w");
+            if (!out) {
+                fprintf(stderr, "Cannot open %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [--out FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+#else
+    (void)argc;
+    (void)argv;
+    pvr_init_defaults();
+#endif
+
+    render_init();
+    track_init();
+
+    setup_math();
+    run_bench("mat4_multiply", bench_mat4_multiply);
+    run_bench("mat4_transform_vec3", bench_mat4_transform_vec3);
+    run_bench("mat4_mul_into", bench_mat4_mul_into);
+    run_bench("mat4_transform_points", bench_mat4_transform_points);
+    run_bench("vec3_normalize", bench_vec3_normalize);
+    run_bench("fast_sincos", bench_fast_sincos);
+    run_bench("fast_atan2", bench_fast_atan2);
+
+    setup_track_queries();
+    run_bench("track_find_segment", bench_track_find_segment);
+    run_bench("track_get_position", bench_track_get_position);
+    run_bench("track_racing_line_at", bench_track_racing_line_at);
+    run_bench("track_get_progress", bench_track_get_progress);
+
+    run_bench("track_generate/32", bench_track_generate_32);
+    run_bench("track_generate/128", bench_track_generate_128);
+    run_bench("track_generate/256", bench_track_generate_256);
+    run_bench("track_generate/1024", bench_track_generate_1024);
+
+    setup_render();
+    vertex_count = 0;
+    bench_result_t *draw = run_bench("render_draw_mesh", bench_render_draw_mesh);
+#ifndef DREAMCAST
+    if (draw) {
+        fprintf(stderr, "%-28s %12.1f vertices/op\n", "", (double)vertex_count / draw->ops);
+    }
+#endif
+
+    setup_race();
+    run_bench("race_tick/8_cars", bench_race_tick);
+
+    game_sim_save(race, &snapshot);
+    run_bench("sim_save", bench_sim_save);
+    run_bench("sim_restore", bench_sim_restore);
+
+    setup_rollback();
+    bench_result_t *resim = run_bench("rollback_resim/8_ticks", bench_rollback_resim);
+    if (resim) {
+        /* Full rollbacks that fit in one 60 Hz frame */
+        double ns = resim->ns_per_op;
+        fprintf(stderr, "%-28s %12.1f resim ticks per %.1f ms frame (%zu byte snapshot)\n", "",
+                ns > 0 ? 1e9 * FRAME_TIME / (ns / ROLLBACK_MAX_TICKS) : 0.0,
+                1000.0 * FRAME_TIME, sizeof(sim_snapshot_t));
+    }
+
+    write_json(out);
+    if (out != stdout) fclose(out);
+
+    track_destroy(query_track);
+    mesh_destroy(draw_mesh);
+    game_sim_shutdown(race);
+    free(race);
+
+#ifdef DREAMCAST
+    arch_exit();
+#endif
+    return 0;
+}
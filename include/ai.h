@@ -7,6 +7,7 @@
 #define AI_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "vehicle.h"
 #include "track.h"
 
@@ -15,9 +16,27 @@ typedef enum {
     AI_EASY,
     AI_MEDIUM,
     AI_HARD,
-    AI_EXPERT
+    AI_EXPERT,
+    AI_DIFFICULTY_COUNT
 } ai_difficulty_t;
 
+/* Vehicles closer than this are avoided */
+#define AI_AVOID_RADIUS 8.0f
+
+/*
+ * Decision LOD: cars within AI_LOD_NEAR_RADIUS of the focus car, or with
+ * another car close by, decide every tick. Further out they decide every
+ * 2nd tick, and every AI_LOD_MAX_INTERVAL ticks beyond AI_LOD_MID_RADIUS,
+ * keeping their last controls in between.
+ */
+#define AI_LOD_NEAR_RADIUS 40.0f
+#define AI_LOD_MID_RADIUS 120.0f
+#define AI_LOD_MAX_INTERVAL 4
+
+/* Decisions per tick for cars outside the near set. A tick count rather
+ * than a time so that races replay the same everywhere. */
+#define AI_LOD_TICK_BUDGET 3
+
 /* AI behavior state */
 typedef enum {
     AI_STATE_RACING,
@@ -35,13 +54,7 @@ typedef struct {
     /* Target following */
     float target_distance;      /* Distance along track to aim for */
     vec3_t target_pos;
-    float look_ahead;           /* How far ahead to look */
-
-    /* Behavior parameters */
-    float aggression;           /* 0-1, how aggressive in overtaking */
-    float skill;                /* 0-1, affects reaction time and precision */
-    float error_rate;           /* How often AI makes mistakes */
-    float speed_factor;         /* Multiplier for max speed */
+    float target_speed;         /* Racing line speed, scaled by speed_factor */
 
     /* State timers */
     float state_timer;
@@ -49,20 +62,50 @@ typedef struct {
 
     /* Randomness */
     float wander;               /* Random steering variation */
-    uint32_t random_seed;
+    uint32_t random_seed;       /* PRNG state */
 } ai_controller_t;
 
+/* Snapshots copy everything after the vehicle back-pointer */
+#define AI_SIM_OFFSET offsetof(ai_controller_t, difficulty)
+#define AI_SIM_BYTES (sizeof(ai_controller_t) - AI_SIM_OFFSET)
+
+/* Time-sliced decision scheduling, one per race */
+typedef struct {
+    uint32_t tick;
+    int budget;                         /* Far decisions per tick */
+    int age[MAX_VEHICLES];              /* Ticks since the last decision */
+    float pending_dt[MAX_VEHICLES];     /* Time since the last decision */
+
+    /* Totals for the profiler report */
+    uint32_t decisions;
+    uint32_t skipped;                   /* Not due, controls carried over */
+    uint32_t deferred;                  /* Due but over budget */
+} ai_scheduler_t;
+
 /* Initialize AI system */
 void ai_init(void);
 
-/* Create AI controller for vehicle */
-ai_controller_t *ai_create(vehicle_t *vehicle, ai_difficulty_t difficulty);
+/* Create AI controller for vehicle, seed drives its random decisions */
+ai_controller_t *ai_create(vehicle_t *vehicle, ai_difficulty_t difficulty, uint32_t seed);
 
 /* Destroy AI controller */
 void ai_destroy(ai_controller_t *ai);
 
-/* Update AI decision making */
-void ai_update(ai_controller_t *ai, track_t *track, vehicle_t *vehicles[], int vehicle_count, float dt);
+/* Update AI decision making, neighbors indexes the vehicles that may be within AI_AVOID_RADIUS */
+void ai_update(ai_controller_t *ai, track_t *track, vehicle_t *vehicles[],
+               const int *neighbors, int neighbor_count, float dt);
+
+/* Reset the scheduler for a new grid, budget <= 0 means AI_LOD_TICK_BUDGET */
+void ai_scheduler_init(ai_scheduler_t *s, int budget);
+
+/* Pick the controllers that decide this tick. neighbor_counts[i] is the
+ * broad phase neighbour count of car i, focus the car everything near is
+ * kept at full rate for (-1 for none). Writes car indexes to due and the
+ * time each should step its decision state by to due_dt, returns how
+ * many. */
+int ai_scheduler_plan(ai_scheduler_t *s, ai_controller_t *controllers[], vehicle_t *vehicles[],
+                      const int *neighbor_counts, int count, int focus, float dt,
+                      int *due, float *due_dt);
 
 /* Set difficulty level */
 void ai_set_difficulty(ai_controller_t *ai, ai_difficulty_t difficulty);
@@ -70,7 +113,7 @@ void ai_set_difficulty(ai_controller_t *ai, ai_difficulty_t difficulty);
 /* Get difficulty name string */
 const char *ai_difficulty_name(ai_difficulty_t difficulty);
 
-/* Utility: Calculate optimal racing line */
+/* Utility: Point on the track's precomputed racing line */
 vec3_t ai_calculate_racing_line(track_t *track, float distance);
 
 /* Utility: Check if path is clear */
@@ -0,0 +1,40 @@
+/*
+ * RetroRacer - Arena Allocator
+ * Bump allocation from one block, released all at once
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Allocations are aligned to a cache line (32 bytes on SH-4) */
+#define ARENA_ALIGN 32
+
+typedef struct {
+    unsigned char *base;
+    size_t capacity;
+    size_t used;
+} arena_t;
+
+/* Round a size up to the arena alignment, for computing reservations */
+#define ARENA_SIZE(n) (((size_t)(n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+/* Start with an empty arena (no memory until arena_reserve) */
+void arena_init(arena_t *arena);
+
+/* Drop all allocations and make sure at least size bytes are available.
+ * The block is only reallocated when it has to grow, so an arena reused
+ * for same-sized work does no heap allocation. Returns 0 on failure. */
+int arena_reserve(arena_t *arena, size_t size);
+
+/* Allocate size bytes, NULL if the reservation is exhausted */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/* Drop all allocations in O(1), keeping the block */
+void arena_reset(arena_t *arena);
+
+/* Free the block */
+void arena_free(arena_t *arena);
+
+#endif /* ARENA_H */
@@ -50,6 +50,17 @@ typedef struct {
     int is_playing;
 } audio_state_t;
 
+/* Music stream counters, for tuning the ring size */
+typedef struct {
+    uint32_t underruns;        /* Polls that found the ring empty */
+    uint32_t underrun_bytes;   /* Silence submitted in their place */
+    uint32_t blocks_read;
+    uint32_t read_errors;
+    uint32_t max_read_us;      /* Slowest single block read */
+    uint32_t low_water_bytes;  /* Least data buffered at any poll */
+    uint32_t polls;
+} audio_stream_stats_t;
+
 /* Initialize audio system */
 void audio_init(void);
 
@@ -59,6 +70,12 @@ void audio_shutdown(void);
 /* Get audio state */
 audio_state_t *audio_get_state(void);
 
+/* Feed the music stream, call once per frame */
+void audio_update(void);
+
+/* Music stream counters (all zero on native builds) */
+const audio_stream_stats_t *audio_get_stream_stats(void);
+
 /* Music control */
 void audio_play_music(music_track_t track);
 void audio_stop_music(void);
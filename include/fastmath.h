@@ -0,0 +1,26 @@
+/*
+ * RetroRacer - Fast Trigonometry
+ * Sine/cosine and atan2 for the per-tick hot paths (vehicle heading,
+ * AI steering). Not for anything that needs libm accuracy.
+ *
+ * Error bounds (absolute, radians or unit-circle):
+ *   fast_sincos  Dreamcast: fsca, angle quantized to 2^-16 of a turn,
+ *                error below 1.0e-4 (mostly the quantization).
+ *                Native: quadrant reduction plus Cephes polynomials,
+ *                error below 2e-7 for |angle| < 1e4.
+ *   fast_atan2   both: Abramowitz & Stegun 4.4.49 on [0, 1] with octant
+ *                reduction, error below 4e-7. Returns 0 for (0, 0).
+ */
+
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+/* sin and cos of an angle in radians */
+void fast_sincos(float angle, float *s, float *c);
+float fast_sin(float angle);
+float fast_cos(float angle);
+
+/* Angle of (x, y) in [-pi, pi], same argument order as atan2f */
+float fast_atan2(float y, float x);
+
+#endif /* FASTMATH_H */
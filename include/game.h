@@ -13,6 +13,12 @@
 #include "ai.h"
 #include "menu.h"
 #include "input.h"
+#include "physics.h"
+#include "replay.h"
+
+/* Target frame rate, the simulation always steps by FRAME_TIME */
+#define TARGET_FPS 60
+#define FRAME_TIME (1.0f / TARGET_FPS)
 
 /* Game states */
 typedef enum {
@@ -34,20 +40,30 @@ typedef struct {
     int finished;
 } grand_prix_t;
 
-/* Main game structure */
+/* Main game structure, one per simulated race */
 typedef struct {
     game_state_t state;
     game_mode_t mode;
+    uint32_t seed;              /* Seed of the current race */
+
+    /* Race setup, read by game_sim_start_race() */
+    input_state_t *input;       /* Player controls, NULL for none */
+    int player_vehicle_class;   /* vehicle_class_t */
+    int ai_difficulty;          /* ai_difficulty_t */
 
     /* Track */
-    track_t *track;
+    track_t *track;             /* Acquired from track_pool */
     track_params_t track_params;
+    track_pool_t track_pool;
 
     /* Vehicles */
     vehicle_t *vehicles[MAX_VEHICLES];
     ai_controller_t *ai_controllers[MAX_VEHICLES];
     int vehicle_count;
     int player_vehicle_index;
+    vehicle_pool_t vehicle_pool;  /* Hot physics state of vehicles[] */
+    broadphase_t broadphase;    /* Rebuilt every racing tick */
+    ai_scheduler_t ai_scheduler;
 
     /* Camera */
     camera_t camera;
@@ -70,11 +86,75 @@ typedef struct {
     float best_time;
     float ghost_progress;
 
+    /* Replay: the player's controls of the current race are recorded into
+     * recording, and come from input_replay instead of input when set */
+    replay_t *recording;
+    const replay_t *input_replay;
+    replay_reader_t input_reader;
+    const replay_input_t *tick_input;   /* Player controls for the next tick, ahead of both */
+
     /* Statistics */
     int races_completed;
     float total_play_time;
 } game_t;
 
+/*
+ * Flat copy of everything game_sim_update() changes during a race. It
+ * holds no pointers, so it can sit in a rollback ring or go over the
+ * wire to a console running the same race. The track is rebuilt from
+ * the seed and is not included, and neither is the replay recording.
+ */
+typedef struct {
+    /* Identifies the race, restore refuses a snapshot of another one */
+    uint32_t seed;
+    int vehicle_count;
+    int player_vehicle_index;
+
+    game_state_t state;
+    float race_time;
+    float countdown_timer;
+    int countdown_value;
+    float best_time;
+    grand_prix_t grand_prix;
+
+    uint8_t pool[VEHICLE_POOL_SIM_BYTES];
+    uint8_t vehicles[MAX_VEHICLES][VEHICLE_SIM_BYTES];
+    uint8_t ai[MAX_VEHICLES][AI_SIM_BYTES];
+    ai_scheduler_t ai_scheduler;
+    replay_reader_t input_reader;
+} sim_snapshot_t;
+
+/*
+ * Simulation context API - reentrant, touches only the given game_t.
+ * Does not render, read input devices or drive the menu, so independent
+ * races can run on separate threads.
+ */
+void game_sim_init(game_t *g);
+void game_sim_shutdown(game_t *g);
+int game_sim_start_race(game_t *g, game_mode_t mode, int num_laps, int num_opponents, uint32_t seed);
+void game_sim_update(game_t *g, float dt);
+void game_sim_end_race(game_t *g);
+
+/* Capture and rewind the race in g. Restore returns 0, leaving g alone,
+ * if the snapshot was taken from a different race. */
+void game_sim_save(const game_t *g, sim_snapshot_t *snap);
+int game_sim_restore(game_t *g, const sim_snapshot_t *snap);
+
+/* Track parameters game_sim_start_race() would use for seed */
+track_params_t game_sim_track_params(game_t *g, uint32_t seed);
+
+/* Start a race on a track already generated from params (for example by a
+ * background job). track must come from g->track_pool, g takes it over.
+ * It and game_sim_start_race() return 0, leaving g in GAME_STATE_MENU,
+ * when there is no track to race on. */
+int game_sim_start_race_on_track(game_t *g, game_mode_t mode, int num_laps, int num_opponents,
+                                 track_t *track, const track_params_t *params);
+
+/*
+ * Interactive game - the functions below drive the single on-screen
+ * game instance together with the menu, input and audio systems.
+ */
+
 /* Initialize game */
 void game_init(void);
 
@@ -84,8 +164,10 @@ void game_shutdown(void);
 /* Main update function */
 void game_update(float dt);
 
-/* Main render function */
-void game_render(void);
+/* Main render function. alpha (0-1) is how far the clock has moved from
+ * the last tick towards the next, cars and camera are drawn that far
+ * between their poses before and after the last tick. */
+void game_render(float alpha);
 
 /* Get game instance */
 game_t *game_get_instance(void);
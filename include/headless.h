@@ -0,0 +1,35 @@
+/*
+ * RetroRacer - Headless Simulation
+ * Batch AI races without rendering, for tuning and regression runs.
+ * Races run on a pool of worker threads, each with its own game_t.
+ */
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Batch run settings */
+typedef struct {
+    int races;              /* Number of races to simulate */
+    uint32_t seed;          /* Seed of the first race, race i uses seed + i */
+    int laps;
+    int vehicles;           /* AI vehicles per race */
+    int difficulty;         /* ai_difficulty_t */
+    float max_time;         /* Race time limit in seconds, unfinished cars are placed by progress */
+    int jobs;               /* Worker threads, each simulates whole races */
+    FILE *out;              /* One JSON object per race */
+    const char *replay;     /* Replay file to re-run instead of a batch, or NULL */
+} headless_config_t;
+
+/* Check argv for --headless */
+int headless_requested(int argc, char *argv[]);
+
+/* Fill config from command line, returns 0 on bad arguments */
+int headless_parse_args(headless_config_t *config, int argc, char *argv[]);
+
+/* Run all races, results are written in race order; returns process exit code */
+int headless_run(headless_config_t *config);
+
+#endif /* HEADLESS_H */
@@ -21,6 +21,7 @@
 #define BTN_Y           (1 << 9)
 #define BTN_X           (1 << 10)
 #define BTN_D           (1 << 11)
+#define BTN_ALL         0xFFF
 
 /* Input state structure */
 typedef struct {
@@ -51,12 +52,15 @@ typedef struct {
 
     /* Controller connected */
     int connected;
+
+    /* prof_time_us() when this state was read */
+    uint64_t sample_time_us;
 } input_state_t;
 
 /* Initialize input system */
 void input_init(void);
 
-/* Update input state (call once per frame) */
+/* Update input state (call right before each simulation tick) */
 void input_update(void);
 
 /* Get input state for player */
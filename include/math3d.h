@@ -8,6 +8,20 @@
 
 #include <math.h>
 
+/*
+ * Backend for the pointer API, chosen at compile time:
+ *   SH-4   ftrv/fipr/fsrra inline assembly (Dreamcast)
+ *   SSE    xmmintrin (native x86)
+ *   scalar portable C, forced with -DMATH3D_SCALAR
+ */
+#if defined(MATH3D_SCALAR)
+/* Portable code only */
+#elif defined(DREAMCAST)
+#define MATH3D_SH4 1
+#elif defined(__SSE__)
+#define MATH3D_SSE 1
+#endif
+
 /* 3D Vector */
 typedef struct {
     float x, y, z;
@@ -47,6 +61,32 @@ mat4_t mat4_perspective(float fov, float aspect, float near, float far);
 mat4_t mat4_look_at(vec3_t eye, vec3_t target, vec3_t up);
 vec3_t mat4_transform_vec3(mat4_t m, vec3_t v);
 
+/*
+ * Pointer API - results go through dst and inputs are read through const
+ * pointers, so no 64-byte matrices are copied on the stack. dst may be
+ * the same object as an input. The value functions above are thin
+ * wrappers over these.
+ */
+void mat4_identity_into(mat4_t *dst);
+void mat4_mul_into(mat4_t *dst, const mat4_t *a, const mat4_t *b);
+void mat4_translate_into(mat4_t *dst, float x, float y, float z);
+void mat4_rotate_y_into(mat4_t *dst, float angle);
+
+/* In place: m = m * T or m = m * R, touching only the affected columns */
+void mat4_translate_by(mat4_t *m, float x, float y, float z);
+void mat4_rotate_x_by(mat4_t *m, float angle);
+void mat4_rotate_y_by(mat4_t *m, float angle);
+void mat4_rotate_z_by(mat4_t *m, float angle);
+void mat4_rotate_y_by_sincos(mat4_t *m, float s, float c);  /* Precomputed sin/cos */
+
+/* Point transform (w = 1, no divide); the batch version loads m once */
+void mat4_transform_into(vec3_t *dst, const mat4_t *m, const vec3_t *v);
+void mat4_transform_points(const mat4_t *m, const vec3_t *in, vec3_t *out, int count);
+
+/* Normalize, zero for near-zero input. On SH-4 this uses the fsrra
+ * estimate (relative error below 2^-21) instead of sqrt and divide. */
+void vec3_normalize_into(vec3_t *dst, const vec3_t *v);
+
 /* Utility */
 float deg_to_rad(float degrees);
 float rad_to_deg(float radians);
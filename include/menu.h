@@ -30,6 +30,13 @@ typedef enum {
     MENU_GRAND_PRIX_STANDINGS
 } menu_screen_t;
 
+/* How the pause or results screen was left, read by game.c */
+typedef enum {
+    MENU_ACTION_NONE,
+    MENU_ACTION_CONTINUE,   /* Resume, continue to the next race */
+    MENU_ACTION_RESTART     /* Same track again */
+} menu_action_t;
+
 /* Menu item */
 typedef struct {
     const char *text;
@@ -65,9 +72,13 @@ menu_state_t *menu_get_state(void);
 /* Update menu with input */
 void menu_update(input_state_t *input, float dt);
 
-/* Render current menu screen */
+/* Render current menu screen as a full frame on a solid background */
 void menu_render(void);
 
+/* Render current menu screen over a dimmed 3D scene, call after the
+ * opaque list has been submitted */
+void menu_render_over_scene(void);
+
 /* Navigation */
 void menu_navigate_up(void);
 void menu_navigate_down(void);
@@ -89,6 +100,9 @@ void menu_show_results(float time, float best_time, int place);
 /* Show Grand Prix standings */
 void menu_show_standings(int *points, int num_racers);
 
+/* Action the last screen closed with, cleared by reading it */
+menu_action_t menu_take_action(void);
+
 /* Get selected game mode */
 game_mode_t menu_get_mode(void);
 
@@ -23,6 +23,35 @@ typedef struct {
     float radius;           /* Sphere collision for quick checks */
 } collision_box_t;
 
+/* Sort-and-sweep broad phase limits */
+#define BROADPHASE_MAX_BODIES 32
+#define BROADPHASE_MAX_PAIRS  ((BROADPHASE_MAX_BODIES * (BROADPHASE_MAX_BODIES - 1)) / 2)
+
+/* Candidate pair found by the broad phase, a < b */
+typedef struct {
+    int a, b;
+} broadphase_pair_t;
+
+/*
+ * Bodies sorted along the world axis (X or Z) with the larger spread. The
+ * order is kept between updates so the insertion sort only fixes the few
+ * cars that swapped places.
+ */
+typedef struct {
+    int count;
+    int axis;                               /* 0 = X, 2 = Z */
+    int order[BROADPHASE_MAX_BODIES];       /* Body indices by ascending axis position */
+
+    /* Pairs within radius on the ground plane, sorted by (a, b) */
+    broadphase_pair_t pairs[BROADPHASE_MAX_PAIRS];
+    int pair_count;
+
+    /* Per-body neighbour lists (ascending), body i owns
+       neighbors[neighbor_start[i] .. neighbor_start[i + 1]) */
+    int neighbor_start[BROADPHASE_MAX_BODIES + 1];
+    int neighbors[BROADPHASE_MAX_PAIRS * 2];
+} broadphase_t;
+
 /* Physics body */
 typedef struct {
     vec3_t position;
@@ -67,6 +96,15 @@ void physics_resolve_collision(physics_body_t *a, physics_body_t *b);
 int physics_raycast_ground(vec3_t origin, vec3_t direction, track_t *track,
                            vec3_t *hit_point, vec3_t *hit_normal);
 
+/* Reset broad phase state */
+void broadphase_init(broadphase_t *bp);
+
+/* Find all body pairs closer than radius in XZ (never misses a pair closer in 3D) */
+void broadphase_update(broadphase_t *bp, const vec3_t *pos, int count, float radius);
+
+/* Neighbour list of one body from the last update */
+const int *broadphase_neighbors(const broadphase_t *bp, int body, int *count);
+
 /* Calculate drag force */
 vec3_t physics_calculate_drag(vec3_t velocity, float coefficient);
 
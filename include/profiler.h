@@ -0,0 +1,96 @@
+/*
+ * RetroRacer - Frame Profiler
+ * Per-subsystem timers with a rolling history and on-screen overlay
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Frames kept for min/avg/max/percentile statistics */
+#define PROF_HISTORY 128
+
+/* Timed sections */
+typedef enum {
+    PROF_INPUT,             /* input_update() */
+    PROF_AI,                /* ai_update() for every controller */
+    PROF_VEHICLE,           /* vehicle_update_all() */
+    PROF_COLLISION,         /* Broad phase and collision response */
+    PROF_TRACK_RENDER,      /* track_render() */
+    PROF_VEHICLE_RENDER,    /* vehicle_render() for every car */
+    PROF_HUD,               /* HUD and overlays */
+    PROF_SCENE_FINISH,      /* pvr_scene_finish() */
+    PROF_FRAME,             /* Whole frame, prof_frame_begin() to prof_frame_end() */
+    PROF_INPUT_LAG,         /* Age of the newest simulated input at prof_frame_end() */
+    PROF_SECTION_COUNT
+} prof_section_t;
+
+/* Per-frame counters, kept in the same history as the timers */
+typedef enum {
+    PROF_COUNT_OP_VERTICES,     /* Opaque list vertices */
+    PROF_COUNT_TR_VERTICES,     /* Translucent list vertices */
+    PROF_COUNT_VERTEX_BYTES,    /* Vertex buffer bytes, both lists and headers */
+    PROF_COUNT_LOD_LEVEL,       /* Budget governor level the frame was drawn at */
+    PROF_COUNTER_COUNT
+} prof_counter_t;
+
+/* Statistics over the history, in microseconds (counters in their own unit) */
+typedef struct {
+    float min_us;
+    float avg_us;
+    float max_us;
+    float p99_us;
+} prof_stats_t;
+
+/* Microsecond clock (TMU on Dreamcast, gettimeofday on native) */
+uint64_t prof_time_us(void);
+
+/* Enable timing. Until then every call below returns immediately, so the
+ * markers in shared code cost nothing in headless runs. */
+void prof_init(void);
+
+/* Frame boundaries, call once per displayed frame */
+void prof_frame_begin(void);
+void prof_frame_end(void);
+
+/* sample_time_us of the input the latest tick ran on, for PROF_INPUT_LAG */
+void prof_input_sampled(uint64_t sample_time_us);
+
+/* Simulation ticks run for the frame about to be drawn. A frame without
+ * a tick repeats the last state (duplicated), ticks beyond the first are
+ * never displayed (dropped). */
+void prof_frame_ticks(int ticks);
+
+typedef struct {
+    uint32_t frames;
+    uint32_t duplicated;
+    uint32_t dropped;
+} prof_pacing_t;
+
+void prof_get_pacing(prof_pacing_t *pacing);
+
+/* Section timers, a section may be entered several times per frame */
+void prof_begin(prof_section_t section);
+void prof_end(prof_section_t section);
+
+/* Statistics for a section over the last PROF_HISTORY frames */
+void prof_get_stats(prof_section_t section, prof_stats_t *stats);
+
+/* Set a counter for the current frame, and read one back like a section */
+void prof_count(prof_counter_t counter, uint32_t value);
+void prof_get_counter_stats(prof_counter_t counter, prof_stats_t *stats);
+
+/* Section name for reports */
+const char *prof_section_name(prof_section_t section);
+
+/* HUD overlay (draw between render_begin_hud and render_end_hud) */
+void prof_toggle_overlay(void);
+int prof_overlay_visible(void);
+void prof_render_overlay(void);
+
+/* Write a statistics table (stdout goes to the dcload console on Dreamcast) */
+void prof_dump(FILE *out);
+
+#endif /* PROFILER_H */
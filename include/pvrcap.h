@@ -0,0 +1,72 @@
+/*
+ * RetroRacer - PVR Command Stream Capture
+ * Records what one frame sends to the PVR, headers and vertices in list
+ * order, so render output can be measured and compared off hardware
+ * with tools/pvrcap.c
+ */
+
+#ifndef PVRCAP_H
+#define PVRCAP_H
+
+#include <stdint.h>
+
+/*
+ * File layout, little endian:
+ *   header   "PVRC", version u8, flags u8, width u16, height u16,
+ *            record bytes u32
+ *   records  a tag byte each, then its payload:
+ *     PVRCAP_BACKGROUND   argb u32
+ *     PVRCAP_LIST_BEGIN   list u8 (render_list_t)
+ *     PVRCAP_HEADER       header u8 (pvrcap_header_t)
+ *     PVRCAP_VERTEX       x, y, z f32, argb u32, u, v f32 under a textured header
+ *     PVRCAP_LIST_END
+ *     PVRCAP_FRAME_END
+ * Vertex tags carry PVRCAP_VERTEX_* flags in the high bits. Coordinates
+ * are screen space as given to the PVR, z is 1/w.
+ */
+#define PVRCAP_MAGIC "PVRC"
+#define PVRCAP_VERSION 1
+#define PVRCAP_FILE_HEADER_BYTES 14
+
+/* File header flags */
+#define PVRCAP_TRUNCATED (1 << 0)       /* Frame outgrew the capture buffer */
+
+enum {
+    PVRCAP_BACKGROUND = 1,
+    PVRCAP_LIST_BEGIN,
+    PVRCAP_HEADER,
+    PVRCAP_VERTEX,
+    PVRCAP_LIST_END,
+    PVRCAP_FRAME_END
+};
+
+#define PVRCAP_TAG_MASK 0x0F
+#define PVRCAP_VERTEX_EOL 0x10          /* Ends a strip */
+#define PVRCAP_VERTEX_CLIPPED 0x20      /* From a triangle cut at the near plane */
+
+/* Polygon headers the renderer compiles */
+typedef enum {
+    PVRCAP_HDR_OPAQUE,      /* Vertex colour, opaque list */
+    PVRCAP_HDR_BLEND,       /* Vertex colour, alpha blended */
+    PVRCAP_HDR_FONT,        /* Glyph atlas, alpha blended, vertices have UVs */
+    PVRCAP_HDR_COUNT
+} pvrcap_header_t;
+
+/* Capture the next whole frame, render_begin_frame() to render_end_hud(),
+ * into path. Returns 0 if there is no memory for the buffer. */
+int pvrcap_request(const char *path);
+
+/* Result of the last capture: 1 written, 0 failed, -1 none finished yet */
+int pvrcap_result(void);
+
+/* Recording, called by the renderer. pvrcap_frame_begin() returns 1
+ * when this frame is captured, the others are only called then. */
+int pvrcap_frame_begin(void);
+void pvrcap_background(uint32_t argb);
+void pvrcap_list_begin(int list);
+void pvrcap_header(pvrcap_header_t header);
+void pvrcap_vertex(float x, float y, float z, float u, float v, uint32_t argb, int flags, int textured);
+void pvrcap_list_end(void);
+void pvrcap_frame_end(void);
+
+#endif /* PVRCAP_H */
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include "math3d.h"
+#include "arena.h"
 
 /* Vertex with position, normal, UV, and color */
 typedef struct {
@@ -26,9 +27,17 @@ typedef struct {
 typedef struct {
     triangle_t *triangles;
     int tri_count;
+    int tri_capacity;
+    int strip_quads;        /* Triangles come in (a,b,c),(a,c,d) quad pairs */
     uint32_t base_color;
 } mesh_t;
 
+/* PVR vertex submission backend */
+typedef enum {
+    RENDER_SUBMIT_PRIM,     /* pvr_prim() copy per vertex */
+    RENDER_SUBMIT_DIRECT    /* Direct render through the store queues */
+} render_submit_mode_t;
+
 /* Camera structure */
 typedef struct {
     vec3_t position;
@@ -38,17 +47,85 @@ typedef struct {
     float aspect;
     float near_plane;
     float far_plane;
+    float cull_distance;    /* Objects farther than this are skipped */
     mat4_t view_matrix;
     mat4_t proj_matrix;
+    mat4_t screen_matrix;   /* View with projection scale folded into x/y */
+
+    /* Frustum side planes, derived in camera_update() */
+    float frustum_tan_x;    /* tan(fov/2) * aspect */
+    float frustum_tan_y;    /* tan(fov/2) */
+    float frustum_norm_x;   /* 1 / sqrt(1 + tan_x^2) */
+    float frustum_norm_y;   /* 1 / sqrt(1 + tan_y^2) */
 } camera_t;
 
+/* Per-frame culling counters, reset by render_begin_frame() */
+typedef struct {
+    int segments_total;
+    int segments_visible;
+    int vehicles_total;
+    int vehicles_visible;
+} render_cull_stats_t;
+
+/* Default cull distance for cameras */
+#define RENDER_DEFAULT_CULL_DISTANCE 400.0f
+
+/* Vertex buffer given to the PVR, shared by both lists. Vertices and
+ * polygon headers are 32 bytes each as sent, the TA stores them no
+ * larger, so the count is a safe upper bound on use. */
+#define RENDER_VERTEX_BUFFER_BYTES (512 * 1024)
+#define RENDER_VERTEX_BYTES 32
+
+typedef enum {
+    RENDER_LIST_OPAQUE,         /* 3D scene */
+    RENDER_LIST_TRANSLUCENT,    /* HUD, ghost and overlays */
+    RENDER_LIST_COUNT
+} render_list_t;
+
+/* Per-frame vertex buffer use, reset by render_begin_frame() */
+typedef struct {
+    int vertices[RENDER_LIST_COUNT];
+    int headers[RENDER_LIST_COUNT];
+    int bytes[RENDER_LIST_COUNT];
+} render_vertex_stats_t;
+
+/*
+ * Level of detail picked by the vertex budget governor. Each frame that
+ * ends above the high water mark of the budget steps one level down,
+ * a run of frames well under it steps back up.
+ */
+#define RENDER_LOD_LEVELS 5
+
+typedef struct {
+    int level;                  /* 0 is full detail */
+    float distance_scale;       /* Applied to camera cull distances */
+    float border_distance;      /* Segments farther away skip their border strips */
+    float impostor_distance;    /* Cars farther away draw as a single quad */
+} render_lod_t;
+
 /* Initialize rendering system */
 void render_init(void);
 
+/* Block until the PVR can take the next frame. render_begin_frame() does
+ * this itself unless it was already done for the frame, calling it first
+ * lets input be sampled after the wait instead of before. */
+void render_wait_ready(void);
+
 /* Begin/end frame */
 void render_begin_frame(void);
 void render_end_frame(void);
 
+/* Select submission backend (takes effect at the next list) */
+void render_set_submit_mode(render_submit_mode_t mode);
+render_submit_mode_t render_get_submit_mode(void);
+
+#ifndef DREAMCAST
+/* Native builds have no PVR; a sink receives every screen-space vertex
+ * instead (NULL drops them). Used by benchmarks and tools. */
+typedef void (*render_vertex_sink_t)(float x, float y, float z, uint32_t color, int last);
+void render_set_vertex_sink(render_vertex_sink_t sink);
+#endif
+
 /* Clear screen */
 void render_clear(uint32_t color);
 
@@ -59,7 +136,29 @@ void render_set_camera(camera_t *cam);
 void camera_update(camera_t *cam);
 
 /* Draw mesh with transformation */
-void render_draw_mesh(mesh_t *mesh, mat4_t transform);
+void render_draw_mesh(mesh_t *mesh, const mat4_t *transform);
+
+/* Draw mesh whose vertices are already in world space (camera transform only) */
+void render_draw_mesh_world(mesh_t *mesh);
+
+/* Draw count triangles of a world-space mesh starting at first */
+void render_draw_mesh_world_range(mesh_t *mesh, int first, int count);
+
+/* Test bounding sphere against current camera frustum and cull distance */
+int render_sphere_visible(vec3_t center, float radius);
+
+/* Get culling counters for the current frame */
+render_cull_stats_t *render_get_cull_stats(void);
+
+/* Vertex buffer counters for the current frame, complete after render_end_hud() */
+const render_vertex_stats_t *render_get_vertex_stats(void);
+
+/* Detail for the current frame */
+const render_lod_t *render_get_lod(void);
+
+/* Bytes the governor keeps frames under (0 restores the whole buffer) */
+void render_set_vertex_budget(int bytes);
+int render_get_vertex_budget(void);
 
 /* Draw a single triangle */
 void render_draw_triangle(vertex_t *v0, vertex_t *v1, vertex_t *v2);
@@ -78,14 +177,54 @@ void render_draw_sky_background(uint32_t color);
 /* Draw 2D rectangle on screen (must be in HUD mode) */
 void render_draw_rect_2d(int x, int y, int w, int h, uint32_t color);
 
-/* Draw text on screen (must be in HUD mode) */
+/* Draw text on screen (must be in HUD mode), one textured quad per glyph */
 void render_draw_text(int x, int y, uint32_t color, const char *text);
 
+/*
+ * Cached HUD string. Callers re-format text only when
+ * render_text_stale() reports that the displayed values changed.
+ */
+#define RENDER_TEXT_LEN 48
+
+typedef struct {
+    int key[4];
+    int valid;
+    char text[RENDER_TEXT_LEN];
+} render_text_t;
+
+/* Store the keys, returns 1 when they differ from the last call (or on first use) */
+int render_text_stale(render_text_t *t, int k0, int k1, int k2, int k3);
+
+/* Vehicle body box, origin at the middle of its base */
+#define VEHICLE_MESH_WIDTH 0.8f
+#define VEHICLE_MESH_HEIGHT 0.4f
+#define VEHICLE_MESH_LENGTH 1.5f
+
 /* Create basic meshes */
 mesh_t *mesh_create_cube(float size, uint32_t color);
 mesh_t *mesh_create_vehicle(uint32_t color);
+
+/* One upright quad in the XY plane, unit width and the body's height,
+ * facing +z. Stands in for the body at a distance. */
+mesh_t *mesh_create_vehicle_impostor(uint32_t color);
 mesh_t *mesh_create_track_segment(float width, float length, uint32_t color);
 
+/* Create empty mesh with room for max_triangles (for baked geometry) */
+mesh_t *mesh_create_static(int max_triangles);
+
+/* Arena-backed versions of the above, NULL when the arena is full.
+ * These meshes are released with the arena, never with mesh_destroy(). */
+#define MESH_ARENA_SIZE(max_triangles) \
+    (ARENA_SIZE(sizeof(mesh_t)) + ARENA_SIZE(sizeof(triangle_t) * (size_t)(max_triangles)))
+mesh_t *mesh_create_track_segment_in(arena_t *arena, float width, float length, uint32_t color);
+mesh_t *mesh_create_static_in(arena_t *arena, int max_triangles);
+
+/* Append src transformed by transform to dst, returns first new triangle index */
+int mesh_append_transformed(mesh_t *dst, mesh_t *src, const mat4_t *transform);
+
+/* Append a flat quad in the XZ plane, returns first new triangle index */
+int mesh_append_quad(mesh_t *dst, vec3_t pos, float width, float height, uint32_t color);
+
 /* Free mesh memory */
 void mesh_destroy(mesh_t *mesh);
 
@@ -0,0 +1,122 @@
+/*
+ * RetroRacer - Replay and Ghost System
+ * Compact race recordings: quantized player inputs for exact replays and
+ * delta-encoded pose keyframes for ghost cars
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include "math3d.h"
+#include "vehicle.h"
+
+/* Pose keyframe every REPLAY_KEYFRAME_TICKS simulation ticks */
+#define REPLAY_KEYFRAME_TICKS 10
+#define REPLAY_POS_SCALE 16.0f      /* 1/16 m */
+#define REPLAY_HEADING_STEPS 4096   /* Per full turn */
+
+/* Stream capacities. A 3 lap time trial needs about 2 KB of poses, well
+ * inside a ghost save of a few VMU blocks. */
+#define REPLAY_POSE_BYTES 4096
+#define REPLAY_INPUT_BYTES 16384
+
+/* Largest encoded replay: header, both streams and checksum */
+#define REPLAY_HEADER_BYTES 32
+#define REPLAY_ENCODED_MAX (REPLAY_HEADER_BYTES + REPLAY_POSE_BYTES + REPLAY_INPUT_BYTES + 4)
+
+/* replay_t.flags */
+#define REPLAY_HAS_INPUTS     (1 << 0)  /* Input stream present */
+#define REPLAY_POSES_FULL     (1 << 1)  /* Pose stream ran out of room */
+#define REPLAY_INPUTS_FULL    (1 << 2)  /* Input stream ran out of room */
+
+/* Player controls for one tick as they are applied to the car */
+typedef struct {
+    int8_t steering;        /* -127..127 */
+    uint8_t throttle;       /* 0..255 */
+    uint8_t brake;          /* 0..255 */
+} replay_input_t;
+
+/* Everything needed to start the same race again */
+typedef struct {
+    uint32_t seed;
+    uint8_t mode;           /* game_mode_t */
+    uint8_t num_laps;
+    uint8_t num_opponents;
+    uint8_t vehicle_class;  /* Player's vehicle_class_t */
+    uint8_t ai_difficulty;  /* ai_difficulty_t, also picks the track params */
+} replay_setup_t;
+
+/* A recording. Keyframes and inputs are variable length byte streams,
+ * the recorder state at the end continues them. */
+typedef struct {
+    replay_setup_t setup;
+    uint32_t ticks;         /* Ticks recorded */
+    float finish_time;      /* Player's finish time, negative if unfinished */
+    uint32_t flags;
+
+    uint8_t poses[REPLAY_POSE_BYTES];
+    int pose_len;
+    int pose_count;
+
+    uint8_t inputs[REPLAY_INPUT_BYTES];
+    int input_len;
+
+    /* Recorder state */
+    replay_input_t last_input;
+    int repeat;             /* Ticks of last_input not yet written */
+    int32_t pose_last[4];
+    int32_t pose_delta[4];
+} replay_t;
+
+/* Reads the input stream back one tick at a time */
+typedef struct {
+    int offset;
+    int repeat;
+    replay_input_t current;
+} replay_reader_t;
+
+/* Plays the pose stream back, time only moves forward between resets */
+typedef struct {
+    int offset;
+    int index;              /* Keyframe held in key[1] */
+    int32_t key[2][4];      /* Quantized x, y, z, heading */
+    int32_t delta[4];
+} replay_ghost_t;
+
+/* Quantize controls, the game applies the result so replays match exactly */
+replay_input_t replay_quantize_input(float steering, float throttle, float brake);
+void replay_apply_input(const replay_input_t *in, vehicle_t *vehicle);
+
+/* Recording */
+void replay_begin(replay_t *r, const replay_setup_t *setup);
+void replay_record_tick(replay_t *r, const replay_input_t *in, vec3_t pos, float heading);
+void replay_finish(replay_t *r, float finish_time);
+
+/* Input playback, past the end of the stream controls are released */
+void replay_reader_init(replay_reader_t *reader);
+void replay_read_input(const replay_t *r, replay_reader_t *reader, replay_input_t *out);
+
+/* Ghost playback: pose at race time t, interpolated between keyframes.
+ * Returns 0 when the replay has no poses. */
+void replay_ghost_init(replay_ghost_t *ghost);
+int replay_ghost_sample(const replay_t *r, replay_ghost_t *ghost, float t, vec3_t *pos, float *heading);
+
+/* Serialize, the input stream is left out unless include_inputs.
+ * Returns bytes written, 0 if buf is too small. */
+int replay_encode(const replay_t *r, int include_inputs, uint8_t *buf, int cap);
+
+/* Parse an encoded replay, returns 0 if it is malformed */
+int replay_decode(replay_t *r, const uint8_t *buf, int len);
+
+/* Files (stdio), returns 0 on failure */
+int replay_save(const replay_t *r, int include_inputs, const char *path);
+int replay_load(replay_t *r, const char *path);
+
+#ifdef DREAMCAST
+/* Ghost save on the first VMU, poses only */
+int replay_save_vmu(const replay_t *r);
+int replay_load_vmu(replay_t *r);
+#endif
+
+#endif /* REPLAY_H */
@@ -0,0 +1,44 @@
+/*
+ * RetroRacer - Rollback
+ * Ring of simulation snapshots for rollback netplay: the race runs ahead
+ * on predicted controls and is resimulated when the real ones arrive late
+ */
+
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <stdint.h>
+#include "game.h"
+#include "replay.h"
+
+/* Furthest back, in ticks, a correction can land. At 60 Hz this covers
+ * about 130 ms of input delay. */
+#define ROLLBACK_MAX_TICKS 8
+
+typedef struct {
+    game_t *game;
+    uint32_t tick;                                  /* Ticks simulated */
+
+    /* Slot t % ROLLBACK_MAX_TICKS holds the state before tick t and the
+     * player controls it ran with */
+    sim_snapshot_t snapshots[ROLLBACK_MAX_TICKS];
+    replay_input_t inputs[ROLLBACK_MAX_TICKS];
+
+    /* Statistics */
+    uint32_t rollbacks;
+    uint32_t resim_ticks;
+} rollback_t;
+
+/* Start tracking g at tick 0. Recording is not rolled back, so leave
+ * g->recording NULL while a rollback_t drives the race. */
+void rollback_init(rollback_t *rb, game_t *g);
+
+/* Snapshot, then run one fixed timestep with the given player controls */
+void rollback_advance(rollback_t *rb, const replay_input_t *controls);
+
+/* The controls for an earlier tick were different: rewind to it and
+ * resimulate up to the present. Returns the ticks resimulated, 0 when
+ * nothing changed and -1 when the tick is outside the ring. */
+int rollback_correct(rollback_t *rb, uint32_t tick, const replay_input_t *controls);
+
+#endif /* ROLLBACK_H */
@@ -9,11 +9,34 @@
 #include <stdint.h>
 #include "math3d.h"
 #include "render.h"
+#include "arena.h"
 
-/* Maximum track segments */
-#define MAX_TRACK_SEGMENTS 256
+/* Maximum track segments. Segments are sized to the track in its arena,
+ * the limit only bounds the grid's 16 bit indices and the arena size. */
+#define MAX_TRACK_SEGMENTS 4096
 #define MAX_CHECKPOINTS 32
 
+/* Render geometry pool: segments near the camera are baked into one of
+ * TRACK_STREAM_SLOTS slots, so its size doesn't depend on track length */
+#define TRACK_STREAM_SLOTS 128
+#define TRACK_SEGMENT_TRIS 6        /* Road and two borders */
+#define TRACK_SEGMENT_ROAD_TRIS 2   /* Road comes first in a slot */
+#define TRACK_STREAM_MARGIN 100.0f  /* Baked this far past the cull distance */
+#define TRACK_STREAM_STEP 10.0f     /* Camera movement before the window is updated */
+
+/* Tracks kept by a track_pool_t (current race plus one being prepared) */
+#define TRACK_POOL_SIZE 2
+
+/* Spatial index grid (cells per axis, upper bound) */
+#define TRACK_GRID_DIM 32
+#define TRACK_GRID_CELLS (TRACK_GRID_DIM * TRACK_GRID_DIM)
+
+/* Racing line table: one sample every RACING_LINE_SPACING metres of
+ * centreline, at most RACING_LINE_MAX_SAMPLES (longer tracks space
+ * their samples further apart) */
+#define RACING_LINE_SPACING 2.0f
+#define RACING_LINE_MAX_SAMPLES 4096
+
 /* Track segment type */
 typedef enum {
     SEGMENT_STRAIGHT,
@@ -29,13 +52,14 @@ typedef struct {
     vec3_t start_pos;
     vec3_t end_pos;
     vec3_t direction;
+    vec3_t center;          /* Midpoint, used for nearest-segment queries */
     float width;
     float length;
     float curve_angle;      /* For curved segments */
     float elevation_change; /* For hills */
-    mesh_t *mesh;
-    mesh_t *border_left;
-    mesh_t *border_right;
+    int slot;               /* Geometry pool slot, -1 when not resident */
+    vec3_t bound_center;    /* Bounding sphere of the segment's geometry */
+    float bound_radius;
 } track_segment_t;
 
 /* Checkpoint for lap timing */
@@ -47,19 +71,72 @@ typedef struct {
     int passed;
 } checkpoint_t;
 
+/* Racing line sample. offset is measured from the centreline toward the
+ * inside of a turn that increases heading (a right curve). */
+typedef struct {
+    float x, y, z;
+    float heading;          /* Yaw of the line, same convention as rotation_y */
+    float curvature;        /* Signed, 1/m, positive turns right */
+    float offset;           /* Lateral offset from the centreline, m */
+    float speed;            /* Target speed with braking folded in, m/s */
+} racing_line_sample_t;
+
+/* Uniform XZ grid over segment midpoints, built once per track */
+typedef struct {
+    float min_x, min_z;
+    float max_x, max_z;
+    float cell_size;
+    float inv_cell_size;
+    int cols, rows;
+    uint16_t cell_start[TRACK_GRID_CELLS + 1];  /* Offsets into items */
+    uint16_t *items;                            /* Segment indices by cell */
+} track_grid_t;
+
+/* Baked geometry of the segments around the camera. Slot s holds
+ * TRACK_SEGMENT_TRIS triangles from s * TRACK_SEGMENT_TRIS, the start
+ * line sits after the last slot. */
+typedef struct {
+    mesh_t *mesh;
+    int slot_count;         /* Up to TRACK_STREAM_SLOTS, short tracks need fewer */
+    int slot_segment[TRACK_STREAM_SLOTS];   /* -1 when free */
+    mesh_t *road[2];        /* Unit road quads in the two shades */
+    mesh_t *border;         /* Unit border quad */
+    int start_line_first;
+    float max_bound_radius; /* Largest segment bound_radius */
+    vec3_t center;          /* Camera position at the last update */
+    int valid;              /* center is set */
+    uint32_t baked;         /* Segments baked since generation */
+} track_stream_t;
+
 /* Complete track structure */
 typedef struct {
-    track_segment_t segments[MAX_TRACK_SEGMENTS];
+    track_segment_t *segments;  /* segment_count entries, in the arena */
     int segment_count;
     checkpoint_t checkpoints[MAX_CHECKPOINTS];
     int checkpoint_count;
     vec3_t start_position;
     vec3_t start_direction;
     float total_length;
+    float *segment_distance;    /* Distance at each segment start, plus the total */
     uint32_t seed;          /* For procedural regeneration */
     char name[32];
+    track_grid_t grid;
+    track_stream_t stream;
+    racing_line_sample_t *racing_line;  /* racing_line_count samples, in the arena */
+    int racing_line_count;
+    int racing_line_closed;             /* Last sample joins the first */
+    float racing_line_inv_spacing;
+    arena_t arena;          /* Holds every array and mesh above, kept across regeneration */
 } track_t;
 
+/* Reusable track storage. Released tracks keep their track_t and arena,
+ * so regenerating into them does no heap allocation once warmed up.
+ * Not locked: acquire and release from one thread. */
+typedef struct {
+    track_t *tracks[TRACK_POOL_SIZE];   /* Allocated on first acquire */
+    int in_use[TRACK_POOL_SIZE];
+} track_pool_t;
+
 /* Track generation parameters */
 typedef struct {
     uint32_t seed;
@@ -70,32 +147,73 @@ typedef struct {
     float max_curve_angle;
     float max_elevation;
     int difficulty;         /* 1-5, affects complexity */
+    int closed_loop;        /* Circuit back to the start that never crosses itself */
 } track_params_t;
 
 /* Initialize track system */
 void track_init(void);
 
-/* Generate a new procedural track */
+/* Generate a new procedural track, reentrant (all randomness comes from params->seed) */
 track_t *track_generate(track_params_t *params);
 
-/* Get default parameters */
+/* Generate into existing track storage (from track_pool_acquire or
+ * track_generate), reusing its arena. Returns 0 if out of memory. */
+int track_generate_into(track_t *track, track_params_t *params);
+
+/* Get default parameters (seed is left at 0, set it before generating) */
 track_params_t track_default_params(void);
 
 /* Free track memory */
 void track_destroy(track_t *track);
 
-/* Render entire track */
+/* Track pool, a zeroed pool is also valid */
+void track_pool_init(track_pool_t *pool);
+track_t *track_pool_acquire(track_pool_t *pool);    /* NULL if all in use */
+void track_pool_release(track_pool_t *pool, track_t *track);
+void track_pool_shutdown(track_pool_t *pool);       /* Frees every track */
+
+/* Render the track. Bakes segments coming within the streaming radius of
+ * the camera and releases the ones that left it first. */
 void track_render(track_t *track, camera_t *cam);
 
+/* Update the resident geometry for a camera at pos, track_render() does
+ * this itself */
+void track_stream_update(track_t *track, vec3_t pos, float cull_distance);
+
 /* Get track position and direction at distance */
 void track_get_position(track_t *track, float distance, vec3_t *pos, vec3_t *dir);
 
+/* Same as track_get_position(), starting the search from *cursor.
+ * *cursor is updated to the segment found, so callers that move forward
+ * a little each frame get their answer in O(1). */
+void track_get_position_cached(track_t *track, float distance, int *cursor, vec3_t *pos, vec3_t *dir);
+
+/* Batch lookup of count distances. dir may be NULL.
+ * Each lookup starts from the previous result, so ascending distances
+ * (AI look-ahead, sampling) mostly skip the binary search. */
+void track_get_positions(track_t *track, const float *distances, int count, vec3_t *pos, vec3_t *dir);
+
+/* Racing line at a distance along the track, interpolated between the
+ * two nearest samples. O(1), no segment search. */
+void track_racing_line_at(track_t *track, float distance, racing_line_sample_t *out);
+
+/* Segment containing a (wrapped) distance along the track, hint may be -1 */
+int track_segment_at_distance(track_t *track, float distance, int hint);
+
 /* Find which segment a position is on */
 int track_find_segment(track_t *track, vec3_t pos);
 
+/* Find segment using a hint (last known segment, or -1).
+ * Returns the same result as track_find_segment(), but checks the hint
+ * and its neighbours first so the grid search usually ends in one cell. */
+int track_find_segment_near(track_t *track, vec3_t pos, int hint);
+
 /* Check if position is on track */
 int track_is_on_surface(track_t *track, vec3_t pos, float *height);
 
+/* Check if position is on a known segment (from track_find_segment) */
+int track_is_on_segment(track_t *track, int seg_idx, vec3_t pos, float *height);
+
 /* Check checkpoint collision */
 int track_check_checkpoint(track_t *track, vec3_t pos, int last_checkpoint);
 
@@ -7,6 +7,7 @@
 #define VEHICLE_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "math3d.h"
 #include "render.h"
 #include "track.h"
@@ -14,37 +15,67 @@
 /* Maximum vehicles in a race */
 #define MAX_VEHICLES 8
 
+/* Lap times kept per vehicle */
+#define VEHICLE_MAX_LAPS 16
+
 /* Vehicle type/class */
 typedef enum {
     VEHICLE_STANDARD,
     VEHICLE_SPEED,
     VEHICLE_HANDLING,
-    VEHICLE_BALANCED
+    VEHICLE_BALANCED,
+    VEHICLE_CLASS_COUNT
 } vehicle_class_t;
 
-/* Vehicle state */
+/*
+ * Hot per-tick state of every car in a race, stored as arrays so the
+ * integration loops in vehicle_update_all() run over contiguous floats.
+ * Slots are handed out by vehicle_create() and reclaimed all at once by
+ * vehicle_pool_init().
+ */
 typedef struct {
-    /* Transform */
-    vec3_t position;
-    vec3_t velocity;
-    vec3_t acceleration;
-    float rotation_y;       /* Yaw - main steering */
+    int count;
+
+    /* Transform and motion */
+    float pos_x[MAX_VEHICLES], pos_y[MAX_VEHICLES], pos_z[MAX_VEHICLES];
+    float vel_x[MAX_VEHICLES], vel_y[MAX_VEHICLES], vel_z[MAX_VEHICLES];
+    float rotation_y[MAX_VEHICLES];     /* Yaw - main steering */
+    float speed[MAX_VEHICLES];
+
+    /* Controls */
+    float throttle[MAX_VEHICLES];
+    float brake[MAX_VEHICLES];
+    float steering[MAX_VEHICLES];
+
+    /* Surface contact, refreshed at the start of each update */
+    float ground_height[MAX_VEHICLES];
+    int is_on_track[MAX_VEHICLES];
+    int is_airborne[MAX_VEHICLES];
+
+    /* Heading basis, recomputed only when rotation_y changes */
+    float forward_x[MAX_VEHICLES], forward_z[MAX_VEHICLES];
+    float right_x[MAX_VEHICLES], right_z[MAX_VEHICLES];     /* forward x up */
+
+    /* Everything above is simulation state (see VEHICLE_POOL_SIM_BYTES) */
+    struct vehicle_s *owner[MAX_VEHICLES];
+
+    /* Slots of each class. Class stats are compile-time constants of
+     * that class's update kernel, so the field is updated a class at a time. */
+    uint8_t class_slots[VEHICLE_CLASS_COUNT][MAX_VEHICLES];
+    int class_count[VEHICLE_CLASS_COUNT];
+} vehicle_pool_t;
+
+/* Leading bytes of a vehicle_pool_t that snapshots copy */
+#define VEHICLE_POOL_SIM_BYTES offsetof(vehicle_pool_t, owner)
+
+/* Vehicle state (cold race and render data, hot state lives in the pool) */
+typedef struct vehicle_s {
+    vehicle_pool_t *pool;
+    int slot;
+
     float rotation_x;       /* Pitch - hills */
     float rotation_z;       /* Roll - banking */
-
-    /* Movement */
-    float speed;
-    float steering;
-    float throttle;
-    float brake;
-
-    /* Vehicle properties */
-    float max_speed;
-    float acceleration_rate;
-    float brake_rate;
-    float steering_rate;
     float drag;
-    float grip;
 
     /* Race state */
     int current_lap;
@@ -53,32 +84,50 @@ typedef struct {
     float lap_time;
     float best_lap_time;
     float total_time;
+    float lap_times[VEHICLE_MAX_LAPS];
+    float off_track_time;   /* Time spent off the road surface */
+    float finish_time;      /* total_time when the last lap completed */
     float track_progress;
+    int current_segment;    /* Last known segment, hint for track lookups */
     int finished;
     int place;
 
-    /* Rendering */
+    /* Rendering, rotation_x up to here is simulation state */
     mesh_t *mesh;
+    mesh_t *impostor;       /* Single quad drawn for distant cars */
+    float bound_radius;     /* Bounding sphere for culling */
     uint32_t color;
     vehicle_class_t vehicle_class;
 
     /* State flags */
     int is_player;
-    int is_on_track;
-    int is_airborne;
 } vehicle_t;
 
+/* The block of a vehicle_t that snapshots copy, from rotation_x to mesh */
+#define VEHICLE_SIM_OFFSET offsetof(vehicle_t, rotation_x)
+#define VEHICLE_SIM_BYTES (offsetof(vehicle_t, mesh) - VEHICLE_SIM_OFFSET)
+
+/* What vehicle_render() draws, frames between two ticks blend a pair */
+typedef struct {
+    vec3_t position;
+    float forward_x, forward_z;     /* Heading as the forward vector */
+    float rotation_x, rotation_z;
+} vehicle_pose_t;
+
 /* Initialize vehicle system */
 void vehicle_init(void);
 
-/* Create a new vehicle */
-vehicle_t *vehicle_create(vehicle_class_t vclass, uint32_t color, int is_player);
+/* Empty a pool, vehicles using it must already be destroyed */
+void vehicle_pool_init(vehicle_pool_t *pool);
+
+/* Create a new vehicle in the next free pool slot, NULL when the pool is full */
+vehicle_t *vehicle_create(vehicle_pool_t *pool, vehicle_class_t vclass, uint32_t color, int is_player);
 
 /* Destroy vehicle */
 void vehicle_destroy(vehicle_t *vehicle);
 
-/* Update vehicle physics and state */
-void vehicle_update(vehicle_t *vehicle, track_t *track, float dt);
+/* Update physics and race state of every vehicle in the pool */
+void vehicle_update_all(vehicle_pool_t *pool, track_t *track, float dt);
 
 /* Apply controls to vehicle */
 void vehicle_set_throttle(vehicle_t *vehicle, float throttle);
@@ -91,8 +140,25 @@ void vehicle_reset(vehicle_t *vehicle, vec3_t pos, float rotation);
 /* Render vehicle */
 void vehicle_render(vehicle_t *vehicle, camera_t *cam);
 
-/* Get forward direction vector */
+/* Current pose, blend of two poses (t = 0 gives a) and rendering at one */
+void vehicle_get_pose(vehicle_t *vehicle, vehicle_pose_t *pose);
+void vehicle_pose_lerp(const vehicle_pose_t *a, const vehicle_pose_t *b, float t, vehicle_pose_t *out);
+void vehicle_render_pose(vehicle_t *vehicle, const vehicle_pose_t *pose, camera_t *cam);
+
+/* Cached heading basis vectors (unit length, y = 0) */
 vec3_t vehicle_get_forward(vehicle_t *vehicle);
+vec3_t vehicle_get_right(vehicle_t *vehicle);
+
+/* Hot state accessors */
+vec3_t vehicle_get_position(vehicle_t *vehicle);
+void vehicle_set_position(vehicle_t *vehicle, vec3_t pos);
+vec3_t vehicle_get_velocity(vehicle_t *vehicle);
+void vehicle_set_velocity(vehicle_t *vehicle, vec3_t vel);
+float vehicle_get_rotation(vehicle_t *vehicle);
+float vehicle_get_speed(vehicle_t *vehicle);
+float vehicle_get_steering(vehicle_t *vehicle);
+float vehicle_get_max_speed(vehicle_t *vehicle);
+int vehicle_is_on_track(vehicle_t *vehicle);
 
 /* Check collision between vehicles */
 int vehicle_check_collision(vehicle_t *a, vehicle_t *b);
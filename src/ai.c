@@ -4,36 +4,38 @@
  */
 
 #include "ai.h"
+#include "fastmath.h"
 #include <stdlib.h>
 #include <string.h>
 
-/* Simple PRNG for AI variation */
-static uint32_t ai_rand_state = 54321;
+/* Speed profile is read this far ahead so braking starts in time */
+#define AI_SPEED_PREVIEW 0.3f   /* s */
+#define AI_COAST_MARGIN 2.0f    /* m/s over target before braking */
 
-static float ai_rand_float(void) {
-    ai_rand_state = ai_rand_state * 1103515245 + 12345;
-    return (float)((ai_rand_state >> 16) & 0x7FFF) / 32767.0f;
+/* Simple PRNG for AI variation, each controller owns its state */
+static float ai_rand_float(uint32_t *state) {
+    *state = *state * 1103515245 + 12345;
+    return (float)((*state >> 16) & 0x7FFF) / 32767.0f;
 }
 
-/* Difficulty parameters */
-static const struct {
-    float skill;
-    float aggression;
-    float error_rate;
-    float speed_factor;
-    float look_ahead;
-} difficulty_params[] = {
-    /* AI_EASY */   {0.6f, 0.2f, 0.15f, 0.85f, 15.0f},
-    /* AI_MEDIUM */ {0.75f, 0.4f, 0.08f, 0.92f, 20.0f},
-    /* AI_HARD */   {0.9f, 0.6f, 0.03f, 0.97f, 25.0f},
-    /* AI_EXPERT */ {0.98f, 0.8f, 0.01f, 1.0f, 30.0f}
-};
+/*
+ * Difficulty parameters: level, kernel suffix, skill (steering
+ * precision), aggression (avoidance and overtaking), error rate (chance
+ * of a wander per decision), speed factor (share of the speed profile)
+ * and look ahead (m). Each row becomes an ai_update() kernel with these
+ * as constants (DIFFICULTY_KERNEL below).
+ */
+#define AI_DIFFICULTIES(X) \
+    X(AI_EASY,   easy,   0.6f,  0.2f, 0.15f, 0.85f, 15.0f) \
+    X(AI_MEDIUM, medium, 0.75f, 0.4f, 0.08f, 0.92f, 20.0f) \
+    X(AI_HARD,   hard,   0.9f,  0.6f, 0.03f, 0.97f, 25.0f) \
+    X(AI_EXPERT, expert, 0.98f, 0.8f, 0.01f, 1.0f,  30.0f)
 
 void ai_init(void) {
-    ai_rand_state = 54321;
+    /* Nothing to initialize */
 }
 
-ai_controller_t *ai_create(vehicle_t *vehicle, ai_difficulty_t difficulty) {
+ai_controller_t *ai_create(vehicle_t *vehicle, ai_difficulty_t difficulty, uint32_t seed) {
     ai_controller_t *ai = (ai_controller_t *)malloc(sizeof(ai_controller_t));
     memset(ai, 0, sizeof(ai_controller_t));
 
@@ -41,14 +43,7 @@ ai_controller_t *ai_create(vehicle_t *vehicle, ai_difficulty_t difficulty) {
     ai->difficulty = difficulty;
     ai->state = AI_STATE_RACING;
 
-    /* Set parameters from difficulty */
-    ai->skill = difficulty_params[difficulty].skill;
-    ai->aggression = difficulty_params[difficulty].aggression;
-    ai->error_rate = difficulty_params[difficulty].error_rate;
-    ai->speed_factor = difficulty_params[difficulty].speed_factor;
-    ai->look_ahead = difficulty_params[difficulty].look_ahead;
-
-    ai->random_seed = (uint32_t)(ai_rand_float() * 65535);
+    ai->random_seed = seed;
     ai->wander = 0;
     ai->reaction_delay = 0;
 
@@ -63,17 +58,12 @@ void ai_destroy(ai_controller_t *ai) {
 
 void ai_set_difficulty(ai_controller_t *ai, ai_difficulty_t difficulty) {
     ai->difficulty = difficulty;
-    ai->skill = difficulty_params[difficulty].skill;
-    ai->aggression = difficulty_params[difficulty].aggression;
-    ai->error_rate = difficulty_params[difficulty].error_rate;
-    ai->speed_factor = difficulty_params[difficulty].speed_factor;
-    ai->look_ahead = difficulty_params[difficulty].look_ahead;
 }
 
 vec3_t ai_calculate_racing_line(track_t *track, float distance) {
-    vec3_t pos, dir;
-    track_get_position(track, distance, &pos, &dir);
-    return pos;
+    racing_line_sample_t s;
+    track_racing_line_at(track, distance, &s);
+    return vec3_create(s.x, s.y, s.z);
 }
 
 int ai_path_clear(ai_controller_t *ai, vehicle_t *vehicles[], int count, float distance) {
@@ -83,7 +73,7 @@ int ai_path_clear(ai_controller_t *ai, vehicle_t *vehicles[], int count, float d
     for (int i = 0; i < count; i++) {
         if (vehicles[i] == ai->vehicle) continue;
 
-        float dist = vec3_distance(ahead_pos, vehicles[i]->position);
+        float dist = vec3_distance(ahead_pos, vehicle_get_position(vehicles[i]));
         if (dist < 5.0f) {
             return 0;  /* Path blocked */
         }
@@ -92,34 +82,45 @@ int ai_path_clear(ai_controller_t *ai, vehicle_t *vehicles[], int count, float d
     return 1;
 }
 
-void ai_update(ai_controller_t *ai, track_t *track, vehicle_t *vehicles[], int vehicle_count, float dt) {
-    if (!ai || !ai->vehicle || !track) return;
-
+/* Decision for one car, inlined into each difficulty's kernel. Choices
+ * between behaviours are selects so the kernel runs straight through. */
+static inline __attribute__((always_inline))
+void ai_decide(ai_controller_t *ai, track_t *track, vehicle_t *vehicles[],
+               const int *neighbors, int neighbor_count, float dt,
+               float skill, float aggression, float error_rate, float speed_factor, float look_ahead) {
     vehicle_t *v = ai->vehicle;
-
-    /* Update wander (random steering variation) */
-    if (ai_rand_float() < ai->error_rate) {
-        ai->wander = (ai_rand_float() - 0.5f) * 0.3f;
-    }
-    ai->wander *= 0.95f;  /* Decay wander */
+    vec3_t position = vehicle_get_position(v);
+    float speed = vehicle_get_speed(v);
+
+    /* Update wander (random steering variation). Both draws are made and
+     * the second kept only on a mistake, the same stream as drawing it
+     * only then. */
+    uint32_t seed = ai->random_seed;
+    int mistake = ai_rand_float(&seed) < error_rate;
+    uint32_t no_mistake_seed = seed;
+    float new_wander = (ai_rand_float(&seed) - 0.5f) * 0.3f;
+    ai->random_seed = mistake ? seed : no_mistake_seed;
+    ai->wander = (mistake ? new_wander : ai->wander) * 0.95f;  /* Decay wander */
 
     /* Calculate target position (look ahead on track) */
     float current_progress = v->track_progress * track->total_length;
-    float target_distance = current_progress + ai->look_ahead + v->speed * 0.5f;
+    float target_distance = current_progress + look_ahead + speed * 0.5f;
 
-    vec3_t target_pos, target_dir;
-    track_get_position(track, target_distance, &target_pos, &target_dir);
+    racing_line_sample_t target, profile;
+    track_racing_line_at(track, target_distance, &target);
+    track_racing_line_at(track, current_progress + speed * AI_SPEED_PREVIEW, &profile);
 
+    vec3_t target_pos = vec3_create(target.x, target.y, target.z);
     ai->target_pos = target_pos;
     ai->target_distance = target_distance;
 
     /* Calculate steering to reach target */
-    vec3_t to_target = vec3_sub(target_pos, v->position);
+    vec3_t to_target = vec3_sub(target_pos, position);
     vec3_t forward = vehicle_get_forward(v);
 
     /* Calculate angle to target */
-    float target_angle = atan2f(to_target.x, to_target.z);
-    float current_angle = v->rotation_y;
+    float target_angle = fast_atan2(to_target.x, to_target.z);
+    float current_angle = vehicle_get_rotation(v);
 
     float angle_diff = target_angle - current_angle;
 
@@ -128,64 +129,46 @@ void ai_update(ai_controller_t *ai, track_t *track, vehicle_t *vehicles[], int v
     while (angle_diff < -3.14159f) angle_diff += 6.28318f;
 
     /* Apply steering with skill factor */
-    float steering = clamp(angle_diff * 2.0f * ai->skill, -1.0f, 1.0f);
+    float steering = clamp(angle_diff * 2.0f * skill, -1.0f, 1.0f);
     steering += ai->wander;
     steering = clamp(steering, -1.0f, 1.0f);
 
-    /* Check for nearby vehicles (avoidance) */
-    for (int i = 0; i < vehicle_count; i++) {
-        if (vehicles[i] == v) continue;
+    /* Check for nearby vehicles (avoidance), candidates come from the broad phase */
+    for (int n = 0; n < neighbor_count; n++) {
+        vehicle_t *other = vehicles[neighbors[n]];
+        if (other == v) continue;
 
-        vec3_t to_other = vec3_sub(vehicles[i]->position, v->position);
+        vec3_t to_other = vec3_sub(vehicle_get_position(other), position);
         float dist = vec3_length(to_other);
 
-        if (dist < 8.0f) {
-            /* Other vehicle is close */
-            float lateral = vec3_dot(to_other, vec3_cross(forward, vec3_create(0, 1, 0)));
-
+        if (dist < AI_AVOID_RADIUS) {
             /* Steer away from other vehicle */
-            if (lateral > 0) {
-                steering -= 0.3f * ai->aggression * (1.0f - dist / 8.0f);
-            } else {
-                steering += 0.3f * ai->aggression * (1.0f - dist / 8.0f);
-            }
+            float lateral = vec3_dot(to_other, vehicle_get_right(v));
+            float push = 0.3f * aggression * (1.0f - dist / AI_AVOID_RADIUS);
+            steering += lateral > 0 ? -push : push;
 
             /* Determine if we should try to overtake */
             float ahead = vec3_dot(to_other, forward);
-            if (ahead > 0 && ahead < 10.0f && dist < 5.0f) {
-                ai->state = AI_STATE_OVERTAKING;
-            }
+            int overtake = (ahead > 0) & (ahead < 10.0f) & (dist < 5.0f);
+            ai->state = overtake ? AI_STATE_OVERTAKING : ai->state;
         }
     }
 
-    /* Calculate throttle */
-    float throttle = 1.0f;
+    /* Follow the speed profile, which already includes braking for the
+     * corners ahead, capped by the difficulty's speed factor */
+    float target_speed = fminf(profile.speed, vehicle_get_max_speed(v)) * speed_factor;
+    ai->target_speed = target_speed;
 
-    /* Slow down for sharp turns */
-    if (fabsf(steering) > 0.5f) {
-        throttle = 0.7f - fabsf(steering) * 0.3f;
-    }
+    /* Coast just over the target, brake beyond the margin */
+    int braking = speed > target_speed + AI_COAST_MARGIN;
+    float throttle = speed > target_speed ? 0.0f : 1.0f;
+    float brake = braking ? clamp((speed - target_speed) * 0.1f, 0.2f, 1.0f) : 0.0f;
 
-    /* Apply speed factor from difficulty */
-    float max_speed = v->max_speed * ai->speed_factor;
-    if (v->speed > max_speed) {
-        throttle = 0;
-    }
-
-    /* Brake if going too fast into a turn */
-    float brake = 0;
-    if (v->speed > 50.0f && fabsf(steering) > 0.7f) {
-        brake = 0.5f;
-        throttle = 0;
-    }
-
-    /* Recovery state - if off track, try to get back */
-    if (!v->is_on_track) {
-        ai->state = AI_STATE_RECOVERING;
-        /* Steer more aggressively toward track */
-        steering = clamp(angle_diff * 3.0f, -1.0f, 1.0f);
-        throttle = 0.5f;
-    }
+    /* Recovery state - if off track, steer more aggressively toward it */
+    int off_track = !vehicle_is_on_track(v);
+    ai->state = off_track ? AI_STATE_RECOVERING : ai->state;
+    steering = off_track ? clamp(angle_diff * 3.0f, -1.0f, 1.0f) : steering;
+    throttle = off_track ? 0.5f : throttle;
 
     /* Apply controls */
     vehicle_set_steering(v, steering);
@@ -194,10 +177,107 @@ void ai_update(ai_controller_t *ai, track_t *track, vehicle_t *vehicles[], int v
 
     /* Update state timer */
     ai->state_timer += dt;
-    if (ai->state_timer > 2.0f) {
-        ai->state = AI_STATE_RACING;
-        ai->state_timer = 0;
+    int expired = ai->state_timer > 2.0f;
+    ai->state = expired ? AI_STATE_RACING : ai->state;
+    ai->state_timer = expired ? 0.0f : ai->state_timer;
+}
+
+typedef void (*ai_kernel_t)(ai_controller_t *ai, track_t *track, vehicle_t *vehicles[],
+                            const int *neighbors, int neighbor_count, float dt);
+
+#define DIFFICULTY_KERNEL(id, name, skill, aggression, error_rate, speed_factor, look_ahead) \
+    static void ai_update_##name(ai_controller_t *ai, track_t *track, vehicle_t *vehicles[], \
+                                 const int *neighbors, int neighbor_count, float dt) { \
+        ai_decide(ai, track, vehicles, neighbors, neighbor_count, dt, \
+                  skill, aggression, error_rate, speed_factor, look_ahead); \
+    }
+AI_DIFFICULTIES(DIFFICULTY_KERNEL)
+#undef DIFFICULTY_KERNEL
+
+static const ai_kernel_t ai_kernels[AI_DIFFICULTY_COUNT] = {
+#define DIFFICULTY_KERNEL_ENTRY(id, name, ...) [id] = ai_update_##name,
+    AI_DIFFICULTIES(DIFFICULTY_KERNEL_ENTRY)
+#undef DIFFICULTY_KERNEL_ENTRY
+};
+
+void ai_update(ai_controller_t *ai, track_t *track, vehicle_t *vehicles[],
+               const int *neighbors, int neighbor_count, float dt) {
+    if (!ai || !ai->vehicle || !track) return;
+
+    /* A race's controllers share a difficulty, so this always jumps to the same kernel */
+    ai_kernels[ai->difficulty](ai, track, vehicles, neighbors, neighbor_count, dt);
+}
+
+void ai_scheduler_init(ai_scheduler_t *s, int budget) {
+    memset(s, 0, sizeof(ai_scheduler_t));
+    s->budget = budget > 0 ? budget : AI_LOD_TICK_BUDGET;
+}
+
+/* Ticks between decisions for car i */
+static int lod_interval(vehicle_t *v, vec3_t focus_pos, int has_focus, int neighbor_count) {
+    if (!has_focus || neighbor_count > 0) return 1;
+
+    vec3_t d = vec3_sub(vehicle_get_position(v), focus_pos);
+    float dist_sq = d.x * d.x + d.z * d.z;
+    if (dist_sq < AI_LOD_NEAR_RADIUS * AI_LOD_NEAR_RADIUS) return 1;
+    if (dist_sq < AI_LOD_MID_RADIUS * AI_LOD_MID_RADIUS) return 2;
+    return AI_LOD_MAX_INTERVAL;
+}
+
+int ai_scheduler_plan(ai_scheduler_t *s, ai_controller_t *controllers[], vehicle_t *vehicles[],
+                      const int *neighbor_counts, int count, int focus, float dt,
+                      int *due, float *due_dt) {
+    int has_focus = (focus >= 0 && focus < count);
+    vec3_t focus_pos = has_focus ? vehicle_get_position(vehicles[focus]) : vec3_create(0, 0, 0);
+
+    int n = 0;
+    int waiting[MAX_VEHICLES];
+    int waiting_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (!controllers[i]) continue;
+        s->age[i]++;
+        s->pending_dt[i] += dt;
+
+        int interval = lod_interval(vehicles[i], focus_pos, has_focus, neighbor_counts[i]);
+        if (interval == 1) {
+            due[n++] = i;
+        } else if (s->age[i] >= interval && ((s->tick + (uint32_t)i) % (uint32_t)interval == 0 ||
+                                             s->age[i] > interval)) {
+            /* Staggered by index so far cars don't all decide on the same tick */
+            waiting[waiting_count++] = i;
+        } else {
+            s->skipped++;
+        }
+    }
+
+    /* Far cars share the budget, the longest waiting first */
+    for (int k = 0; k < waiting_count; k++) {
+        int best = k;
+        for (int j = k + 1; j < waiting_count; j++) {
+            if (s->age[waiting[j]] > s->age[waiting[best]]) best = j;
+        }
+        int i = waiting[best];
+        waiting[best] = waiting[k];
+        waiting[k] = i;
+
+        if (k < s->budget) {
+            due[n++] = i;
+        } else {
+            s->deferred++;
+        }
     }
+
+    for (int k = 0; k < n; k++) {
+        int i = due[k];
+        due_dt[k] = s->pending_dt[i];
+        s->age[i] = 0;
+        s->pending_dt[i] = 0;
+    }
+
+    s->decisions += (uint32_t)n;
+    s->tick++;
+    return n;
 }
 
 const char *ai_difficulty_name(ai_difficulty_t difficulty) {
@@ -0,0 +1,50 @@
+/*
+ * RetroRacer - Arena Allocator
+ * Bump allocation from one block, released all at once
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "arena.h"
+
+void arena_init(arena_t *arena) {
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
+
+int arena_reserve(arena_t *arena, size_t size) {
+    arena->used = 0;
+    if (size <= arena->capacity) return 1;
+
+    /* Padding lets the first allocation start on an aligned address */
+    free(arena->base);
+    arena->base = (unsigned char *)malloc(size + ARENA_ALIGN);
+    if (!arena->base) {
+        arena->capacity = 0;
+        return 0;
+    }
+    arena->capacity = size;
+    return 1;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    if (!arena->base) return NULL;
+
+    uintptr_t start = ((uintptr_t)arena->base + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1);
+    size_t offset = (size_t)(start - (uintptr_t)arena->base) + arena->used;
+    size = ARENA_SIZE(size);
+    if (arena->used + size > arena->capacity) return NULL;
+
+    arena->used += size;
+    return arena->base + offset;
+}
+
+void arena_reset(arena_t *arena) {
+    arena->used = 0;
+}
+
+void arena_free(arena_t *arena) {
+    free(arena->base);
+    arena_init(arena);
+}
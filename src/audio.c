@@ -5,14 +5,199 @@
 
 #include "audio.h"
 #include <string.h>
+#include <stdio.h>
 
 #ifdef DREAMCAST
 #include <kos.h>
 #include <dc/sound/sound.h>
 #include <dc/sound/sfxmgr.h>
+#include <dc/sound/stream.h>
+#include "profiler.h"
 #endif
 
 static audio_state_t audio_state;
+/* read_errors, blocks_read and max_read_us are written by the feeder
+ * thread, the rest on the game thread. All are read through atomics. */
+static audio_stream_stats_t stream_stats;
+static audio_stream_stats_t stream_stats_copy;
+
+#ifdef DREAMCAST
+/*
+ * Music streaming. A feeder thread reads the track from disc into a
+ * ring of MUSIC_RING_BLOCKS blocks, one block ahead of playback.
+ * audio_update() polls snd_stream on the game thread and the stream
+ * callback hands out ring memory without copying. Blocks are released
+ * back to the feeder only after the poll has copied them to AICA RAM.
+ *
+ * Tracks are raw 16-bit stereo PCM at MUSIC_RATE, looped at EOF.
+ * Every block is tagged with the play request it was read for. Blocks
+ * from a previous track are dropped, so a switch never waits on a
+ * read in flight.
+ */
+#define MUSIC_RATE 44100
+#define MUSIC_BLOCK_SIZE 32768      /* One disc read */
+#define MUSIC_RING_BLOCKS 2         /* Double buffered */
+#define MUSIC_FEED_SLEEP_MS 5
+
+typedef struct {
+    uint8_t data[MUSIC_RING_BLOCKS][MUSIC_BLOCK_SIZE] __attribute__((aligned(32)));
+    uint32_t len[MUSIC_RING_BLOCKS];
+    uint32_t gen[MUSIC_RING_BLOCKS];
+
+    uint32_t filled;        /* Blocks produced, written by the feeder */
+    uint32_t consumed;      /* Blocks released, written by the game thread */
+    uint32_t pending;       /* Blocks handed out during the current poll */
+    uint32_t offset;        /* Read offset into the current block */
+
+    uint32_t request_gen;   /* Bumped by every audio_play_music() */
+    int request_track;
+    uint32_t failed_gen;    /* Request whose file could not be opened */
+    int running;
+
+    kthread_t *thread;
+    snd_stream_hnd_t hnd;
+    int started;
+} music_stream_t;
+
+static music_stream_t music;
+
+/* Handed to snd_stream when the ring runs dry */
+static uint8_t music_silence[MUSIC_BLOCK_SIZE] __attribute__((aligned(32)));
+
+/* Samples loaded into AICA RAM once at init */
+static const char *sfx_files[SFX_COUNT] = {
+    "/cd/sfx/engine_loop.wav",
+    "/cd/sfx/engine_rev.wav",
+    "/cd/sfx/skid.wav",
+    "/cd/sfx/collision.wav",
+    "/cd/sfx/checkpoint.wav",
+    "/cd/sfx/lap_complete.wav",
+    "/cd/sfx/race_start.wav",
+    "/cd/sfx/countdown_beep.wav",
+    "/cd/sfx/menu_select.wav",
+    "/cd/sfx/menu_move.wav"
+};
+
+static sfxhnd_t sfx_handles[SFX_COUNT];
+
+/* Fill one block from the file, wrapping to the start at EOF */
+static int music_read_block(FILE *f, uint8_t *dst) {
+    size_t got = 0;
+    int wrapped = 0;
+
+    while (got < MUSIC_BLOCK_SIZE) {
+        size_t n = fread(dst + got, 1, MUSIC_BLOCK_SIZE - got, f);
+        got += n;
+        if (got < MUSIC_BLOCK_SIZE) {
+            /* Empty or unreadable file, give up after one wrap */
+            if (wrapped && n == 0) return 0;
+            fseek(f, 0, SEEK_SET);
+            wrapped = 1;
+        }
+    }
+    return 1;
+}
+
+static void *music_feeder_main(void *arg) {
+    FILE *file = NULL;
+    uint32_t file_gen = 0;
+    (void)arg;
+
+    while (__atomic_load_n(&music.running, __ATOMIC_ACQUIRE)) {
+        /* Reopen when a new track was requested */
+        uint32_t gen = __atomic_load_n(&music.request_gen, __ATOMIC_ACQUIRE);
+        if (gen != file_gen) {
+            char path[32];
+            if (file) fclose(file);
+            snprintf(path, sizeof(path), "/cd/music/track_%02d.pcm",
+                     __atomic_load_n(&music.request_track, __ATOMIC_RELAXED));
+            file = fopen(path, "rb");
+            file_gen = gen;
+            if (!file) {
+                __atomic_store_n(&music.failed_gen, gen, __ATOMIC_RELEASE);
+            }
+        }
+
+        uint32_t filled = music.filled;
+        uint32_t consumed = __atomic_load_n(&music.consumed, __ATOMIC_ACQUIRE);
+        if (!file || filled - consumed >= MUSIC_RING_BLOCKS) {
+            thd_sleep(MUSIC_FEED_SLEEP_MS);
+            continue;
+        }
+
+        int b = filled % MUSIC_RING_BLOCKS;
+        uint64_t start = prof_time_us();
+        if (!music_read_block(file, music.data[b])) {
+            __atomic_fetch_add(&stream_stats.read_errors, 1, __ATOMIC_RELAXED);
+            fclose(file);
+            file = NULL;
+            __atomic_store_n(&music.failed_gen, file_gen, __ATOMIC_RELEASE);
+            continue;
+        }
+        uint32_t read_us = (uint32_t)(prof_time_us() - start);
+        if (read_us > __atomic_load_n(&stream_stats.max_read_us, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&stream_stats.max_read_us, read_us, __ATOMIC_RELAXED);
+        }
+        __atomic_fetch_add(&stream_stats.blocks_read, 1, __ATOMIC_RELAXED);
+
+        music.len[b] = MUSIC_BLOCK_SIZE;
+        music.gen[b] = file_gen;
+        __atomic_store_n(&music.filled, filled + 1, __ATOMIC_RELEASE);
+    }
+
+    if (file) fclose(file);
+    return NULL;
+}
+
+/* snd_stream callback, runs inside snd_stream_poll() on the game thread.
+ * KOS passes the request size in bytes. */
+static void *music_stream_cb(snd_stream_hnd_t hnd, int req, int *recv) {
+    uint32_t gen = __atomic_load_n(&music.request_gen, __ATOMIC_RELAXED);
+    (void)hnd;
+
+    if (req > MUSIC_BLOCK_SIZE) req = MUSIC_BLOCK_SIZE;
+
+    uint32_t filled = __atomic_load_n(&music.filled, __ATOMIC_ACQUIRE);
+    uint32_t cursor = music.consumed + music.pending;
+
+    /* Drop blocks read for an earlier track */
+    while (cursor != filled && music.gen[cursor % MUSIC_RING_BLOCKS] != gen) {
+        music.pending++;
+        music.offset = 0;
+        cursor++;
+    }
+
+    if (cursor == filled) {
+        /* Nothing buffered: play silence, count it unless the track is missing */
+        if (__atomic_load_n(&music.failed_gen, __ATOMIC_ACQUIRE) != gen) {
+            stream_stats.underruns++;
+            stream_stats.underrun_bytes += req;
+        }
+        *recv = req;
+        return music_silence;
+    }
+
+    int b = cursor % MUSIC_RING_BLOCKS;
+    uint32_t avail = music.len[b] - music.offset;
+    uint32_t n = (uint32_t)req < avail ? (uint32_t)req : avail;
+    void *ptr = music.data[b] + music.offset;
+
+    music.offset += n;
+    if (music.offset == music.len[b]) {
+        music.pending++;
+        music.offset = 0;
+    }
+
+    *recv = (int)n;
+    return ptr;
+}
+
+static void music_apply_volume(void) {
+    if (music.hnd != SND_STREAM_INVALID) {
+        snd_stream_volume(music.hnd, audio_state.music_volume * 255 / 100);
+    }
+}
+#endif /* DREAMCAST */
 
 /* Track metadata - 90s techno classics (public domain placeholders) */
 typedef struct {
@@ -46,15 +231,79 @@ void audio_init(void) {
 
 #ifdef DREAMCAST
     snd_init();
+
+    /* Every effect lives in AICA RAM from here on, playback never loads */
+    for (int i = 0; i < SFX_COUNT; i++) {
+        sfx_handles[i] = snd_sfx_load(sfx_files[i]);
+    }
+
+    memset(&music, 0, sizeof(music));
+    music.hnd = SND_STREAM_INVALID;
+    if (snd_stream_init() == 0) {
+        music.hnd = snd_stream_alloc(music_stream_cb, SND_STREAM_BUFFER_MAX);
+    }
+    if (music.hnd != SND_STREAM_INVALID) {
+        music.running = 1;
+        music.thread = thd_create(0, music_feeder_main, NULL);
+        if (!music.thread) music.running = 0;
+    }
 #endif
 }
 
 void audio_shutdown(void) {
 #ifdef DREAMCAST
+    if (music.started) snd_stream_stop(music.hnd);
+    if (music.thread) {
+        __atomic_store_n(&music.running, 0, __ATOMIC_RELEASE);
+        thd_join(music.thread, NULL);
+        music.thread = NULL;
+    }
+    if (music.hnd != SND_STREAM_INVALID) {
+        snd_stream_destroy(music.hnd);
+        music.hnd = SND_STREAM_INVALID;
+    }
+    snd_stream_shutdown();
+    snd_sfx_unload_all();
+    for (int i = 0; i < SFX_COUNT; i++) {
+        sfx_handles[i] = SFXHND_INVALID;
+    }
     snd_shutdown();
 #endif
 }
 
+void audio_update(void) {
+#ifdef DREAMCAST
+    if (!music.started || !audio_state.is_playing) return;
+
+    uint32_t buffered = __atomic_load_n(&music.filled, __ATOMIC_ACQUIRE) - music.consumed;
+    uint32_t bytes = buffered * MUSIC_BLOCK_SIZE - music.offset;
+    if (stream_stats.polls == 0 || bytes < stream_stats.low_water_bytes) {
+        stream_stats.low_water_bytes = bytes;
+    }
+    stream_stats.polls++;
+
+    snd_stream_poll(music.hnd);
+
+    /* snd_stream has copied what the callback handed out */
+    if (music.pending) {
+        __atomic_store_n(&music.consumed, music.consumed + music.pending, __ATOMIC_RELEASE);
+        music.pending = 0;
+    }
+#endif
+}
+
+const audio_stream_stats_t *audio_get_stream_stats(void) {
+    /* A copy, the feeder may be writing its counters */
+    stream_stats_copy.underruns = __atomic_load_n(&stream_stats.underruns, __ATOMIC_RELAXED);
+    stream_stats_copy.underrun_bytes = __atomic_load_n(&stream_stats.underrun_bytes, __ATOMIC_RELAXED);
+    stream_stats_copy.blocks_read = __atomic_load_n(&stream_stats.blocks_read, __ATOMIC_RELAXED);
+    stream_stats_copy.read_errors = __atomic_load_n(&stream_stats.read_errors, __ATOMIC_RELAXED);
+    stream_stats_copy.max_read_us = __atomic_load_n(&stream_stats.max_read_us, __ATOMIC_RELAXED);
+    stream_stats_copy.low_water_bytes = __atomic_load_n(&stream_stats.low_water_bytes, __ATOMIC_RELAXED);
+    stream_stats_copy.polls = __atomic_load_n(&stream_stats.polls, __ATOMIC_RELAXED);
+    return &stream_stats_copy;
+}
+
 audio_state_t *audio_get_state(void) {
     return &audio_state;
 }
@@ -67,14 +316,17 @@ void audio_play_music(music_track_t track) {
     audio_state.is_playing = 1;
 
 #ifdef DREAMCAST
-    /*
-     * In a full implementation, this would load and stream
-     * the audio file from CD-ROM or ramdisk.
-     * Format: /cd/music/track_XX.adpcm
-     *
-     * For now, the infrastructure is in place.
-     * Add actual audio files and streaming code as needed.
-     */
+    if (!music.thread) return;
+
+    /* The feeder reopens on the new generation, stale blocks are dropped */
+    __atomic_store_n(&music.request_track, (int)track, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&music.request_gen, 1, __ATOMIC_RELEASE);
+
+    if (!music.started) {
+        snd_stream_start(music.hnd, MUSIC_RATE, 1);
+        music_apply_volume();
+        music.started = 1;
+    }
 #endif
 }
 
@@ -82,7 +334,10 @@ void audio_stop_music(void) {
     audio_state.is_playing = 0;
 
 #ifdef DREAMCAST
-    /* Stop streaming audio */
+    if (music.started) {
+        snd_stream_stop(music.hnd);
+        music.started = 0;
+    }
 #endif
 }
 
@@ -90,7 +345,8 @@ void audio_pause_music(void) {
     if (audio_state.is_playing) {
         audio_state.is_playing = 0;
 #ifdef DREAMCAST
-        /* Pause stream */
+        /* The ring keeps its position, audio_update() stops polling */
+        if (music.started) snd_stream_stop(music.hnd);
 #endif
     }
 }
@@ -99,7 +355,10 @@ void audio_resume_music(void) {
     if (audio_state.music_enabled) {
         audio_state.is_playing = 1;
 #ifdef DREAMCAST
-        /* Resume stream */
+        if (music.started) {
+            snd_stream_start(music.hnd, MUSIC_RATE, 1);
+            music_apply_volume();
+        }
 #endif
     }
 }
@@ -110,7 +369,7 @@ void audio_set_music_volume(int volume) {
     audio_state.music_volume = volume;
 
 #ifdef DREAMCAST
-    /* Adjust AICA channel volume */
+    music_apply_volume();
 #endif
 }
 
@@ -119,12 +378,11 @@ void audio_play_sfx(sound_effect_t sfx) {
     if (sfx >= SFX_COUNT) return;
 
 #ifdef DREAMCAST
-    /*
-     * Play sound effect from loaded samples
-     * sfx_play(sfx_handles[sfx], audio_state.sfx_volume);
-     */
+    /* Channel trigger only, the sample is already in AICA RAM */
+    if (sfx_handles[sfx] != SFXHND_INVALID) {
+        snd_sfx_play(sfx_handles[sfx], audio_state.sfx_volume * 255 / 100, 128);
+    }
 #endif
-    (void)sfx;
 }
 
 void audio_set_sfx_volume(int volume) {
@@ -0,0 +1,87 @@
+/*
+ * RetroRacer - Fast Trigonometry
+ * fsca on SH-4, polynomial approximations elsewhere
+ */
+
+#include "fastmath.h"
+
+#ifdef DREAMCAST
+
+/* 65536 / (2 * pi): fsca takes the angle as a 16.16 fraction of a turn */
+#define FSCA_SCALE 10430.378350470453f
+
+void fast_sincos(float angle, float *s, float *c) {
+    register float fs __asm__("fr0");
+    register float fc __asm__("fr1");
+    int fixed = (int)(angle * FSCA_SCALE);
+    __asm__("lds %2, fpul\n\t"
+            "fsca fpul, dr0\n"
+            : "=f"(fs), "=f"(fc)
+            : "r"(fixed)
+            : "fpul");
+    *s = fs;
+    *c = fc;
+}
+
+#else
+
+/* pi/2 split in two so q * PIO2_HI is exact for moderate q */
+#define TWO_OVER_PI 0.636619772367581343f
+#define PIO2_HI 1.5703125f
+#define PIO2_LO 4.83826794897e-4f
+
+void fast_sincos(float angle, float *s, float *c) {
+    /* Nearest quadrant, then a remainder in [-pi/4, pi/4] */
+    float qf = angle * TWO_OVER_PI;
+    int q = (int)(qf + (qf >= 0 ? 0.5f : -0.5f));
+    float r = (angle - (float)q * PIO2_HI) - (float)q * PIO2_LO;
+    float r2 = r * r;
+
+    /* Cephes sinf/cosf coefficients */
+    float sr = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+    float cr = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+    switch (q & 3) {
+        case 0: *s = sr;  *c = cr;  break;
+        case 1: *s = cr;  *c = -sr; break;
+        case 2: *s = -sr; *c = -cr; break;
+        default: *s = -cr; *c = sr; break;
+    }
+}
+
+#endif /* DREAMCAST */
+
+float fast_sin(float angle) {
+    float s, c;
+    fast_sincos(angle, &s, &c);
+    return s;
+}
+
+float fast_cos(float angle) {
+    float s, c;
+    fast_sincos(angle, &s, &c);
+    return c;
+}
+
+#define HALF_PI 1.57079632679489662f
+#define PI 3.14159265358979324f
+
+float fast_atan2(float y, float x) {
+    float ax = x < 0 ? -x : x;
+    float ay = y < 0 ? -y : y;
+    float hi = ax > ay ? ax : ay;
+    float lo = ax > ay ? ay : ax;
+    if (hi == 0.0f) return 0.0f;
+
+    /* atan on [0, 1], Abramowitz & Stegun 4.4.49 */
+    float t = lo / hi;
+    float t2 = t * t;
+    float a = t * (1.0f + t2 * (-0.3333314528f + t2 * (0.1999355085f + t2 * (-0.1420889944f +
+              t2 * (0.1065626393f + t2 * (-0.0752896400f + t2 * (0.0429096138f +
+              t2 * (-0.0161657367f + t2 * 0.0028662257f))))))));
+
+    /* Back out to the full circle */
+    if (ay > ax) a = HALF_PI - a;
+    if (x < 0) a = PI - a;
+    return y < 0 ? -a : a;
+}
@@ -6,17 +6,166 @@
 #include "game.h"
 #include "physics.h"
 #include "audio.h"
+#include "profiler.h"
+#include "pvrcap.h"
+#include "fastmath.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 #ifdef DREAMCAST
 #include <kos.h>
+#else
+#include <pthread.h>
 #endif
 
+/* Extra broad phase reach for movement during one tick */
+#define NEIGHBOR_SLACK 4.0f
+
 static game_t game;
 static float delta_time = 1.0f / 60.0f;
 
+/* Saved on native builds after every race, for bug reports */
+#define REPLAY_FILE "retroracer_replay.rrp"
+#define GHOST_FILE "retroracer_ghost.rrp"
+
+/* PVR command stream capture, through dcload on Dreamcast */
+#ifdef DREAMCAST
+#define PVRCAP_FILE "/pc/retroracer.pvrc"
+#else
+#define PVRCAP_FILE "retroracer.pvrc"
+#endif
+
+/* Last race and the time trial ghost, interactive game only */
+static replay_t race_replay;
+static replay_t ghost_replay;
+static replay_ghost_t ghost_cursor;
+static int ghost_valid;
+static mesh_t *ghost_mesh;
+
+#define GHOST_COLOR PACK_COLOR(96, 200, 230, 255)
+#define GHOST_BOUND_RADIUS 3.0f
+
+/* Poses before the last tick, game_render() blends from these */
+static struct {
+    vehicle_pose_t vehicles[MAX_VEHICLES];
+    int vehicle_count;
+    vec3_t camera_position;
+    vec3_t camera_target;
+} prev_poses;
+
+/*
+ * Next-track pregeneration. While the results or standings screen is up,
+ * a background thread builds the next race's track (segments, lookup grid
+ * and racing line) in a spare track_pool slot. Road geometry is not baked
+ * here, track_stream_update() streams it in around the camera. Only the
+ * main thread touches the pool; the worker writes just the track it was
+ * handed, then sets done.
+ */
+typedef struct {
+    int active;             /* Started and not yet collected */
+    int done;               /* Set by the worker, accessed atomically */
+    int ok;
+    track_t *track;
+    track_params_t params;
+#ifdef DREAMCAST
+    kthread_t *thread;
+#else
+    pthread_t thread;
+#endif
+} track_job_t;
+
+static track_job_t next_track;
+
+/* Race waiting in GAME_STATE_LOADING for the job to finish */
+static struct {
+    game_mode_t mode;
+    int num_laps;
+    int num_opponents;
+} loading_race;
+
+static void *track_job_main(void *arg) {
+    track_job_t *job = (track_job_t *)arg;
+    job->ok = track_generate_into(job->track, &job->params);
+    __atomic_store_n(&job->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void track_job_start(uint32_t seed) {
+    if (next_track.active) return;
+
+    next_track.track = track_pool_acquire(&game.track_pool);
+    if (!next_track.track) return;
+    next_track.params = game_sim_track_params(&game, seed);
+    next_track.done = 0;
+    next_track.ok = 0;
+
+#ifdef DREAMCAST
+    next_track.thread = thd_create(0, track_job_main, &next_track);
+    int started = next_track.thread != NULL;
+#else
+    int started = pthread_create(&next_track.thread, NULL, track_job_main, &next_track) == 0;
+#endif
+
+    if (!started) {
+        /* The next race generates its track synchronously instead */
+        track_pool_release(&game.track_pool, next_track.track);
+        return;
+    }
+    next_track.active = 1;
+}
+
+static int track_job_done(void) {
+    return __atomic_load_n(&next_track.done, __ATOMIC_ACQUIRE);
+}
+
+/* Wait for the job, returns its track (still a pool slot) or NULL on failure */
+static track_t *track_job_collect(track_params_t *params) {
+    if (!next_track.active) return NULL;
+
+#ifdef DREAMCAST
+    thd_join(next_track.thread, NULL);
+#else
+    pthread_join(next_track.thread, NULL);
+#endif
+    next_track.active = 0;
+
+    if (!next_track.ok) {
+        track_pool_release(&game.track_pool, next_track.track);
+        return NULL;
+    }
+    *params = next_track.params;
+    return next_track.track;
+}
+
+static void track_job_cancel(void) {
+    track_params_t params;
+    track_t *track = track_job_collect(&params);
+    if (track) track_pool_release(&game.track_pool, track);
+}
+
+/* Start the race queued by game_start_race() on the pregenerated track */
+static void start_loaded_race(void) {
+    track_params_t params;
+    track_t *track = track_job_collect(&params);
+
+    /* Settings may have changed since the job started */
+    if (track && params.difficulty != game_sim_track_params(&game, params.seed).difficulty) {
+        track_pool_release(&game.track_pool, track);
+        track = NULL;
+    }
+
+    int started;
+    if (track) {
+        started = game_sim_start_race_on_track(&game, loading_race.mode, loading_race.num_laps,
+                                               loading_race.num_opponents, track, &params);
+    } else {
+        started = game_sim_start_race(&game, loading_race.mode, loading_race.num_laps,
+                                      loading_race.num_opponents, track_random_seed());
+    }
+    if (!started) game_return_to_menu();
+}
+
 /* Vehicle colors for AI */
 static const uint32_t ai_colors[] = {
     PACK_COLOR(255, 255, 50, 50),    /* Red */
@@ -28,8 +177,29 @@ static const uint32_t ai_colors[] = {
     PACK_COLOR(255, 0, 255, 255),    /* Cyan */
 };
 
+void game_sim_init(game_t *g) {
+    memset(g, 0, sizeof(game_t));
+
+    /* Setup camera */
+    g->camera.position = vec3_create(0, 10, -20);
+    g->camera.target = vec3_create(0, 0, 0);
+    g->camera.up = vec3_create(0, 1, 0);
+    g->camera.fov = 60.0f;
+    g->camera.aspect = 640.0f / 480.0f;
+    g->camera.near_plane = 0.1f;
+    g->camera.far_plane = 1000.0f;
+    g->camera.cull_distance = RENDER_DEFAULT_CULL_DISTANCE;
+    g->camera_distance = 8.0f;   /* Closer to vehicle */
+    g->camera_height = 3.0f;     /* Lower camera to see more ground */
+
+    g->state = GAME_STATE_MENU;
+    g->num_laps = 3;
+    g->best_time = 999999.0f;
+    g->player_vehicle_index = -1;
+}
+
 void game_init(void) {
-    memset(&game, 0, sizeof(game_t));
+    game_sim_init(&game);
 
     /* Initialize subsystems */
     render_init();
@@ -41,188 +211,296 @@ void game_init(void) {
     audio_init();
     menu_init();
 
-    /* Setup camera */
-    game.camera.position = vec3_create(0, 10, -20);
-    game.camera.target = vec3_create(0, 0, 0);
-    game.camera.up = vec3_create(0, 1, 0);
-    game.camera.fov = 60.0f;
-    game.camera.aspect = 640.0f / 480.0f;
-    game.camera.near_plane = 0.1f;
-    game.camera.far_plane = 1000.0f;
-    game.camera_distance = 8.0f;   /* Closer to vehicle */
-    game.camera_height = 3.0f;     /* Lower camera to see more ground */
+    game.input = input_get_state(0);
+    game.recording = &race_replay;
 
-    game.state = GAME_STATE_MENU;
-    game.num_laps = 3;
-    game.best_time = 999999.0f;
-}
+    /* Ghost from an earlier session */
+#ifdef DREAMCAST
+    ghost_valid = replay_load_vmu(&ghost_replay);
+#else
+    ghost_valid = replay_load(&ghost_replay, GHOST_FILE);
+#endif
 
-void game_shutdown(void) {
-    /* Clean up audio */
-    audio_shutdown();
+    prof_init();
+}
 
+void game_sim_shutdown(game_t *g) {
     /* Clean up track */
-    if (game.track) {
-        track_destroy(game.track);
-        game.track = NULL;
+    if (g->track) {
+        track_pool_release(&g->track_pool, g->track);
+        g->track = NULL;
     }
+    track_pool_shutdown(&g->track_pool);
 
     /* Clean up vehicles and AI */
-    for (int i = 0; i < game.vehicle_count; i++) {
-        if (game.ai_controllers[i]) {
-            ai_destroy(game.ai_controllers[i]);
-            game.ai_controllers[i] = NULL;
+    for (int i = 0; i < g->vehicle_count; i++) {
+        if (g->ai_controllers[i]) {
+            ai_destroy(g->ai_controllers[i]);
+            g->ai_controllers[i] = NULL;
         }
-        if (game.vehicles[i]) {
-            vehicle_destroy(game.vehicles[i]);
-            game.vehicles[i] = NULL;
+        if (g->vehicles[i]) {
+            vehicle_destroy(g->vehicles[i]);
+            g->vehicles[i] = NULL;
         }
     }
-    game.vehicle_count = 0;
+    g->vehicle_count = 0;
+}
+
+/* Free the race, the subsystems stay up for the next one */
+static void release_race(void) {
+    /* The job writes into a pool slot freed below */
+    track_job_cancel();
+
+    if (ghost_mesh) {
+        mesh_destroy(ghost_mesh);
+        ghost_mesh = NULL;
+    }
+
+    game_sim_shutdown(&game);
+}
+
+void game_shutdown(void) {
+    release_race();
+
+    /* Audio lives for the whole session, the menu plays music too */
+    audio_shutdown();
 }
 
 game_t *game_get_instance(void) {
     return &game;
 }
 
-static void spawn_vehicles(int num_ai, int include_player) {
-    menu_state_t *menu = menu_get_state();
-
+static void spawn_vehicles(game_t *g, int num_ai, int include_player) {
     /* Clean up existing vehicles */
-    for (int i = 0; i < game.vehicle_count; i++) {
-        if (game.ai_controllers[i]) ai_destroy(game.ai_controllers[i]);
-        if (game.vehicles[i]) vehicle_destroy(game.vehicles[i]);
-        game.ai_controllers[i] = NULL;
-        game.vehicles[i] = NULL;
+    for (int i = 0; i < g->vehicle_count; i++) {
+        if (g->ai_controllers[i]) ai_destroy(g->ai_controllers[i]);
+        if (g->vehicles[i]) vehicle_destroy(g->vehicles[i]);
+        g->ai_controllers[i] = NULL;
+        g->vehicles[i] = NULL;
     }
-    game.vehicle_count = 0;
+    g->vehicle_count = 0;
+    vehicle_pool_init(&g->vehicle_pool);
 
     int vehicle_idx = 0;
 
     /* Spawn player vehicle */
     if (include_player) {
         vehicle_t *player = vehicle_create(
-            (vehicle_class_t)menu->selected_vehicle,
+            &g->vehicle_pool,
+            (vehicle_class_t)g->player_vehicle_class,
             PACK_COLOR(255, 255, 200, 0),  /* Player is gold */
             1
         );
-        player->total_laps = game.num_laps;
+        player->total_laps = g->num_laps;
 
-        vec3_t start_pos = game.track->start_position;
+        vec3_t start_pos = g->track->start_position;
         start_pos.x += 2.0f;  /* Offset to grid position */
         vehicle_reset(player, start_pos, 0);
 
-        game.vehicles[vehicle_idx] = player;
-        game.ai_controllers[vehicle_idx] = NULL;
-        game.player_vehicle_index = vehicle_idx;
+        g->vehicles[vehicle_idx] = player;
+        g->ai_controllers[vehicle_idx] = NULL;
+        g->player_vehicle_index = vehicle_idx;
         vehicle_idx++;
     }
 
     /* Spawn AI vehicles */
     for (int i = 0; i < num_ai && vehicle_idx < MAX_VEHICLES; i++) {
         vehicle_t *ai_vehicle = vehicle_create(
+            &g->vehicle_pool,
             (vehicle_class_t)(i % 4),  /* Vary vehicle types */
             ai_colors[i % 7],
             0
         );
-        ai_vehicle->total_laps = game.num_laps;
+        ai_vehicle->total_laps = g->num_laps;
 
         /* Grid position */
-        vec3_t start_pos = game.track->start_position;
+        vec3_t start_pos = g->track->start_position;
         start_pos.x += (i % 2 == 0) ? -2.0f : 2.0f;
         start_pos.z -= (i / 2 + 1) * 5.0f;
         vehicle_reset(ai_vehicle, start_pos, 0);
 
-        game.vehicles[vehicle_idx] = ai_vehicle;
-        game.ai_controllers[vehicle_idx] = ai_create(
+        /* Per-car stream derived from the race seed */
+        uint32_t ai_seed = g->seed ^ (0x9E3779B9u * (uint32_t)(i + 1));
+
+        g->vehicles[vehicle_idx] = ai_vehicle;
+        g->ai_controllers[vehicle_idx] = ai_create(
             ai_vehicle,
-            (ai_difficulty_t)menu->selected_difficulty
+            (ai_difficulty_t)g->ai_difficulty,
+            ai_seed
         );
         vehicle_idx++;
     }
 
-    game.vehicle_count = vehicle_idx;
+    g->vehicle_count = vehicle_idx;
+    broadphase_init(&g->broadphase);
+    ai_scheduler_init(&g->ai_scheduler, AI_LOD_TICK_BUDGET);
 }
 
-void game_start_race(game_mode_t mode, int num_laps, int num_opponents) {
-    game.mode = mode;
-    game.num_laps = num_laps;
-    game.race_time = 0;
-    game.countdown_timer = 3.0f;
-    game.countdown_value = 3;
+track_params_t game_sim_track_params(game_t *g, uint32_t seed) {
+    track_params_t params = track_default_params();
+    params.seed = seed;
+    params.difficulty = g->ai_difficulty + 1;
+    return params;
+}
 
-    /* Generate new track */
-    if (game.track) {
-        track_destroy(game.track);
+int game_sim_start_race(game_t *g, game_mode_t mode, int num_laps, int num_opponents, uint32_t seed) {
+    track_params_t params = game_sim_track_params(g, seed);
+
+    /* Generate new track, recycling the previous one's storage */
+    if (g->track) {
+        track_pool_release(&g->track_pool, g->track);
+        g->track = NULL;
+    }
+    track_t *track = track_pool_acquire(&g->track_pool);
+    if (track && !track_generate_into(track, &params)) {
+        track_pool_release(&g->track_pool, track);
+        track = NULL;
+    }
+
+    return game_sim_start_race_on_track(g, mode, num_laps, num_opponents, track, &params);
+}
+
+int game_sim_start_race_on_track(game_t *g, game_mode_t mode, int num_laps, int num_opponents,
+                                 track_t *track, const track_params_t *params) {
+    if (g->track && g->track != track) {
+        track_pool_release(&g->track_pool, g->track);
     }
-    game.track_params = track_default_params();
-    game.track_params.difficulty = menu_get_state()->selected_difficulty + 1;
-    game.track = track_generate(&game.track_params);
+    g->track = track;
+
+    /* Vehicles are placed on the track, there is no race without one */
+    if (!track) {
+        g->state = GAME_STATE_MENU;
+        return 0;
+    }
+
+    g->mode = mode;
+    g->num_laps = num_laps;
+    g->seed = params->seed;
+    g->race_time = 0;
+    g->countdown_timer = 3.0f;
+    g->countdown_value = 3;
+    g->track_params = *params;
 
     /* Spawn vehicles based on mode */
     switch (mode) {
         case MODE_AI_RACE:
-            spawn_vehicles(num_opponents + 1, 0);  /* AI only */
-            game.player_vehicle_index = -1;
+            spawn_vehicles(g, num_opponents + 1, 0);  /* AI only */
+            g->player_vehicle_index = -1;
             break;
 
         case MODE_SINGLE_TRACK:
-            spawn_vehicles(num_opponents, 1);  /* Player + AI */
+            spawn_vehicles(g, num_opponents, 1);  /* Player + AI */
             break;
 
         case MODE_TIME_TRIAL:
-            spawn_vehicles(0, 1);  /* Player only */
+            spawn_vehicles(g, 0, 1);  /* Player only */
             break;
 
         case MODE_GRAND_PRIX:
-            spawn_vehicles(num_opponents, 1);  /* Player + AI */
-            game.grand_prix.current_race = 0;
-            game.grand_prix.total_races = 4;
-            game.grand_prix.finished = 0;
-            memset(game.grand_prix.points, 0, sizeof(game.grand_prix.points));
+            spawn_vehicles(g, num_opponents, 1);  /* Player + AI */
+            g->grand_prix.current_race = 0;
+            g->grand_prix.total_races = 4;
+            g->grand_prix.finished = 0;
+            memset(g->grand_prix.points, 0, sizeof(g->grand_prix.points));
             break;
     }
 
-    game.state = GAME_STATE_COUNTDOWN;
+    if (g->recording) {
+        replay_setup_t setup;
+        setup.seed = g->seed;
+        setup.mode = (uint8_t)mode;
+        setup.num_laps = (uint8_t)num_laps;
+        setup.num_opponents = (uint8_t)num_opponents;
+        setup.vehicle_class = (uint8_t)g->player_vehicle_class;
+        setup.ai_difficulty = (uint8_t)g->ai_difficulty;
+        replay_begin(g->recording, &setup);
+    }
+    replay_reader_init(&g->input_reader);
+
+    g->state = GAME_STATE_COUNTDOWN;
+    return 1;
 }
 
-void game_end_race(void) {
-    game.state = GAME_STATE_FINISHED;
+void game_start_race(game_mode_t mode, int num_laps, int num_opponents) {
+    /* Settings picked in the menu */
+    menu_state_t *menu = menu_get_state();
+    game.player_vehicle_class = menu->selected_vehicle;
+    game.ai_difficulty = menu->selected_difficulty;
+
+    /* Time trials are run on the stored ghost's track, so it can be raced.
+     * With no AI the difficulty only shapes the track. */
+    if (mode == MODE_TIME_TRIAL && ghost_valid) {
+        game.ai_difficulty = ghost_replay.setup.ai_difficulty;
+        if (!game_sim_start_race(&game, mode, num_laps, num_opponents, ghost_replay.setup.seed)) {
+            game_return_to_menu();
+        }
+        return;
+    }
+
+    if (!next_track.active) {
+        if (!game_sim_start_race(&game, mode, num_laps, num_opponents, track_random_seed())) {
+            game_return_to_menu();
+        }
+        return;
+    }
+
+    /* Use the pregenerated track, waiting for it only if it isn't ready */
+    loading_race.mode = mode;
+    loading_race.num_laps = num_laps;
+    loading_race.num_opponents = num_opponents;
+    if (track_job_done()) {
+        start_loaded_race();
+    } else {
+        game.state = GAME_STATE_LOADING;
+    }
+}
+
+void game_sim_end_race(game_t *g) {
+    g->state = GAME_STATE_FINISHED;
 
     /* Calculate places */
-    for (int i = 0; i < game.vehicle_count; i++) {
+    for (int i = 0; i < g->vehicle_count; i++) {
         int place = 1;
-        for (int j = 0; j < game.vehicle_count; j++) {
+        for (int j = 0; j < g->vehicle_count; j++) {
             if (i != j) {
                 /* Compare progress */
-                float prog_i = game.vehicles[i]->current_lap + game.vehicles[i]->track_progress;
-                float prog_j = game.vehicles[j]->current_lap + game.vehicles[j]->track_progress;
+                float prog_i = g->vehicles[i]->current_lap + g->vehicles[i]->track_progress;
+                float prog_j = g->vehicles[j]->current_lap + g->vehicles[j]->track_progress;
                 if (prog_j > prog_i) place++;
             }
         }
-        game.vehicles[i]->place = place;
+        g->vehicles[i]->place = place;
     }
 
     /* Award Grand Prix points */
-    if (game.mode == MODE_GRAND_PRIX) {
+    if (g->mode == MODE_GRAND_PRIX) {
         int points_table[] = {10, 8, 6, 5, 4, 3, 2, 1};
-        for (int i = 0; i < game.vehicle_count; i++) {
-            int place = game.vehicles[i]->place - 1;
+        for (int i = 0; i < g->vehicle_count; i++) {
+            int place = g->vehicles[i]->place - 1;
             if (place < 8) {
-                game.grand_prix.points[i] += points_table[place];
+                g->grand_prix.points[i] += points_table[place];
             }
         }
     }
 
     /* Update best time for time trial */
-    if (game.mode == MODE_TIME_TRIAL && game.player_vehicle_index >= 0) {
-        float time = game.vehicles[game.player_vehicle_index]->total_time;
-        if (time < game.best_time) {
-            game.best_time = time;
+    if (g->mode == MODE_TIME_TRIAL && g->player_vehicle_index >= 0) {
+        float time = g->vehicles[g->player_vehicle_index]->total_time;
+        if (time < g->best_time) {
+            g->best_time = time;
         }
     }
 
-    game.state = GAME_STATE_RESULTS;
+    if (g->recording) {
+        vehicle_t *player = g->player_vehicle_index >= 0 ? g->vehicles[g->player_vehicle_index] : NULL;
+        replay_finish(g->recording, player && player->finished ? player->finish_time : -1.0f);
+    }
+
+    g->state = GAME_STATE_RESULTS;
+}
+
+void game_end_race(void) {
+    game_sim_end_race(&game);
 }
 
 void game_pause(void) {
@@ -237,11 +515,18 @@ void game_resume(void) {
 }
 
 void game_restart_race(void) {
-    game_start_race(game.mode, game.num_laps, game.vehicle_count - 1);
+    /* Same track again, so a time trial ghost can be raced. Starting a
+     * Grand Prix race resets the championship, keep it. */
+    grand_prix_t grand_prix = game.grand_prix;
+    if (!game_sim_start_race(&game, game.mode, game.num_laps, game.vehicle_count - 1, game.seed)) {
+        game_return_to_menu();
+        return;
+    }
+    game.grand_prix = grand_prix;
 }
 
 void game_return_to_menu(void) {
-    game_shutdown();
+    release_race();
     game.state = GAME_STATE_MENU;
     menu_set_screen(MENU_MAIN);
 }
@@ -265,25 +550,27 @@ void game_next_grand_prix_race(void) {
     }
 }
 
-void game_update_camera(float dt) {
-    if (game.vehicle_count == 0) return;
-
-    /* Determine which vehicle to follow */
-    int follow_idx = game.player_vehicle_index;
-    if (follow_idx < 0) {
-        /* AI race mode - follow lead vehicle */
-        follow_idx = 0;
-        float best_progress = 0;
-        for (int i = 0; i < game.vehicle_count; i++) {
-            float prog = game.vehicles[i]->current_lap + game.vehicles[i]->track_progress;
-            if (prog > best_progress) {
-                best_progress = prog;
-                follow_idx = i;
-            }
+/* The player, or the race leader in AI race mode */
+static int focus_vehicle_index(game_t *g) {
+    if (g->player_vehicle_index >= 0) return g->player_vehicle_index;
+
+    int follow_idx = 0;
+    float best_progress = 0;
+    for (int i = 0; i < g->vehicle_count; i++) {
+        float prog = g->vehicles[i]->current_lap + g->vehicles[i]->track_progress;
+        if (prog > best_progress) {
+            best_progress = prog;
+            follow_idx = i;
         }
     }
+    return follow_idx;
+}
 
-    vehicle_t *target = game.vehicles[follow_idx];
+void game_update_camera(float dt) {
+    if (game.vehicle_count == 0) return;
+
+    /* Follow the same car the AI keeps at full rate */
+    vehicle_t *target = game.vehicles[focus_vehicle_index(&game)];
     if (!target) return;
 
     /* Calculate desired camera position */
@@ -291,13 +578,13 @@ void game_update_camera(float dt) {
     vec3_t cam_offset = vec3_scale(forward, -game.camera_distance);
     cam_offset.y = game.camera_height;
 
-    vec3_t desired_pos = vec3_add(target->position, cam_offset);
+    vec3_t desired_pos = vec3_add(vehicle_get_position(target), cam_offset);
 
     /* Smooth camera movement */
     game.camera.position = vec3_lerp(game.camera.position, desired_pos, 5.0f * dt);
 
     /* Look at vehicle */
-    vec3_t look_target = target->position;
+    vec3_t look_target = vehicle_get_position(target);
     look_target.y += 1.0f;
     game.camera.target = vec3_lerp(game.camera.target, look_target, 8.0f * dt);
 
@@ -305,87 +592,266 @@ void game_update_camera(float dt) {
     camera_update(&game.camera);
 }
 
-static void update_countdown(float dt) {
-    game.countdown_timer -= dt;
+static void update_countdown(game_t *g, float dt) {
+    g->countdown_timer -= dt;
 
-    if (game.countdown_timer <= 2.0f && game.countdown_value == 3) {
-        game.countdown_value = 2;
+    if (g->countdown_timer <= 2.0f && g->countdown_value == 3) {
+        g->countdown_value = 2;
     }
-    if (game.countdown_timer <= 1.0f && game.countdown_value == 2) {
-        game.countdown_value = 1;
+    if (g->countdown_timer <= 1.0f && g->countdown_value == 2) {
+        g->countdown_value = 1;
     }
-    if (game.countdown_timer <= 0) {
-        game.countdown_value = 0;
-        game.state = GAME_STATE_RACING;
+    if (g->countdown_timer <= 0) {
+        g->countdown_value = 0;
+        g->state = GAME_STATE_RACING;
     }
 }
 
-static void update_racing(float dt) {
-    input_state_t *input = input_get_state(0);
-
-    /* Update player vehicle */
-    if (game.player_vehicle_index >= 0) {
-        vehicle_t *player = game.vehicles[game.player_vehicle_index];
-
-        float steering = input_get_steering(input);
-        float throttle = input_get_throttle(input);
-        float brake = input_get_brake(input);
-
-        vehicle_set_steering(player, steering);
-        vehicle_set_throttle(player, throttle);
-        vehicle_set_brake(player, brake);
-    }
-
-    /* Update all vehicles */
-    for (int i = 0; i < game.vehicle_count; i++) {
-        /* Update AI */
-        if (game.ai_controllers[i]) {
-            ai_update(game.ai_controllers[i], game.track, game.vehicles, game.vehicle_count, dt);
+static void update_racing(game_t *g, float dt) {
+    /* Update player vehicle, through the quantizer so a replay of the
+     * recorded controls drives exactly the same race */
+    if (g->player_vehicle_index >= 0 && (g->input || g->input_replay || g->tick_input)) {
+        vehicle_t *player = g->vehicles[g->player_vehicle_index];
+
+        replay_input_t controls;
+        if (g->tick_input) {
+            controls = *g->tick_input;
+        } else if (g->input_replay) {
+            replay_read_input(g->input_replay, &g->input_reader, &controls);
+        } else {
+            controls = replay_quantize_input(input_get_steering(g->input),
+                                             input_get_throttle(g->input),
+                                             input_get_brake(g->input));
         }
+        replay_apply_input(&controls, player);
 
-        /* Update vehicle physics */
-        vehicle_update(game.vehicles[i], game.track, dt);
+        if (g->recording) {
+            replay_record_tick(g->recording, &controls, vehicle_get_position(player),
+                               vehicle_get_rotation(player));
+        }
     }
 
-    /* Check vehicle collisions */
-    for (int i = 0; i < game.vehicle_count; i++) {
-        for (int j = i + 1; j < game.vehicle_count; j++) {
-            if (vehicle_check_collision(game.vehicles[i], game.vehicles[j])) {
-                vehicle_resolve_collision(game.vehicles[i], game.vehicles[j]);
-            }
+    /* Broad phase: which cars are near each other this tick */
+    prof_begin(PROF_COLLISION);
+    vec3_t positions[MAX_VEHICLES];
+    for (int i = 0; i < g->vehicle_count; i++) {
+        positions[i] = vehicle_get_position(g->vehicles[i]);
+    }
+    broadphase_update(&g->broadphase, positions, g->vehicle_count, AI_AVOID_RADIUS + NEIGHBOR_SLACK);
+    prof_end(PROF_COLLISION);
+
+    /* AI decisions, all from the same start-of-tick state. Cars away from
+     * the focus car only decide some ticks and keep their controls */
+    prof_begin(PROF_AI);
+    int neighbor_counts[MAX_VEHICLES];
+    for (int i = 0; i < g->vehicle_count; i++) {
+        broadphase_neighbors(&g->broadphase, i, &neighbor_counts[i]);
+    }
+    int due[MAX_VEHICLES];
+    float due_dt[MAX_VEHICLES];
+    int due_count = ai_scheduler_plan(&g->ai_scheduler, g->ai_controllers, g->vehicles, neighbor_counts,
+                                      g->vehicle_count, focus_vehicle_index(g), dt, due, due_dt);
+    for (int k = 0; k < due_count; k++) {
+        int i = due[k];
+        int count;
+        const int *neighbors = broadphase_neighbors(&g->broadphase, i, &count);
+        ai_update(g->ai_controllers[i], g->track, g->vehicles, neighbors, count, due_dt[k]);
+    }
+    prof_end(PROF_AI);
+
+    /* Vehicle physics for the whole field in one pass */
+    prof_begin(PROF_VEHICLE);
+    vehicle_update_all(&g->vehicle_pool, g->track, dt);
+    prof_end(PROF_VEHICLE);
+
+    /* Check vehicle collisions among broad phase pairs */
+    prof_begin(PROF_COLLISION);
+    for (int p = 0; p < g->broadphase.pair_count; p++) {
+        vehicle_t *a = g->vehicles[g->broadphase.pairs[p].a];
+        vehicle_t *b = g->vehicles[g->broadphase.pairs[p].b];
+        if (vehicle_check_collision(a, b)) {
+            vehicle_resolve_collision(a, b);
         }
     }
+    prof_end(PROF_COLLISION);
 
     /* Update race time */
-    game.race_time += dt;
+    g->race_time += dt;
 
     /* Check for race finish */
     int all_finished = 1;
-    for (int i = 0; i < game.vehicle_count; i++) {
-        if (!game.vehicles[i]->finished) {
+    for (int i = 0; i < g->vehicle_count; i++) {
+        if (!g->vehicles[i]->finished) {
             all_finished = 0;
             break;
         }
     }
 
     /* End race when player finishes (or all in AI mode) */
-    if (game.player_vehicle_index >= 0) {
-        if (game.vehicles[game.player_vehicle_index]->finished) {
-            game_end_race();
+    if (g->player_vehicle_index >= 0) {
+        if (g->vehicles[g->player_vehicle_index]->finished) {
+            game_sim_end_race(g);
         }
     } else if (all_finished) {
-        game_end_race();
+        game_sim_end_race(g);
+    }
+}
+
+void game_sim_save(const game_t *g, sim_snapshot_t *snap) {
+    snap->seed = g->seed;
+    snap->vehicle_count = g->vehicle_count;
+    snap->player_vehicle_index = g->player_vehicle_index;
+
+    snap->state = g->state;
+    snap->race_time = g->race_time;
+    snap->countdown_timer = g->countdown_timer;
+    snap->countdown_value = g->countdown_value;
+    snap->best_time = g->best_time;
+    snap->grand_prix = g->grand_prix;
+
+    memcpy(snap->pool, &g->vehicle_pool, VEHICLE_POOL_SIM_BYTES);
+    for (int i = 0; i < g->vehicle_count; i++) {
+        memcpy(snap->vehicles[i], (const char *)g->vehicles[i] + VEHICLE_SIM_OFFSET, VEHICLE_SIM_BYTES);
+        if (g->ai_controllers[i]) {
+            memcpy(snap->ai[i], (const char *)g->ai_controllers[i] + AI_SIM_OFFSET, AI_SIM_BYTES);
+        }
+    }
+    snap->ai_scheduler = g->ai_scheduler;
+    snap->input_reader = g->input_reader;
+}
+
+int game_sim_restore(game_t *g, const sim_snapshot_t *snap) {
+    if (snap->seed != g->seed || snap->vehicle_count != g->vehicle_count ||
+        snap->player_vehicle_index != g->player_vehicle_index) {
+        return 0;
+    }
+
+    g->state = snap->state;
+    g->race_time = snap->race_time;
+    g->countdown_timer = snap->countdown_timer;
+    g->countdown_value = snap->countdown_value;
+    g->best_time = snap->best_time;
+    g->grand_prix = snap->grand_prix;
+
+    memcpy(&g->vehicle_pool, snap->pool, VEHICLE_POOL_SIM_BYTES);
+    for (int i = 0; i < g->vehicle_count; i++) {
+        memcpy((char *)g->vehicles[i] + VEHICLE_SIM_OFFSET, snap->vehicles[i], VEHICLE_SIM_BYTES);
+        if (g->ai_controllers[i]) {
+            memcpy((char *)g->ai_controllers[i] + AI_SIM_OFFSET, snap->ai[i], AI_SIM_BYTES);
+        }
+    }
+    g->ai_scheduler = snap->ai_scheduler;
+    g->input_reader = snap->input_reader;
+    return 1;
+}
+
+void game_sim_update(game_t *g, float dt) {
+    switch (g->state) {
+        case GAME_STATE_COUNTDOWN:
+            update_countdown(g, dt);
+            break;
+
+        case GAME_STATE_RACING:
+            update_racing(g, dt);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Music stream health, printed after the frame profile */
+static void dump_stream_stats(FILE *out) {
+    const audio_stream_stats_t *st = audio_get_stream_stats();
+    fprintf(out, "music stream: %u underruns (%u bytes), %u blocks read, %u errors\n",
+            (unsigned)st->underruns, (unsigned)st->underrun_bytes,
+            (unsigned)st->blocks_read, (unsigned)st->read_errors);
+    fprintf(out, "  slowest read %u us, low water %u bytes over %u polls\n",
+            (unsigned)st->max_read_us, (unsigned)st->low_water_bytes, (unsigned)st->polls);
+}
+
+/* AI decision scheduling for the current race */
+static void dump_ai_stats(FILE *out) {
+    const ai_scheduler_t *s = &game.ai_scheduler;
+    fprintf(out, "ai: %u decisions over %u ticks, %u carried over, %u deferred by budget\n",
+            (unsigned)s->decisions, (unsigned)s->tick, (unsigned)s->skipped, (unsigned)s->deferred);
+}
+
+/* Keep the finished race: a new time trial best becomes the ghost, and
+ * native builds write every race out so it can be replayed headless */
+static void store_race_replay(void) {
+#ifndef DREAMCAST
+    replay_save(&race_replay, 1, REPLAY_FILE);
+#endif
+
+    if (game.mode != MODE_TIME_TRIAL || race_replay.finish_time < 0) return;
+    if (ghost_valid && ghost_replay.setup.seed == race_replay.setup.seed &&
+        ghost_replay.finish_time <= race_replay.finish_time) {
+        return;
+    }
+
+    memcpy(&ghost_replay, &race_replay, sizeof(replay_t));
+    ghost_valid = 1;
+#ifdef DREAMCAST
+    replay_save_vmu(&ghost_replay);
+#else
+    replay_save(&ghost_replay, 0, GHOST_FILE);
+#endif
+}
+
+/* Profiler report: dcload console on Dreamcast, a file on native */
+static void prof_dump_report(void) {
+#ifdef DREAMCAST
+    prof_dump(stdout);
+    dump_stream_stats(stdout);
+    dump_ai_stats(stdout);
+#else
+    FILE *out = fopen("retroracer_profile.txt", "w");
+    if (out) {
+        prof_dump(out);
+        dump_stream_stats(out);
+        dump_ai_stats(out);
+        fclose(out);
+        printf("Profile written to retroracer_profile.txt\n");
     }
+#endif
+}
 
-    /* Pause game */
-    if (input_button_pressed(input, BTN_START)) {
-        game_pause();
+static void save_prev_poses(void) {
+    for (int i = 0; i < game.vehicle_count; i++) {
+        vehicle_get_pose(game.vehicles[i], &prev_poses.vehicles[i]);
     }
+    prev_poses.vehicle_count = game.vehicle_count;
+    prev_poses.camera_position = game.camera.position;
+    prev_poses.camera_target = game.camera.target;
 }
 
 void game_update(float dt) {
+    game_state_t prev_state = game.state;
     delta_time = dt;
+    save_prev_poses();
+
+    prof_begin(PROF_INPUT);
     input_update();
+    prof_end(PROF_INPUT);
+    prof_input_sampled(input_get_state(0)->sample_time_us);
+
+    /* Music stream poll, the disc reads happen on the feeder thread */
+    audio_update();
+
+    /* Profiler: Y toggles the overlay, X dumps the statistics,
+     * Down + X captures the next frame's PVR commands instead */
+    input_state_t *pad = input_get_state(0);
+    if (input_button_pressed(pad, BTN_Y)) {
+        prof_toggle_overlay();
+    }
+    if (input_button_pressed(pad, BTN_X)) {
+        if (input_button_held(pad, BTN_DPAD_DOWN)) {
+            pvrcap_request(PVRCAP_FILE);
+        } else {
+            prof_dump_report();
+        }
+    }
 
     switch (game.state) {
         case GAME_STATE_MENU:
@@ -398,27 +864,61 @@ void game_update(float dt) {
             break;
 
         case GAME_STATE_COUNTDOWN:
-            update_countdown(dt);
+            game_sim_update(&game, dt);
             game_update_camera(dt);
             break;
 
         case GAME_STATE_RACING:
-            update_racing(dt);
+            game_sim_update(&game, dt);
+
+            if (game.state == GAME_STATE_RESULTS) {
+                store_race_replay();
+
+                /* Build the next track while the results are read */
+                vehicle_t *player = game.player_vehicle_index >= 0 ?
+                    game.vehicles[game.player_vehicle_index] : NULL;
+                menu_show_results(game.race_time, game.best_time, player ? player->place : 0);
+                track_job_start(track_random_seed());
+                break;
+            }
+
+            /* Pause game */
+            if (input_button_pressed(game.input, BTN_START)) {
+                game_pause();
+            }
+
             game_update_camera(dt);
             break;
 
+        case GAME_STATE_LOADING:
+            if (track_job_done()) {
+                start_loaded_race();
+            }
+            break;
+
         case GAME_STATE_PAUSED:
             menu_update(input_get_state(0), dt);
             if (!menu_is_active()) {
-                game_resume();
+                if (menu_take_action() == MENU_ACTION_RESTART) {
+                    game_restart_race();
+                } else {
+                    game_resume();
+                }
             }
             break;
 
         case GAME_STATE_RESULTS:
             menu_update(input_get_state(0), dt);
             if (!menu_is_active()) {
-                if (game.mode == MODE_GRAND_PRIX && !game.grand_prix.finished) {
+                /* A Grand Prix race has scored its points, it only continues */
+                menu_action_t action = menu_take_action();
+                if (action == MENU_ACTION_RESTART && game.mode != MODE_GRAND_PRIX) {
+                    game_restart_race();
+                } else if (game.mode == MODE_GRAND_PRIX && !game.grand_prix.finished) {
                     game_next_grand_prix_race();
+                } else if (action == MENU_ACTION_CONTINUE) {
+                    /* Next race on the track built while the results were up */
+                    game_start_race(game.mode, game.num_laps, game.vehicle_count - 1);
                 } else {
                     game_return_to_menu();
                 }
@@ -428,41 +928,71 @@ void game_update(float dt) {
         default:
             break;
     }
+
+    /* A new race starts from where its cars were placed */
+    if (game.state == GAME_STATE_COUNTDOWN && prev_state != GAME_STATE_COUNTDOWN) {
+        save_prev_poses();
+    }
 }
 
-static void render_hud(void) {
-    char buf[64];
+/* HUD strings, re-formatted only when the value they show changes */
+static struct {
+    render_text_t time, speed, lap, position, best, mode, race;
+    render_text_t cam, target, car0, visible;
+    render_text_t countdown;
+} hud_text;
+
+static int round_to_int(float v) {
+    return (int)floorf(v + 0.5f);
+}
+
+/* Race clock as whole centiseconds, the resolution the HUD shows */
+static int time_centis(float t) {
+    int mins = (int)(t / 60);
+    int secs = (int)t % 60;
+    int msecs = (int)((t - (int)t) * 100);
+    return mins * 6000 + secs * 100 + msecs;
+}
+
+static void format_time(render_text_t *t, const char *label, float seconds) {
+    int cs = time_centis(seconds);
+    if (render_text_stale(t, cs, 0, 0, 0)) {
+        snprintf(t->text, sizeof(t->text), "%s: %02d:%02d.%02d", label, cs / 6000, (cs / 100) % 60, cs % 100);
+    }
+}
 
+static void render_hud(void) {
     /* Race time */
-    int mins = (int)(game.race_time / 60);
-    int secs = (int)game.race_time % 60;
-    int msecs = (int)((game.race_time - (int)game.race_time) * 100);
-    sprintf(buf, "Time: %02d:%02d.%02d", mins, secs, msecs);
-    render_draw_text(20, 20, COLOR_WHITE, buf);
+    format_time(&hud_text.time, "Time", game.race_time);
+    render_draw_text(20, 20, COLOR_WHITE, hud_text.time.text);
 
     /* Player info */
     if (game.player_vehicle_index >= 0) {
         vehicle_t *player = game.vehicles[game.player_vehicle_index];
 
         /* Speed */
-        sprintf(buf, "Speed: %.0f km/h", player->speed * 3.6f);
-        render_draw_text(20, 50, COLOR_WHITE, buf);
+        int kmh = round_to_int(vehicle_get_speed(player) * 3.6f);
+        if (render_text_stale(&hud_text.speed, kmh, 0, 0, 0)) {
+            snprintf(hud_text.speed.text, RENDER_TEXT_LEN, "Speed: %d km/h", kmh);
+        }
+        render_draw_text(20, 50, COLOR_WHITE, hud_text.speed.text);
 
         /* Lap */
-        sprintf(buf, "Lap: %d / %d", player->current_lap + 1, player->total_laps);
-        render_draw_text(20, 80, COLOR_WHITE, buf);
+        if (render_text_stale(&hud_text.lap, player->current_lap + 1, player->total_laps, 0, 0)) {
+            snprintf(hud_text.lap.text, RENDER_TEXT_LEN, "Lap: %d / %d", player->current_lap + 1, player->total_laps);
+        }
+        render_draw_text(20, 80, COLOR_WHITE, hud_text.lap.text);
 
         /* Position */
-        sprintf(buf, "Position: %d / %d", player->place, game.vehicle_count);
-        render_draw_text(20, 110, COLOR_WHITE, buf);
+        if (render_text_stale(&hud_text.position, player->place, game.vehicle_count, 0, 0)) {
+            snprintf(hud_text.position.text, RENDER_TEXT_LEN, "Position: %d / %d", player->place, game.vehicle_count);
+        }
+        render_draw_text(20, 110, COLOR_WHITE, hud_text.position.text);
 
         /* Best lap */
         if (player->best_lap_time < 999999.0f) {
-            mins = (int)(player->best_lap_time / 60);
-            secs = (int)player->best_lap_time % 60;
-            msecs = (int)((player->best_lap_time - (int)player->best_lap_time) * 100);
-            sprintf(buf, "Best: %02d:%02d.%02d", mins, secs, msecs);
-            render_draw_text(500, 20, COLOR_YELLOW, buf);
+            format_time(&hud_text.best, "Best", player->best_lap_time);
+            render_draw_text(500, 20, COLOR_YELLOW, hud_text.best.text);
         }
     } else {
         /* AI race mode - show leader */
@@ -470,87 +1000,178 @@ static void render_hud(void) {
     }
 
     /* Mode indicator */
-    sprintf(buf, "Mode: %s", menu_mode_name(game.mode));
-    render_draw_text(500, 50, COLOR_GRAY, buf);
+    if (render_text_stale(&hud_text.mode, game.mode, 0, 0, 0)) {
+        snprintf(hud_text.mode.text, RENDER_TEXT_LEN, "Mode: %s", menu_mode_name(game.mode));
+    }
+    render_draw_text(500, 50, COLOR_GRAY, hud_text.mode.text);
 
     /* Grand Prix info */
     if (game.mode == MODE_GRAND_PRIX) {
-        sprintf(buf, "Race %d of %d", game.grand_prix.current_race + 1, game.grand_prix.total_races);
-        render_draw_text(500, 80, COLOR_GRAY, buf);
+        int race = game.grand_prix.current_race + 1;
+        if (render_text_stale(&hud_text.race, race, game.grand_prix.total_races, 0, 0)) {
+            snprintf(hud_text.race.text, RENDER_TEXT_LEN, "Race %d of %d", race, game.grand_prix.total_races);
+        }
+        render_draw_text(500, 80, COLOR_GRAY, hud_text.race.text);
     }
 
-    /* DEBUG: Show camera and position info */
-    sprintf(buf, "Cam: %.0f,%.0f,%.0f", game.camera.position.x, game.camera.position.y, game.camera.position.z);
-    render_draw_text(20, 420, COLOR_CYAN, buf);
-    sprintf(buf, "Tgt: %.0f,%.0f,%.0f", game.camera.target.x, game.camera.target.y, game.camera.target.z);
-    render_draw_text(20, 440, COLOR_CYAN, buf);
+}
+
+/* Whole-unit position readout, e.g. "Cam: 12,0,-40" */
+static void format_position(render_text_t *t, const char *label, vec3_t p) {
+    int x = round_to_int(p.x);
+    int y = round_to_int(p.y);
+    int z = round_to_int(p.z);
+    if (render_text_stale(t, x, y, z, 0)) {
+        snprintf(t->text, sizeof(t->text), "%s: %d,%d,%d", label, x, y, z);
+    }
+}
+
+/* Camera, position and culling readouts, shown with the profiler overlay */
+static void render_debug_info(void) {
+    format_position(&hud_text.cam, "Cam", game.camera.position);
+    render_draw_text(20, 420, COLOR_CYAN, hud_text.cam.text);
+    format_position(&hud_text.target, "Tgt", game.camera.target);
+    render_draw_text(20, 440, COLOR_CYAN, hud_text.target.text);
     if (game.vehicle_count > 0 && game.vehicles[0]) {
-        sprintf(buf, "Car0: %.0f,%.0f,%.0f", game.vehicles[0]->position.x, game.vehicles[0]->position.y, game.vehicles[0]->position.z);
-        render_draw_text(20, 460, COLOR_CYAN, buf);
+        format_position(&hud_text.car0, "Car0", vehicle_get_position(game.vehicles[0]));
+        render_draw_text(20, 460, COLOR_CYAN, hud_text.car0.text);
     }
+
+    /* Culling counters for this frame */
+    render_cull_stats_t *cull = render_get_cull_stats();
+    if (render_text_stale(&hud_text.visible, cull->segments_visible, cull->segments_total,
+                          cull->vehicles_visible, cull->vehicles_total)) {
+        snprintf(hud_text.visible.text, RENDER_TEXT_LEN, "Vis: seg %d/%d car %d/%d",
+                 cull->segments_visible, cull->segments_total,
+                 cull->vehicles_visible, cull->vehicles_total);
+    }
+    render_draw_text(20, 400, COLOR_CYAN, hud_text.visible.text);
 }
 
 static void render_countdown(void) {
-    char buf[16];
-
     /* Always show "START" during countdown */
     if (game.countdown_value > 0) {
         render_draw_text(270, 160, COLOR_WHITE, "START");
-        sprintf(buf, "%d", game.countdown_value);
-        render_draw_text(310, 220, COLOR_YELLOW, buf);
+        if (render_text_stale(&hud_text.countdown, game.countdown_value, 0, 0, 0)) {
+            snprintf(hud_text.countdown.text, RENDER_TEXT_LEN, "%d", game.countdown_value);
+        }
+        render_draw_text(310, 220, COLOR_YELLOW, hud_text.countdown.text);
     } else {
         render_draw_text(295, 200, COLOR_GREEN, "GO!");
     }
 }
 
-void game_render(void) {
+/* Camera alpha of the way from its pose before the last tick */
+static void blend_camera(float alpha, camera_t *view) {
+    *view = game.camera;
+    view->position = vec3_lerp(prev_poses.camera_position, game.camera.position, alpha);
+    view->target = vec3_lerp(prev_poses.camera_target, game.camera.target, alpha);
+    view->cull_distance *= render_get_lod()->distance_scale;
+    camera_update(view);
+}
+
+/* 3D scene into the opaque list */
+static void render_scene(camera_t *view, float alpha) {
+    render_begin_frame();
+    render_clear(COLOR_SKY);  /* Sky as background - above horizon */
+
+    prof_begin(PROF_TRACK_RENDER);
+    if (game.track) {
+        track_render(game.track, view);
+    }
+    prof_end(PROF_TRACK_RENDER);
+
+    prof_begin(PROF_VEHICLE_RENDER);
+    for (int i = 0; i < game.vehicle_count; i++) {
+        vehicle_pose_t pose;
+        vehicle_get_pose(game.vehicles[i], &pose);
+        if (i < prev_poses.vehicle_count) {
+            vehicle_pose_lerp(&prev_poses.vehicles[i], &pose, alpha, &pose);
+        }
+        vehicle_render_pose(game.vehicles[i], &pose, view);
+    }
+    prof_end(PROF_VEHICLE_RENDER);
+
+    render_end_frame();
+}
+
+/* Time trial ghost, drawn see-through in the transparent list */
+static void render_ghost(camera_t *view, float alpha) {
+    if (!ghost_valid || game.mode != MODE_TIME_TRIAL || ghost_replay.setup.seed != game.seed) return;
+
+    /* Race time of the blended car poses */
+    float t = game.race_time;
+    if (game.state == GAME_STATE_RACING) {
+        t -= (1.0f - alpha) * FRAME_TIME;
+        if (t < 0) t = 0;
+    }
+
+    vec3_t pos;
+    float heading;
+    if (!replay_ghost_sample(&ghost_replay, &ghost_cursor, t, &pos, &heading)) return;
+
+    if (!ghost_mesh) {
+        ghost_mesh = mesh_create_vehicle(GHOST_COLOR);
+        if (!ghost_mesh) return;
+    }
+
+    render_set_camera(view);
+    pos.y += 0.3f;
+    if (!render_sphere_visible(pos, GHOST_BOUND_RADIUS)) return;
+
+    float s, c;
+    fast_sincos(heading, &s, &c);
+    mat4_t transform;
+    mat4_translate_into(&transform, pos.x, pos.y, pos.z);
+    mat4_rotate_y_by_sincos(&transform, s, c);
+    render_draw_mesh(ghost_mesh, &transform);
+}
+
+void game_render(float alpha) {
+    camera_t view;
+    blend_camera(alpha, &view);
+
     switch (game.state) {
         case GAME_STATE_MENU:
-            /* Menu renders directly to VRAM, no PVR */
             menu_render();
             break;
 
         case GAME_STATE_PAUSED:
         case GAME_STATE_RESULTS:
-            /* Render game in background, then menu overlay */
-            render_begin_frame();
-            render_clear(COLOR_SKY);
-            if (game.track) {
-                track_render(game.track, &game.camera);
-            }
-            for (int i = 0; i < game.vehicle_count; i++) {
-                vehicle_render(game.vehicles[i], &game.camera);
-            }
-            render_end_frame();
-            /* Now draw menu on top */
-            menu_render();
+            /* Race stays on screen behind the menu */
+            render_scene(&view, alpha);
+            menu_render_over_scene();
+            break;
+
+        case GAME_STATE_LOADING:
+            /* Last race stays on screen until the next track is ready */
+            render_scene(&view, alpha);
+            render_begin_hud();
+            render_draw_text(272, 230, COLOR_WHITE, "Loading...");
+            render_end_hud();
             break;
 
         case GAME_STATE_COUNTDOWN:
         case GAME_STATE_RACING:
         case GAME_STATE_FINISHED:
-            /* Render 3D scene */
-            render_begin_frame();
-            render_clear(COLOR_SKY);  /* Sky as background - above horizon */
-
-            if (game.track) {
-                track_render(game.track, &game.camera);
-            }
-
-            for (int i = 0; i < game.vehicle_count; i++) {
-                vehicle_render(game.vehicles[i], &game.camera);
-            }
-
-            render_end_frame();
+            render_scene(&view, alpha);
 
             /* Render HUD using PVR transparent polygon list */
+            prof_begin(PROF_HUD);
             render_begin_hud();
+            render_ghost(&view, alpha);
             render_hud();
 
             /* Countdown overlay */
             if (game.state == GAME_STATE_COUNTDOWN) {
                 render_countdown();
             }
+
+            if (prof_overlay_visible()) {
+                render_debug_info();
+                prof_render_overlay();
+            }
+            prof_end(PROF_HUD);
             render_end_hud();
             break;
 
@@ -0,0 +1,377 @@
+/*
+ * RetroRacer - Headless Simulation Implementation
+ * Batch AI races without rendering, for tuning and regression runs
+ */
+
+#include "headless.h"
+#include "game.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define MAX_JOBS 256
+
+/* Growable text buffer for one race result */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} text_buf_t;
+
+/* State shared by the workers, guarded by lock */
+typedef struct {
+    headless_config_t *config;
+    pthread_mutex_t lock;
+    int next_race;          /* Next race to hand out */
+    int next_write;         /* Next race to write, keeps output in order */
+    char **results;
+    uint64_t total_ticks;
+    int timeouts;
+} batch_t;
+
+static uint64_t wall_time_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int default_jobs(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0) return cpus > MAX_JOBS ? MAX_JOBS : (int)cpus;
+#endif
+    return 1;
+}
+
+static void buf_printf(text_buf_t *buf, const char *fmt, ...) {
+    va_list args;
+
+    for (;;) {
+        size_t room = buf->cap - buf->len;
+
+        va_start(args, fmt);
+        int n = vsnprintf(buf->data ? buf->data + buf->len : NULL, room, fmt, args);
+        va_end(args);
+
+        if (n < 0) return;
+        if ((size_t)n < room) {
+            buf->len += n;
+            return;
+        }
+
+        size_t cap = buf->cap ? buf->cap * 2 : 1024;
+        while (cap - buf->len <= (size_t)n) cap *= 2;
+        char *data = (char *)realloc(buf->data, cap);
+        if (!data) return;
+        buf->data = data;
+        buf->cap = cap;
+    }
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s --headless [options]\n"
+        "  --races N        races to run (default 1)\n"
+        "  --seed S         seed of the first race (default 1)\n"
+        "  --laps L         laps per race (default 3)\n"
+        "  --vehicles V     AI vehicles per race, 1-%d (default 6)\n"
+        "  --difficulty D   0 easy .. 3 expert (default 1)\n"
+        "  --max-time T     race time limit in seconds (default 600)\n"
+        "  --jobs J         worker threads (default: all cores)\n"
+        "  --out FILE       write results to FILE instead of stdout\n"
+        "  --replay FILE    re-run a race recorded by the game (retroracer_replay.rrp)\n",
+        prog, MAX_VEHICLES);
+}
+
+int headless_requested(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) return 1;
+    }
+    return 0;
+}
+
+int headless_parse_args(headless_config_t *config, int argc, char *argv[]) {
+    config->races = 1;
+    config->seed = 1;
+    config->laps = 3;
+    config->vehicles = 6;
+    config->difficulty = AI_MEDIUM;
+    config->max_time = 600.0f;
+    config->jobs = default_jobs();
+    config->out = stdout;
+    config->replay = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--headless") == 0) continue;
+
+        if (!val) {
+            print_usage(argv[0]);
+            return 0;
+        }
+
+        if (strcmp(arg, "--races") == 0) {
+            config->races = atoi(val);
+        } else if (strcmp(arg, "--seed") == 0) {
+            config->seed = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcmp(arg, "--laps") == 0) {
+            config->laps = atoi(val);
+        } else if (strcmp(arg, "--vehicles") == 0) {
+            config->vehicles = atoi(val);
+        } else if (strcmp(arg, "--difficulty") == 0) {
+            config->difficulty = atoi(val);
+        } else if (strcmp(arg, "--max-time") == 0) {
+            config->max_time = (float)atof(val);
+        } else if (strcmp(arg, "--jobs") == 0) {
+            config->jobs = atoi(val);
+        } else if (strcmp(arg, "--replay") == 0) {
+            config->replay = val;
+        } else if (strcmp(arg, "--out") == 0) {
+            config->out = fopen(val, "w");
+            if (!config->out) {
+                fprintf(stderr, "Cannot open %s\n", val);
+                return 0;
+            }
+        } else {
+            print_usage(argv[0]);
+            return 0;
+        }
+        i++;
+    }
+
+    if (config->races < 1 || config->laps < 1 ||
+        config->vehicles < 1 || config->vehicles > MAX_VEHICLES ||
+        config->difficulty < AI_EASY || config->difficulty > AI_EXPERT ||
+        config->max_time <= 0 || config->jobs < 1 || config->jobs > MAX_JOBS) {
+        print_usage(argv[0]);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Format one race as a JSON line, vehicles in finish order */
+static void format_result(text_buf_t *buf, int race, game_t *game, int ticks, int timed_out) {
+    buf_printf(buf, "{\"race\":%d,\"seed\":%u,\"track_length\":%.2f,\"laps\":%d,"
+                    "\"ticks\":%d,\"race_time\":%.4f,\"timed_out\":%d,\"results\":[",
+               race, game->seed, game->track->total_length, game->num_laps,
+               ticks, game->race_time, timed_out);
+
+    int written = 0;
+    for (int place = 1; place <= game->vehicle_count; place++) {
+        for (int i = 0; i < game->vehicle_count; i++) {
+            vehicle_t *v = game->vehicles[i];
+            if (v->place != place) continue;
+
+            buf_printf(buf, "%s{\"place\":%d,\"vehicle\":%d,\"class\":\"%s\",\"finished\":%d,"
+                            "\"finish_time\":%.4f,\"laps_completed\":%d,\"progress\":%.4f,"
+                            "\"off_track_time\":%.4f,\"lap_times\":[",
+                       written ? "," : "", v->place, i, vehicle_class_name(v->vehicle_class),
+                       v->finished, v->finished ? v->finish_time : -1.0f,
+                       v->current_lap, v->current_lap + v->track_progress,
+                       v->off_track_time);
+
+            int laps = v->current_lap < VEHICLE_MAX_LAPS ? v->current_lap : VEHICLE_MAX_LAPS;
+            for (int lap = 0; lap < laps; lap++) {
+                buf_printf(buf, "%s%.4f", lap ? "," : "", v->lap_times[lap]);
+            }
+            buf_printf(buf, "]}");
+            written++;
+        }
+    }
+
+    buf_printf(buf, "]}\n");
+}
+
+/* Simulate one race to the end in game, step as fast as possible.
+ * Returns the ticks taken, or -1 if the race could not start. */
+static int run_race(game_t *game, headless_config_t *config, uint32_t seed, int *timed_out) {
+    *timed_out = 0;
+    if (!game_sim_start_race(game, MODE_AI_RACE, config->laps, config->vehicles - 1, seed)) {
+        return -1;
+    }
+
+    int ticks = 0;
+    while (game->state != GAME_STATE_RESULTS) {
+        game_sim_update(game, FRAME_TIME);
+        ticks++;
+
+        if (game->state == GAME_STATE_RACING && game->race_time >= config->max_time) {
+            game_sim_end_race(game);
+            *timed_out = 1;
+        }
+    }
+
+    return ticks;
+}
+
+static void *worker_main(void *arg) {
+    batch_t *batch = (batch_t *)arg;
+    headless_config_t *config = batch->config;
+
+    game_t *game = (game_t *)malloc(sizeof(game_t));
+    if (!game) return NULL;
+    game_sim_init(game);
+    game->ai_difficulty = config->difficulty;
+
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        int race = batch->next_race++;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (race >= config->races) break;
+
+        int timed_out;
+        int ticks = run_race(game, config, config->seed + (uint32_t)race, &timed_out);
+
+        text_buf_t buf = {NULL, 0, 0};
+        if (ticks < 0) {
+            buf_printf(&buf, "{\"race\":%d,\"seed\":%u,\"error\":\"no track\"}\n",
+                       race, config->seed + (uint32_t)race);
+            ticks = 0;
+        } else {
+            format_result(&buf, race, game, ticks, timed_out);
+        }
+
+        /* Publish, then write every result that is now next in order */
+        pthread_mutex_lock(&batch->lock);
+        batch->results[race] = buf.data;
+        batch->total_ticks += ticks;
+        batch->timeouts += timed_out;
+        while (batch->next_write < config->races && batch->results[batch->next_write]) {
+            fputs(batch->results[batch->next_write], config->out);
+            free(batch->results[batch->next_write]);
+            batch->results[batch->next_write] = NULL;
+            batch->next_write++;
+        }
+        pthread_mutex_unlock(&batch->lock);
+    }
+
+    game_sim_shutdown(game);
+    free(game);
+    return NULL;
+}
+
+/* Re-run one recorded race with its player controls from the replay */
+static int run_replay(headless_config_t *config) {
+    replay_t *replay = (replay_t *)malloc(sizeof(replay_t));
+    replay_t *check = (replay_t *)malloc(sizeof(replay_t));
+    game_t *game = (game_t *)malloc(sizeof(game_t));
+    if (!replay || !check || !game || !replay_load(replay, config->replay)) {
+        fprintf(stderr, "Cannot read replay %s\n", config->replay);
+        free(replay);
+        free(check);
+        free(game);
+        return 1;
+    }
+    if (!(replay->flags & REPLAY_HAS_INPUTS) || (replay->flags & REPLAY_INPUTS_FULL)) {
+        fprintf(stderr, "headless: %s has no complete input stream, the replay may diverge\n",
+                config->replay);
+    }
+
+    const replay_setup_t *setup = &replay->setup;
+    game_sim_init(game);
+    game->ai_difficulty = setup->ai_difficulty;
+    game->player_vehicle_class = setup->vehicle_class;
+    game->input_replay = replay;
+    game->recording = check;
+    if (!game_sim_start_race(game, (game_mode_t)setup->mode, setup->num_laps, setup->num_opponents, setup->seed)) {
+        fprintf(stderr, "headless: cannot generate the track for seed %u\n", setup->seed);
+        game_sim_shutdown(game);
+        free(replay);
+        free(check);
+        free(game);
+        if (config->out != stdout) {
+            fclose(config->out);
+        }
+        return 1;
+    }
+
+    int ticks = 0;
+    int timed_out = 0;
+    while (game->state != GAME_STATE_RESULTS) {
+        game_sim_update(game, FRAME_TIME);
+        ticks++;
+
+        /* Stop where the recording stopped */
+        if (game->state == GAME_STATE_RACING &&
+            (check->ticks >= replay->ticks || game->race_time >= config->max_time)) {
+            game_sim_end_race(game);
+            timed_out = 1;
+        }
+    }
+
+    text_buf_t buf = {NULL, 0, 0};
+    format_result(&buf, 0, game, ticks, timed_out);
+    if (buf.data) fputs(buf.data, config->out);
+    free(buf.data);
+
+    /* Reproduced if the player's path (the pose keyframes) and finish time
+     * came out the same */
+    int match = check->finish_time == replay->finish_time && check->pose_len == replay->pose_len &&
+                memcmp(check->poses, replay->poses, replay->pose_len) == 0;
+    fprintf(stderr, "headless: replay of seed %u, recorded finish %.4f, replayed %.4f: %s\n",
+            setup->seed, replay->finish_time, check->finish_time, match ? "match" : "MISMATCH");
+
+    game_sim_shutdown(game);
+    free(game);
+    free(check);
+    free(replay);
+    if (config->out != stdout) {
+        fclose(config->out);
+    }
+    return match ? 0 : 1;
+}
+
+int headless_run(headless_config_t *config) {
+    if (config->replay) {
+        return run_replay(config);
+    }
+
+    batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.config = config;
+    batch.results = (char **)calloc(config->races, sizeof(char *));
+    if (!batch.results) return 1;
+    pthread_mutex_init(&batch.lock, NULL);
+
+    int jobs = config->jobs < config->races ? config->jobs : config->races;
+    pthread_t threads[MAX_JOBS];
+
+    uint64_t start_us = wall_time_us();
+
+    int started = 0;
+    for (int i = 0; i < jobs; i++) {
+        if (pthread_create(&threads[i], NULL, worker_main, &batch) != 0) break;
+        started++;
+    }
+
+    /* No threads available, simulate on this one */
+    if (started == 0) {
+        worker_main(&batch);
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    double seconds = (double)(wall_time_us() - start_us) / 1000000.0;
+    fprintf(stderr, "headless: %d races on %d threads, %d timed out, %llu ticks in %.2fs (%.0f races/min)\n",
+            config->races, started ? started : 1, batch.timeouts,
+            (unsigned long long)batch.total_ticks, seconds,
+            seconds > 0 ? config->races * 60.0 / seconds : 0.0);
+
+    pthread_mutex_destroy(&batch.lock);
+    free(batch.results);
+
+    if (config->out != stdout) {
+        fclose(config->out);
+    }
+
+    return batch.next_write == config->races ? 0 : 1;
+}
@@ -4,6 +4,7 @@
  */
 
 #include "input.h"
+#include "profiler.h"
 #include <string.h>
 
 #ifdef DREAMCAST
@@ -16,81 +17,104 @@
 #define DEFAULT_DEADZONE 0.15f
 
 static input_state_t input_states[MAX_PLAYERS];
-static uint32_t prev_buttons[MAX_PLAYERS];
 static float deadzone = DEFAULT_DEADZONE;
 
+#ifdef DREAMCAST
+/* BTN_* follow the KOS CONT_* bit layout, so mapping is one mask */
+#if BTN_C != CONT_C || BTN_B != CONT_B || BTN_A != CONT_A || BTN_START != CONT_START || \
+    BTN_DPAD_UP != CONT_DPAD_UP || BTN_DPAD_DOWN != CONT_DPAD_DOWN || \
+    BTN_DPAD_LEFT != CONT_DPAD_LEFT || BTN_DPAD_RIGHT != CONT_DPAD_RIGHT || \
+    BTN_Z != CONT_Z || BTN_Y != CONT_Y || BTN_X != CONT_X || BTN_D != CONT_D
+#error "BTN_* bits must match CONT_*"
+#endif
+
+/* Controller handles, enumerated again only after a hotplug */
+static maple_device_t *devices[MAX_PLAYERS];
+static volatile int devices_stale = 1;
+
+/* Called from the maple driver when a controller comes or goes */
+static void on_hotplug(maple_device_t *dev) {
+    (void)dev;
+    devices_stale = 1;
+}
+
+static void refresh_devices(void) {
+    /* Cleared first, a hotplug during the scan marks the list again */
+    devices_stale = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        devices[i] = maple_enum_type(i, MAPLE_FUNC_CONTROLLER);
+    }
+}
+
+static int read_controller(int i, input_state_t *in) {
+    maple_device_t *cont = devices[i];
+    if (!cont || !cont->valid) return 0;
+
+    cont_state_t *state = (cont_state_t *)maple_dev_status(cont);
+    if (!state) return 0;
+
+    in->connected = 1;
+    in->buttons = state->buttons & BTN_ALL;
+
+    /* Analog stick, normalized with deadzone */
+    in->stick_x = state->joyx;
+    in->stick_y = state->joyy;
+    in->analog_x = (float)state->joyx / 127.0f;
+    in->analog_y = (float)state->joyy / 127.0f;
+    if (in->analog_x > -deadzone && in->analog_x < deadzone) in->analog_x = 0;
+    if (in->analog_y > -deadzone && in->analog_y < deadzone) in->analog_y = 0;
+
+    /* Triggers */
+    in->ltrig = state->ltrig;
+    in->rtrig = state->rtrig;
+    in->trigger_l = (float)state->ltrig / 255.0f;
+    in->trigger_r = (float)state->rtrig / 255.0f;
+    return 1;
+}
+#endif
+
 void input_init(void) {
     memset(input_states, 0, sizeof(input_states));
-    memset(prev_buttons, 0, sizeof(prev_buttons));
     deadzone = DEFAULT_DEADZONE;
 
 #ifdef DREAMCAST
     /* Initialize maple (controller) bus */
     maple_init();
+    maple_attach_callback(MAPLE_FUNC_CONTROLLER, on_hotplug);
+    maple_detach_callback(MAPLE_FUNC_CONTROLLER, on_hotplug);
+    devices_stale = 1;
 #endif
 }
 
 void input_update(void) {
+    uint64_t now = prof_time_us();
+
+#ifdef DREAMCAST
+    if (devices_stale) {
+        refresh_devices();
+    }
+#endif
+
     for (int i = 0; i < MAX_PLAYERS; i++) {
-        prev_buttons[i] = input_states[i].buttons;
-        memset(&input_states[i], 0, sizeof(input_state_t));
+        input_state_t *in = &input_states[i];
+        uint32_t prev_buttons = in->buttons;
 
 #ifdef DREAMCAST
-        maple_device_t *cont;
-        cont_state_t *state;
-
-        cont = maple_enum_type(i, MAPLE_FUNC_CONTROLLER);
-        if (cont) {
-            input_states[i].connected = 1;
-            state = (cont_state_t *)maple_dev_status(cont);
-            if (state) {
-                /* Map buttons */
-                if (state->buttons & CONT_C) input_states[i].buttons |= BTN_C;
-                if (state->buttons & CONT_B) input_states[i].buttons |= BTN_B;
-                if (state->buttons & CONT_A) input_states[i].buttons |= BTN_A;
-                if (state->buttons & CONT_START) input_states[i].buttons |= BTN_START;
-                if (state->buttons & CONT_DPAD_UP) input_states[i].buttons |= BTN_DPAD_UP;
-                if (state->buttons & CONT_DPAD_DOWN) input_states[i].buttons |= BTN_DPAD_DOWN;
-                if (state->buttons & CONT_DPAD_LEFT) input_states[i].buttons |= BTN_DPAD_LEFT;
-                if (state->buttons & CONT_DPAD_RIGHT) input_states[i].buttons |= BTN_DPAD_RIGHT;
-                if (state->buttons & CONT_Z) input_states[i].buttons |= BTN_Z;
-                if (state->buttons & CONT_Y) input_states[i].buttons |= BTN_Y;
-                if (state->buttons & CONT_X) input_states[i].buttons |= BTN_X;
-                if (state->buttons & CONT_D) input_states[i].buttons |= BTN_D;
-
-                /* Analog stick */
-                input_states[i].stick_x = state->joyx;
-                input_states[i].stick_y = state->joyy;
-
-                /* Normalize analog */
-                input_states[i].analog_x = (float)state->joyx / 127.0f;
-                input_states[i].analog_y = (float)state->joyy / 127.0f;
-
-                /* Apply deadzone */
-                if (input_states[i].analog_x > -deadzone && input_states[i].analog_x < deadzone) {
-                    input_states[i].analog_x = 0;
-                }
-                if (input_states[i].analog_y > -deadzone && input_states[i].analog_y < deadzone) {
-                    input_states[i].analog_y = 0;
-                }
-
-                /* Triggers */
-                input_states[i].ltrig = state->ltrig;
-                input_states[i].rtrig = state->rtrig;
-                input_states[i].trigger_l = (float)state->ltrig / 255.0f;
-                input_states[i].trigger_r = (float)state->rtrig / 255.0f;
-            }
+        if (!read_controller(i, in)) {
+            memset(in, 0, sizeof(input_state_t));
         }
 #else
         /* Simulation for testing - player 1 always connected */
+        memset(in, 0, sizeof(input_state_t));
         if (i == 0) {
-            input_states[i].connected = 1;
+            in->connected = 1;
         }
 #endif
 
         /* Calculate pressed/released */
-        input_states[i].pressed = input_states[i].buttons & ~prev_buttons[i];
-        input_states[i].released = ~input_states[i].buttons & prev_buttons[i];
+        in->pressed = in->buttons & ~prev_buttons;
+        in->released = ~in->buttons & prev_buttons;
+        in->sample_time_us = now;
     }
 }
 
@@ -20,38 +20,90 @@ KOS_INIT_FLAGS(INIT_DEFAULT);
 #else
 /* For non-Dreamcast builds (testing/development) */
 #include <time.h>
+#include <string.h>
 #endif
 
 #include "game.h"
 #include "render.h"
 #include "input.h"
-
-/* Target frame rate */
-#define TARGET_FPS 60
-#define FRAME_TIME (1.0f / TARGET_FPS)
+#include "headless.h"
+#include "profiler.h"
+#include "menu.h"
+#include "pvrcap.h"
 
 /* Game running flag */
 static int running = 1;
 
-#ifdef DREAMCAST
-/* Dreamcast timing using TMU */
-static uint64_t get_time_us(void) {
-    return timer_us_gettime64();
+#ifndef DREAMCAST
+/* No vblank to wait on natively: sleep until the clock reaches deadline */
+static void sleep_until(uint64_t deadline) {
+    uint64_t now = prof_time_us();
+    if (now >= deadline) return;
+
+    uint64_t wait = deadline - now;
+    struct timespec ts;
+    ts.tv_sec = (time_t)(wait / 1000000);
+    ts.tv_nsec = (long)(wait % 1000000) * 1000;
+    nanosleep(&ts, NULL);
 }
-#else
-/* POSIX timing for development */
-#include <sys/time.h>
 
-static uint64_t get_time_us(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+/*
+ * --pvrcap FILE [--seed N] [--ticks N]: run an AI race for N ticks and
+ * capture the frame drawn after them, for tools/pvrcap.c. Returns -1
+ * when not requested, else the exit status.
+ */
+static int capture_frame(int argc, char *argv[]) {
+    const char *file = NULL;
+    uint32_t seed = 1;
+    int ticks = 300;    /* Past the countdown, cars spread out */
+
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--pvrcap") == 0) {
+            file = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--ticks") == 0) {
+            ticks = atoi(argv[++i]);
+        }
+    }
+    if (!file) return -1;
+
+    game_init();
+    int ok = game_sim_start_race(game_get_instance(), MODE_AI_RACE, 3, 5, seed);
+    for (int i = 0; ok && i < ticks; i++) {
+        game_update(FRAME_TIME);
+    }
+
+    ok = ok && pvrcap_request(file);
+    if (ok) {
+        game_render(1.0f);
+        ok = pvrcap_result() == 1;
+    }
+    game_shutdown();
+    return ok ? 0 : 1;
 }
 #endif
 
 int main(int argc, char *argv[]) {
+#ifndef DREAMCAST
+    /* Batch simulation without rendering */
+    if (headless_requested(argc, argv)) {
+        headless_config_t config;
+        if (!headless_parse_args(&config, argc, argv)) {
+            return 1;
+        }
+        return headless_run(&config);
+    }
+
+    /* One frame's PVR commands to a file */
+    int capture_status = capture_frame(argc, argv);
+    if (capture_status >= 0) {
+        return capture_status;
+    }
+#else
     (void)argc;
     (void)argv;
+#endif
 
     printf("RetroRacer - Dreamcast Racing Game\n");
     printf("===================================\n");
@@ -74,15 +126,31 @@ int main(int argc, char *argv[]) {
     printf("  3. Time Trial  - Beat the best time\n");
     printf("  4. Grand Prix  - 4-race championship\n\n");
 
-    /* Main game loop */
-    uint64_t last_time = get_time_us();
+    /*
+     * Main game loop. The simulation runs in fixed ticks off the clock and
+     * each pass draws one frame, blended between the last two ticks by the
+     * time left in the accumulator. On Dreamcast each pass first waits for
+     * the PVR, so passes run once per vblank and the ticks after the wait
+     * read the newest controller state. Natively the loop sleeps until the
+     * next tick is due and draws once per tick.
+     */
+    uint64_t last_time = prof_time_us();
     uint64_t accumulator = 0;
     uint64_t frame_time_us = (uint64_t)(FRAME_TIME * 1000000);
 
     printf("Entering main loop...\n");
 
     while (running) {
-        uint64_t current_time = get_time_us();
+#ifdef DREAMCAST
+        render_wait_ready();
+#else
+        if (accumulator < frame_time_us) {
+            sleep_until(last_time + (frame_time_us - accumulator));
+        }
+#endif
+        prof_frame_begin();
+
+        uint64_t current_time = prof_time_us();
         uint64_t elapsed = current_time - last_time;
         last_time = current_time;
 
@@ -94,28 +162,23 @@ int main(int argc, char *argv[]) {
         accumulator += elapsed;
 
         /* Fixed timestep updates */
+        int ticks = 0;
         while (accumulator >= frame_time_us) {
             game_update(FRAME_TIME);
             accumulator -= frame_time_us;
+            ticks++;
         }
+        prof_frame_ticks(ticks);
 
         /* Render */
-        game_render();
+        game_render((float)accumulator / frame_time_us);
+        prof_frame_end();
 
 #ifdef DREAMCAST
         /* Check for exit button combination (A + B + X + Y + Start) */
-        maple_device_t *cont = maple_enum_type(0, MAPLE_FUNC_CONTROLLER);
-        if (cont) {
-            cont_state_t *state = (cont_state_t *)maple_dev_status(cont);
-            if (state) {
-                if ((state->buttons & CONT_A) &&
-                    (state->buttons & CONT_B) &&
-                    (state->buttons & CONT_X) &&
-                    (state->buttons & CONT_Y) &&
-                    (state->buttons & CONT_START)) {
-                    running = 0;
-                }
-            }
+        const uint32_t exit_combo = BTN_A | BTN_B | BTN_X | BTN_Y | BTN_START;
+        if ((input_get_state(0)->buttons & exit_combo) == exit_combo) {
+            running = 0;
         }
 #else
         /* For non-DC builds, run for a short time then exit */
@@ -153,6 +216,9 @@ int main(int argc, char *argv[]) {
  *   A / Right Trigger               - Accelerate
  *   B / Left Trigger                - Brake
  *   Start                           - Pause
+ *   Y                               - Profiler overlay
+ *   X                               - Dump profiler statistics
+ *   D-Pad Down + X                  - Capture a frame's PVR commands
  *
  * Exit:
  *   Hold A + B + X + Y + Start simultaneously
@@ -5,6 +5,10 @@
 #include "math3d.h"
 #include <string.h>
 
+#ifdef MATH3D_SSE
+#include <xmmintrin.h>
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846f
 #endif
@@ -33,11 +37,9 @@ float vec3_length(vec3_t v) {
 }
 
 vec3_t vec3_normalize(vec3_t v) {
-    float len = vec3_length(v);
-    if (len > 0.0001f) {
-        return vec3_scale(v, 1.0f / len);
-    }
-    return vec3_create(0, 0, 0);
+    vec3_t r;
+    vec3_normalize_into(&r, &v);
+    return r;
 }
 
 vec3_t vec3_cross(vec3_t a, vec3_t b) {
@@ -68,30 +70,19 @@ vec3_t vec3_lerp(vec3_t a, vec3_t b, float t) {
 
 mat4_t mat4_identity(void) {
     mat4_t m;
-    memset(m.m, 0, sizeof(m.m));
-    m.m[0] = m.m[5] = m.m[10] = m.m[15] = 1.0f;
+    mat4_identity_into(&m);
     return m;
 }
 
 mat4_t mat4_multiply(mat4_t a, mat4_t b) {
     mat4_t result;
-    for (int col = 0; col < 4; col++) {
-        for (int row = 0; row < 4; row++) {
-            result.m[col * 4 + row] =
-                a.m[0 * 4 + row] * b.m[col * 4 + 0] +
-                a.m[1 * 4 + row] * b.m[col * 4 + 1] +
-                a.m[2 * 4 + row] * b.m[col * 4 + 2] +
-                a.m[3 * 4 + row] * b.m[col * 4 + 3];
-        }
-    }
+    mat4_mul_into(&result, &a, &b);
     return result;
 }
 
 mat4_t mat4_translate(float x, float y, float z) {
-    mat4_t m = mat4_identity();
-    m.m[12] = x;
-    m.m[13] = y;
-    m.m[14] = z;
+    mat4_t m;
+    mat4_translate_into(&m, x, y, z);
     return m;
 }
 
@@ -107,13 +98,8 @@ mat4_t mat4_rotate_x(float angle) {
 }
 
 mat4_t mat4_rotate_y(float angle) {
-    mat4_t m = mat4_identity();
-    float c = cosf(angle);
-    float s = sinf(angle);
-    m.m[0] = c;
-    m.m[2] = -s;
-    m.m[8] = s;
-    m.m[10] = c;
+    mat4_t m;
+    mat4_rotate_y_into(&m, angle);
     return m;
 }
 
@@ -179,11 +165,243 @@ mat4_t mat4_look_at(vec3_t eye, vec3_t target, vec3_t up) {
 
 vec3_t mat4_transform_vec3(mat4_t m, vec3_t v) {
     /* Transform point by matrix (no perspective divide - handled by renderer) */
-    return vec3_create(
-        m.m[0] * v.x + m.m[4] * v.y + m.m[8] * v.z + m.m[12],
-        m.m[1] * v.x + m.m[5] * v.y + m.m[9] * v.z + m.m[13],
-        m.m[2] * v.x + m.m[6] * v.y + m.m[10] * v.z + m.m[14]
-    );
+    vec3_t r;
+    mat4_transform_into(&r, &m, &v);
+    return r;
+}
+
+/* Pointer API */
+
+#ifdef MATH3D_SH4
+/* Load a column-major matrix into XMTRX (the back FPU bank) */
+static inline void sh4_load_xmtrx(const mat4_t *m) {
+    const float *p = m->m;
+    __asm__ __volatile__(
+        "frchg\n\t"
+        "fmov.s @%0+, fr0\n\t"
+        "fmov.s @%0+, fr1\n\t"
+        "fmov.s @%0+, fr2\n\t"
+        "fmov.s @%0+, fr3\n\t"
+        "fmov.s @%0+, fr4\n\t"
+        "fmov.s @%0+, fr5\n\t"
+        "fmov.s @%0+, fr6\n\t"
+        "fmov.s @%0+, fr7\n\t"
+        "fmov.s @%0+, fr8\n\t"
+        "fmov.s @%0+, fr9\n\t"
+        "fmov.s @%0+, fr10\n\t"
+        "fmov.s @%0+, fr11\n\t"
+        "fmov.s @%0+, fr12\n\t"
+        "fmov.s @%0+, fr13\n\t"
+        "fmov.s @%0+, fr14\n\t"
+        "fmov.s @%0+, fr15\n\t"
+        "frchg\n"
+        : "+r"(p)
+        :
+        : "memory");
+}
+
+/* (x, y, z, w) = XMTRX * (x, y, z, w) */
+static inline void sh4_ftrv(float *x, float *y, float *z, float *w) {
+    register float r0 __asm__("fr0") = *x;
+    register float r1 __asm__("fr1") = *y;
+    register float r2 __asm__("fr2") = *z;
+    register float r3 __asm__("fr3") = *w;
+    __asm__ __volatile__("ftrv xmtrx, fv0" : "+f"(r0), "+f"(r1), "+f"(r2), "+f"(r3));
+    *x = r0; *y = r1; *z = r2; *w = r3;
+}
+
+/* Dot product of two 4-vectors in one instruction */
+static inline float sh4_fipr(float ax, float ay, float az, float aw,
+                             float bx, float by, float bz, float bw) {
+    register float r0 __asm__("fr0") = ax;
+    register float r1 __asm__("fr1") = ay;
+    register float r2 __asm__("fr2") = az;
+    register float r3 __asm__("fr3") = aw;
+    register float r4 __asm__("fr4") = bx;
+    register float r5 __asm__("fr5") = by;
+    register float r6 __asm__("fr6") = bz;
+    register float r7 __asm__("fr7") = bw;
+    __asm__ __volatile__("fipr fv0, fv4"
+                         : "+f"(r7)
+                         : "f"(r0), "f"(r1), "f"(r2), "f"(r3), "f"(r4), "f"(r5), "f"(r6));
+    return r7;
+}
+
+/* Approximate 1 / sqrt(x) */
+static inline float sh4_fsrra(float x) {
+    __asm__ __volatile__("fsrra %0" : "+f"(x));
+    return x;
+}
+#endif
+
+void mat4_identity_into(mat4_t *dst) {
+    memset(dst->m, 0, sizeof(dst->m));
+    dst->m[0] = dst->m[5] = dst->m[10] = dst->m[15] = 1.0f;
+}
+
+void mat4_mul_into(mat4_t *dst, const mat4_t *a, const mat4_t *b) {
+#if defined(MATH3D_SH4)
+    /* Each result column is a times the matching column of b. Column col
+     * of b is read before column col of dst is written, and a lives in
+     * XMTRX, so dst may alias either input. */
+    sh4_load_xmtrx(a);
+    for (int col = 0; col < 4; col++) {
+        float x = b->m[col * 4 + 0];
+        float y = b->m[col * 4 + 1];
+        float z = b->m[col * 4 + 2];
+        float w = b->m[col * 4 + 3];
+        sh4_ftrv(&x, &y, &z, &w);
+        dst->m[col * 4 + 0] = x;
+        dst->m[col * 4 + 1] = y;
+        dst->m[col * 4 + 2] = z;
+        dst->m[col * 4 + 3] = w;
+    }
+#elif defined(MATH3D_SSE)
+    /* Same summation order as the scalar code, so results are identical */
+    __m128 a0 = _mm_loadu_ps(&a->m[0]);
+    __m128 a1 = _mm_loadu_ps(&a->m[4]);
+    __m128 a2 = _mm_loadu_ps(&a->m[8]);
+    __m128 a3 = _mm_loadu_ps(&a->m[12]);
+    __m128 col[4];
+    for (int c = 0; c < 4; c++) {
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b->m[c * 4 + 0]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b->m[c * 4 + 1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b->m[c * 4 + 2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b->m[c * 4 + 3])));
+        col[c] = r;
+    }
+    for (int c = 0; c < 4; c++) {
+        _mm_storeu_ps(&dst->m[c * 4], col[c]);
+    }
+#else
+    mat4_t result;
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            result.m[col * 4 + row] =
+                a->m[0 * 4 + row] * b->m[col * 4 + 0] +
+                a->m[1 * 4 + row] * b->m[col * 4 + 1] +
+                a->m[2 * 4 + row] * b->m[col * 4 + 2] +
+                a->m[3 * 4 + row] * b->m[col * 4 + 3];
+        }
+    }
+    *dst = result;
+#endif
+}
+
+void mat4_translate_into(mat4_t *dst, float x, float y, float z) {
+    mat4_identity_into(dst);
+    dst->m[12] = x;
+    dst->m[13] = y;
+    dst->m[14] = z;
+}
+
+void mat4_rotate_y_into(mat4_t *dst, float angle) {
+    float c = cosf(angle);
+    float s = sinf(angle);
+    mat4_identity_into(dst);
+    dst->m[0] = c;
+    dst->m[2] = -s;
+    dst->m[8] = s;
+    dst->m[10] = c;
+}
+
+void mat4_translate_by(mat4_t *m, float x, float y, float z) {
+    /* Only the translation column changes */
+    for (int row = 0; row < 4; row++) {
+        m->m[12 + row] += m->m[row] * x + m->m[4 + row] * y + m->m[8 + row] * z;
+    }
+}
+
+/* Replace columns i and j with c*col_i + s*col_j and c*col_j - s*col_i */
+static void rotate_columns(mat4_t *m, int i, int j, float c, float s) {
+    for (int row = 0; row < 4; row++) {
+        float ci = m->m[i * 4 + row];
+        float cj = m->m[j * 4 + row];
+        m->m[i * 4 + row] = ci * c + cj * s;
+        m->m[j * 4 + row] = cj * c - ci * s;
+    }
+}
+
+void mat4_rotate_x_by(mat4_t *m, float angle) {
+    rotate_columns(m, 1, 2, cosf(angle), sinf(angle));
+}
+
+void mat4_rotate_y_by(mat4_t *m, float angle) {
+    rotate_columns(m, 2, 0, cosf(angle), sinf(angle));
+}
+
+void mat4_rotate_y_by_sincos(mat4_t *m, float s, float c) {
+    rotate_columns(m, 2, 0, c, s);
+}
+
+void mat4_rotate_z_by(mat4_t *m, float angle) {
+    rotate_columns(m, 0, 1, cosf(angle), sinf(angle));
+}
+
+void mat4_transform_into(vec3_t *dst, const mat4_t *m, const vec3_t *v) {
+    /* A single point is cheaper in scalar code than loading XMTRX */
+    float x = m->m[0] * v->x + m->m[4] * v->y + m->m[8] * v->z + m->m[12];
+    float y = m->m[1] * v->x + m->m[5] * v->y + m->m[9] * v->z + m->m[13];
+    float z = m->m[2] * v->x + m->m[6] * v->y + m->m[10] * v->z + m->m[14];
+    dst->x = x;
+    dst->y = y;
+    dst->z = z;
+}
+
+void mat4_transform_points(const mat4_t *m, const vec3_t *in, vec3_t *out, int count) {
+#if defined(MATH3D_SH4)
+    sh4_load_xmtrx(m);
+    for (int i = 0; i < count; i++) {
+        float x = in[i].x, y = in[i].y, z = in[i].z, w = 1.0f;
+        sh4_ftrv(&x, &y, &z, &w);
+        out[i].x = x;
+        out[i].y = y;
+        out[i].z = z;
+    }
+#elif defined(MATH3D_SSE)
+    __m128 c0 = _mm_loadu_ps(&m->m[0]);
+    __m128 c1 = _mm_loadu_ps(&m->m[4]);
+    __m128 c2 = _mm_loadu_ps(&m->m[8]);
+    __m128 c3 = _mm_loadu_ps(&m->m[12]);
+    for (int i = 0; i < count; i++) {
+        float r[4];
+        __m128 p = _mm_mul_ps(c0, _mm_set1_ps(in[i].x));
+        p = _mm_add_ps(p, _mm_mul_ps(c1, _mm_set1_ps(in[i].y)));
+        p = _mm_add_ps(p, _mm_mul_ps(c2, _mm_set1_ps(in[i].z)));
+        p = _mm_add_ps(p, c3);
+        _mm_storeu_ps(r, p);
+        out[i].x = r[0];
+        out[i].y = r[1];
+        out[i].z = r[2];
+    }
+#else
+    for (int i = 0; i < count; i++) {
+        mat4_transform_into(&out[i], m, &in[i]);
+    }
+#endif
+}
+
+void vec3_normalize_into(vec3_t *dst, const vec3_t *v) {
+#if defined(MATH3D_SH4)
+    float len_sq = sh4_fipr(v->x, v->y, v->z, 0.0f, v->x, v->y, v->z, 0.0f);
+    if (len_sq > 0.0001f * 0.0001f) {
+        float inv = sh4_fsrra(len_sq);
+        dst->x = v->x * inv;
+        dst->y = v->y * inv;
+        dst->z = v->z * inv;
+        return;
+    }
+#else
+    float len = vec3_length(*v);
+    if (len > 0.0001f) {
+        float inv = 1.0f / len;
+        dst->x = v->x * inv;
+        dst->y = v->y * inv;
+        dst->z = v->z * inv;
+        return;
+    }
+#endif
+    dst->x = dst->y = dst->z = 0;
 }
 
 /* Utility functions */
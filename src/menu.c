@@ -10,15 +10,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-
-#ifdef DREAMCAST
-#include <kos.h>
-#include <dc/biosfont.h>
-#include <dc/video.h>
-#endif
+#include <stdarg.h>
 
 static menu_state_t menu_state;
 static int menu_active = 1;
+static menu_action_t menu_action = MENU_ACTION_NONE;
 
 /* Menu screen titles */
 static const char *screen_titles[] = {
@@ -243,10 +239,11 @@ void menu_select(void) {
 
         case MENU_PAUSE:
             if (item->value == 0) {  /* Resume */
+                menu_action = MENU_ACTION_CONTINUE;
                 menu_active = 0;
-            } else if (item->value == 1) {  /* Restart */
+            } else if (item->value == 1) {  /* Restart, handled by game.c */
+                menu_action = MENU_ACTION_RESTART;
                 menu_active = 0;
-                /* Restart handled by game.c */
             } else if (item->value == 2) {  /* Quit */
                 menu_set_screen(MENU_MAIN);
                 menu_active = 1;
@@ -255,8 +252,10 @@ void menu_select(void) {
 
         case MENU_RESULTS:
             if (item->value == 0) {  /* Continue */
+                menu_action = MENU_ACTION_CONTINUE;
                 menu_active = 0;
             } else if (item->value == 1) {  /* Restart */
+                menu_action = MENU_ACTION_RESTART;
                 menu_active = 0;
             } else if (item->value == 2) {  /* Quit */
                 menu_set_screen(MENU_MAIN);
@@ -297,6 +296,7 @@ void menu_back(void) {
             menu_set_screen(MENU_OPTIONS);
             break;
         case MENU_PAUSE:
+            menu_action = MENU_ACTION_CONTINUE;
             menu_active = 0;  /* Resume game */
             break;
         default:
@@ -365,55 +365,72 @@ void menu_update(input_state_t *input, float dt) {
     }
 }
 
-/* Draw text directly to VRAM (for menu rendering) */
-static void draw_menu_text(int x, int y, uint32_t color, const char *text) {
-#ifdef DREAMCAST
-    bfont_set_foreground_color(color);
-    bfont_draw_str(vram_s + y * 640 + x, 640, 0, text);
-#else
-    (void)x; (void)y; (void)color;
-    printf("%s\n", text);
-#endif
-}
-
-/* Fill screen with solid color (for menu background) */
-static void fill_screen(uint32_t color) {
-#ifdef DREAMCAST
-    uint16_t col16 = ((color >> 8) & 0xF800) |  /* R */
-                     ((color >> 5) & 0x07E0) |  /* G */
-                     ((color >> 3) & 0x001F);   /* B */
+/* Solid background plane behind the menus, and the dim over a paused race */
+#define MENU_BACKGROUND PACK_COLOR(255, 20, 20, 60)
+#define MENU_DIM PACK_COLOR(160, 0, 0, 0)
 
-    uint16_t *vram = vram_s;
-    for (int i = 0; i < 640 * 480; i++) {
-        vram[i] = col16;
-    }
-#else
-    (void)color;
-#endif
+/*
+ * Laid-out text of the current screen. It is rebuilt only when the
+ * screen, selection or a value shown on it changes, and replayed into
+ * the HUD list every frame.
+ */
+#define MENU_MAX_LINES 24
+#define MENU_LINE_LEN 48
+
+typedef struct {
+    int x, y;
+    uint32_t color;
+    char text[MENU_LINE_LEN];
+} menu_line_t;
+
+typedef struct {
+    int screen;
+    int selected_index;
+    int item_count;
+    int music_volume;
+    int sfx_volume;
+    int current_track;
+    int is_playing;
+    int music_enabled;
+    int sfx_enabled;
+} menu_layout_key_t;
+
+static struct {
+    menu_line_t lines[MENU_MAX_LINES];
+    int count;
+    menu_layout_key_t key;
+    int valid;
+} menu_layout;
+
+static void add_line(int x, int y, uint32_t color, const char *fmt, ...) {
+    if (menu_layout.count >= MENU_MAX_LINES) return;
+
+    menu_line_t *line = &menu_layout.lines[menu_layout.count++];
+    line->x = x;
+    line->y = y;
+    line->color = color;
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line->text, sizeof(line->text), fmt, args);
+    va_end(args);
 }
 
-void menu_render(void) {
-#ifdef DREAMCAST
-    /* For menu, we bypass PVR and draw directly to VRAM */
-    /* Wait for any PVR operations to complete */
-    vid_waitvbl();
-
-    /* Fill background with dark blue */
-    fill_screen(PACK_COLOR(255, 20, 20, 60));
-#endif
-
+static void build_layout(void) {
     int screen_w = 640;
     int screen_h = 480;
     int center_x = screen_w / 2;
 
+    menu_layout.count = 0;
+
     /* Draw title */
     const char *title = screen_titles[menu_state.current_screen];
     int title_x = center_x - (int)(strlen(title) * 6);
-    draw_menu_text(title_x, 60, COLOR_YELLOW, title);
+    add_line(title_x, 60, COLOR_YELLOW, "%s", title);
 
     /* Draw subtitle based on screen */
     if (menu_state.current_screen == MENU_MAIN) {
-        draw_menu_text(center_x - 110, 100, COLOR_WHITE, "Dreamcast Racing Game");
+        add_line(center_x - 110, 100, COLOR_WHITE, "Dreamcast Racing Game");
     }
 
     /* Draw menu items */
@@ -429,13 +446,13 @@ void menu_render(void) {
         if (i == menu_state.selected_index) {
             color = COLOR_YELLOW;
             /* Draw selection indicator */
-            draw_menu_text(x - 20, y, COLOR_YELLOW, ">");
+            add_line(x - 20, y, COLOR_YELLOW, ">");
         }
         if (!item->enabled) {
             color = COLOR_GRAY;
         }
 
-        draw_menu_text(x, y, color, item->text);
+        add_line(x, y, color, "%s", item->text);
     }
 
     /* Draw mode-specific info */
@@ -447,51 +464,93 @@ void menu_render(void) {
             case 2: desc = "Beat the best lap time"; break;
             case 3: desc = "4-race championship"; break;
         }
-        draw_menu_text(center_x - 130, 380, COLOR_GRAY, desc);
+        add_line(center_x - 130, 380, COLOR_GRAY, "%s", desc);
     }
 
     /* Draw options screen info */
     if (menu_state.current_screen == MENU_OPTIONS) {
         audio_state_t *audio = audio_get_state();
-        char buf[64];
 
         /* Show current track */
-        sprintf(buf, "Current: %s", audio_get_track_name(audio->current_track));
-        draw_menu_text(center_x - 100, 350, COLOR_CYAN, buf);
+        add_line(center_x - 100, 350, COLOR_CYAN, "Current: %s", audio_get_track_name(audio->current_track));
 
         /* Show volume bars */
-        sprintf(buf, "Music Vol: %d%%", audio->music_volume);
-        draw_menu_text(center_x + 80, 180 + 30, COLOR_GRAY, buf);
-
-        sprintf(buf, "SFX Vol: %d%%", audio->sfx_volume);
-        draw_menu_text(center_x + 80, 180 + 60, COLOR_GRAY, buf);
+        add_line(center_x + 80, 180 + 30, COLOR_GRAY, "Music Vol: %d%%", audio->music_volume);
+        add_line(center_x + 80, 180 + 60, COLOR_GRAY, "SFX Vol: %d%%", audio->sfx_volume);
 
         /* Controls hint for volumes */
-        draw_menu_text(center_x - 120, 400, COLOR_GRAY, "L/R to adjust volume");
+        add_line(center_x - 120, 400, COLOR_GRAY, "L/R to adjust volume");
     }
 
     /* Draw music select screen info */
     if (menu_state.current_screen == MENU_MUSIC_SELECT) {
         audio_state_t *audio = audio_get_state();
         music_track_t selected = (music_track_t)menu_state.selected_index;
-        char buf[64];
 
         /* Show artist */
-        sprintf(buf, "Artist: %s", audio_get_track_artist(selected));
-        draw_menu_text(center_x - 80, 380, COLOR_CYAN, buf);
+        add_line(center_x - 80, 380, COLOR_CYAN, "Artist: %s", audio_get_track_artist(selected));
 
         /* Show BPM */
-        sprintf(buf, "BPM: %d", audio_get_track_bpm(selected));
-        draw_menu_text(center_x - 40, 410, COLOR_GRAY, buf);
+        add_line(center_x - 40, 410, COLOR_GRAY, "BPM: %d", audio_get_track_bpm(selected));
 
         /* Playing indicator */
         if (audio->is_playing && audio->current_track == selected) {
-            draw_menu_text(center_x - 40, 350, COLOR_GREEN, "NOW PLAYING");
+            add_line(center_x - 40, 350, COLOR_GREEN, "NOW PLAYING");
         }
     }
 
     /* Draw controls hint */
-    draw_menu_text(20, screen_h - 40, COLOR_GRAY, "A:Select B:Back D-Pad:Navigate");
+    add_line(20, screen_h - 40, COLOR_GRAY, "A:Select B:Back D-Pad:Navigate");
+}
+
+/* Rebuild the layout if anything it shows changed */
+static void update_layout(void) {
+    audio_state_t *audio = audio_get_state();
+    menu_layout_key_t key;
+
+    memset(&key, 0, sizeof(key));
+    key.screen = menu_state.current_screen;
+    key.selected_index = menu_state.selected_index;
+    key.item_count = menu_state.item_count;
+    key.music_volume = audio->music_volume;
+    key.sfx_volume = audio->sfx_volume;
+    key.current_track = audio->current_track;
+    key.is_playing = audio->is_playing;
+    key.music_enabled = audio->music_enabled;
+    key.sfx_enabled = audio->sfx_enabled;
+
+    if (menu_layout.valid && memcmp(&key, &menu_layout.key, sizeof(key)) == 0) return;
+
+    menu_layout.key = key;
+    menu_layout.valid = 1;
+    build_layout();
+}
+
+/* Queue the cached lines into the open HUD list */
+static void draw_layout(void) {
+    update_layout();
+    for (int i = 0; i < menu_layout.count; i++) {
+        menu_line_t *line = &menu_layout.lines[i];
+        render_draw_text(line->x, line->y, line->color, line->text);
+    }
+}
+
+void menu_render(void) {
+    /* Empty opaque list, the PVR background plane fills the screen */
+    render_begin_frame();
+    render_clear(MENU_BACKGROUND);
+    render_end_frame();
+
+    render_begin_hud();
+    draw_layout();
+    render_end_hud();
+}
+
+void menu_render_over_scene(void) {
+    render_begin_hud();
+    render_draw_rect_2d(0, 0, 640, 480, MENU_DIM);
+    draw_layout();
+    render_end_hud();
 }
 
 int menu_is_active(void) {
@@ -515,6 +574,12 @@ void menu_show_standings(int *points, int num_racers) {
     menu_active = 1;
 }
 
+menu_action_t menu_take_action(void) {
+    menu_action_t action = menu_action;
+    menu_action = MENU_ACTION_NONE;
+    return action;
+}
+
 game_mode_t menu_get_mode(void) {
     return menu_state.selected_mode;
 }
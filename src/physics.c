@@ -182,3 +182,121 @@ float physics_get_surface_friction(track_t *track, vec3_t pos) {
     }
     return OFF_TRACK_DRAG;
 }
+
+void broadphase_init(broadphase_t *bp) {
+    bp->count = 0;
+    bp->axis = 0;
+    bp->pair_count = 0;
+    bp->neighbor_start[0] = 0;
+}
+
+static float axis_value(vec3_t p, int axis) {
+    return axis == 0 ? p.x : p.z;
+}
+
+void broadphase_update(broadphase_t *bp, const vec3_t *pos, int count, float radius) {
+    if (count > BROADPHASE_MAX_BODIES) count = BROADPHASE_MAX_BODIES;
+
+    /* Body set changed, start again from identity */
+    if (count != bp->count) {
+        for (int i = 0; i < count; i++) bp->order[i] = i;
+        bp->count = count;
+    }
+
+    /* Sweep the axis the field is spread along the most */
+    float min_x = 0, max_x = 0, min_z = 0, max_z = 0;
+    for (int i = 0; i < count; i++) {
+        if (i == 0 || pos[i].x < min_x) min_x = pos[i].x;
+        if (i == 0 || pos[i].x > max_x) max_x = pos[i].x;
+        if (i == 0 || pos[i].z < min_z) min_z = pos[i].z;
+        if (i == 0 || pos[i].z > max_z) max_z = pos[i].z;
+    }
+    int axis = (max_z - min_z > max_x - min_x) ? 2 : 0;
+    bp->axis = axis;
+
+    /* Insertion sort, nearly linear since cars rarely swap places */
+    float key[BROADPHASE_MAX_BODIES];
+    for (int i = 0; i < count; i++) key[i] = axis_value(pos[i], axis);
+
+    int *order = bp->order;
+    for (int i = 1; i < count; i++) {
+        int body = order[i];
+        float k = key[body];
+        int j = i - 1;
+        while (j >= 0 && key[order[j]] > k) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = body;
+    }
+
+    /* Sweep: bodies further apart on one axis than radius cannot be close */
+    float radius_sq = radius * radius;
+    bp->pair_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        int a = order[i];
+        float limit = key[a] + radius;
+        for (int j = i + 1; j < count && key[order[j]] < limit; j++) {
+            int b = order[j];
+            /* Ground plane distance, height can snap between segments */
+            float dx = pos[a].x - pos[b].x;
+            float dz = pos[a].z - pos[b].z;
+            if (dx * dx + dz * dz >= radius_sq) continue;
+
+            broadphase_pair_t *pair = &bp->pairs[bp->pair_count++];
+            pair->a = a < b ? a : b;
+            pair->b = a < b ? b : a;
+        }
+    }
+
+    /* Degree count, then CSR neighbour lists */
+    for (int i = 0; i <= count; i++) bp->neighbor_start[i] = 0;
+    for (int p = 0; p < bp->pair_count; p++) {
+        bp->neighbor_start[bp->pairs[p].a + 1]++;
+        bp->neighbor_start[bp->pairs[p].b + 1]++;
+    }
+    for (int i = 0; i < count; i++) {
+        bp->neighbor_start[i + 1] += bp->neighbor_start[i];
+    }
+
+    int fill[BROADPHASE_MAX_BODIES];
+    for (int i = 0; i < count; i++) fill[i] = bp->neighbor_start[i];
+    for (int p = 0; p < bp->pair_count; p++) {
+        bp->neighbors[fill[bp->pairs[p].a]++] = bp->pairs[p].b;
+        bp->neighbors[fill[bp->pairs[p].b]++] = bp->pairs[p].a;
+    }
+
+    /* Ascending lists so users visit bodies in index order */
+    for (int i = 0; i < count; i++) {
+        int *list = &bp->neighbors[bp->neighbor_start[i]];
+        int n = bp->neighbor_start[i + 1] - bp->neighbor_start[i];
+        for (int a = 1; a < n; a++) {
+            int v = list[a];
+            int b = a - 1;
+            while (b >= 0 && list[b] > v) {
+                list[b + 1] = list[b];
+                b--;
+            }
+            list[b + 1] = v;
+        }
+    }
+
+    /* Rebuild pairs in (a, b) order from the sorted lists */
+    int pair_count = 0;
+    for (int a = 0; a < count; a++) {
+        for (int k = bp->neighbor_start[a]; k < bp->neighbor_start[a + 1]; k++) {
+            int b = bp->neighbors[k];
+            if (b <= a) continue;
+            bp->pairs[pair_count].a = a;
+            bp->pairs[pair_count].b = b;
+            pair_count++;
+        }
+    }
+    bp->pair_count = pair_count;
+}
+
+const int *broadphase_neighbors(const broadphase_t *bp, int body, int *count) {
+    *count = bp->neighbor_start[body + 1] - bp->neighbor_start[body];
+    return &bp->neighbors[bp->neighbor_start[body]];
+}
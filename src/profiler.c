@@ -0,0 +1,240 @@
+/*
+ * RetroRacer - Frame Profiler
+ * Per-subsystem timers with a rolling history and on-screen overlay
+ */
+
+#include "profiler.h"
+#include "render.h"
+#include <string.h>
+
+#ifdef DREAMCAST
+#include <kos.h>
+#else
+#include <sys/time.h>
+#endif
+
+static int prof_enabled = 0;
+static int overlay_visible = 0;
+
+/* Counters follow the sections in each row */
+#define PROF_COLUMNS (PROF_SECTION_COUNT + PROF_COUNTER_COUNT)
+
+/* Time spent in each section during the current frame, then the counters */
+static uint64_t section_start[PROF_SECTION_COUNT];
+static uint32_t section_accum[PROF_COLUMNS];
+
+/* Ring buffer of finished frames */
+static uint32_t history[PROF_HISTORY][PROF_COLUMNS];
+static int history_next = 0;
+static int history_count = 0;
+
+static prof_pacing_t pacing;
+static uint64_t input_sample_time;
+
+static const char *section_names[PROF_SECTION_COUNT] = {
+    "input_update",
+    "ai_update",
+    "vehicle_update",
+    "collisions",
+    "track_render",
+    "vehicle_render",
+    "hud",
+    "pvr_scene_finish",
+    "frame",
+    "input_lag"
+};
+
+static const char *counter_names[PROF_COUNTER_COUNT] = {
+    "op_vertices",
+    "tr_vertices",
+    "vertex_bytes",
+    "lod_level"
+};
+
+#ifdef DREAMCAST
+uint64_t prof_time_us(void) {
+    return timer_us_gettime64();
+}
+#else
+uint64_t prof_time_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+#endif
+
+void prof_init(void) {
+    memset(section_accum, 0, sizeof(section_accum));
+    history_next = 0;
+    history_count = 0;
+    memset(&pacing, 0, sizeof(pacing));
+    input_sample_time = 0;
+    prof_enabled = 1;
+}
+
+void prof_frame_begin(void) {
+    if (!prof_enabled) return;
+    memset(section_accum, 0, sizeof(section_accum));
+    section_start[PROF_FRAME] = prof_time_us();
+}
+
+void prof_frame_end(void) {
+    if (!prof_enabled) return;
+    prof_end(PROF_FRAME);
+
+    /* Frame submitted, on Dreamcast it shows from the next vblank */
+    if (input_sample_time) {
+        section_accum[PROF_INPUT_LAG] = (uint32_t)(prof_time_us() - input_sample_time);
+    }
+
+    memcpy(history[history_next], section_accum, sizeof(section_accum));
+    history_next = (history_next + 1) % PROF_HISTORY;
+    if (history_count < PROF_HISTORY) history_count++;
+}
+
+void prof_input_sampled(uint64_t sample_time_us) {
+    input_sample_time = sample_time_us;
+}
+
+void prof_frame_ticks(int ticks) {
+    if (!prof_enabled) return;
+    pacing.frames++;
+    if (ticks == 0) {
+        pacing.duplicated++;
+    } else if (ticks > 1) {
+        pacing.dropped += ticks - 1;
+    }
+}
+
+void prof_get_pacing(prof_pacing_t *out) {
+    *out = pacing;
+}
+
+void prof_begin(prof_section_t section) {
+    if (!prof_enabled) return;
+    section_start[section] = prof_time_us();
+}
+
+void prof_end(prof_section_t section) {
+    if (!prof_enabled) return;
+    section_accum[section] += (uint32_t)(prof_time_us() - section_start[section]);
+}
+
+void prof_count(prof_counter_t counter, uint32_t value) {
+    if (!prof_enabled) return;
+    section_accum[PROF_SECTION_COUNT + counter] = value;
+}
+
+static void column_stats(int column, prof_stats_t *stats) {
+    memset(stats, 0, sizeof(prof_stats_t));
+    if (history_count == 0) return;
+
+    uint32_t sorted[PROF_HISTORY];
+    uint64_t total = 0;
+
+    /* Insertion sort, the history is small */
+    for (int i = 0; i < history_count; i++) {
+        uint32_t t = history[i][column];
+        total += t;
+        int j = i;
+        while (j > 0 && sorted[j - 1] > t) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = t;
+    }
+
+    int p99 = (history_count * 99 + 99) / 100 - 1;
+    stats->min_us = (float)sorted[0];
+    stats->max_us = (float)sorted[history_count - 1];
+    stats->avg_us = (float)total / history_count;
+    stats->p99_us = (float)sorted[p99];
+}
+
+/* Value from the newest finished frame, the current one is still open */
+static uint32_t last_frame(int column) {
+    if (history_count == 0) return 0;
+    return history[(history_next + PROF_HISTORY - 1) % PROF_HISTORY][column];
+}
+
+void prof_get_stats(prof_section_t section, prof_stats_t *stats) {
+    column_stats(section, stats);
+}
+
+void prof_get_counter_stats(prof_counter_t counter, prof_stats_t *stats) {
+    column_stats(PROF_SECTION_COUNT + counter, stats);
+}
+
+const char *prof_section_name(prof_section_t section) {
+    if (section < 0 || section >= PROF_SECTION_COUNT) return "?";
+    return section_names[section];
+}
+
+void prof_toggle_overlay(void) {
+    overlay_visible = !overlay_visible;
+}
+
+int prof_overlay_visible(void) {
+    return overlay_visible;
+}
+
+/* HUD font cells are 12x24 */
+#define OVERLAY_X 364
+#define OVERLAY_Y 96
+#define OVERLAY_LINE 24
+
+void prof_render_overlay(void) {
+    char buf[64];
+    prof_stats_t stats;
+
+    render_draw_rect_2d(OVERLAY_X - 4, OVERLAY_Y - 4, 272, (PROF_SECTION_COUNT + 4) * OVERLAY_LINE + 8,
+                        PACK_COLOR(160, 0, 0, 0));
+    render_draw_text(OVERLAY_X, OVERLAY_Y, COLOR_YELLOW, "us            avg  max");
+
+    for (int i = 0; i < PROF_SECTION_COUNT; i++) {
+        prof_get_stats((prof_section_t)i, &stats);
+        snprintf(buf, sizeof(buf), "%-12.12s%5.0f%5.0f", section_names[i], stats.avg_us, stats.max_us);
+        render_draw_text(OVERLAY_X, OVERLAY_Y + (i + 1) * OVERLAY_LINE, COLOR_WHITE, buf);
+    }
+
+    prof_get_stats(PROF_FRAME, &stats);
+    snprintf(buf, sizeof(buf), "p99 %.2f ms", stats.p99_us / 1000.0f);
+    render_draw_text(OVERLAY_X, OVERLAY_Y + (PROF_SECTION_COUNT + 1) * OVERLAY_LINE, COLOR_CYAN, buf);
+
+    snprintf(buf, sizeof(buf), "drop %lu dup %lu", (unsigned long)pacing.dropped,
+             (unsigned long)pacing.duplicated);
+    render_draw_text(OVERLAY_X, OVERLAY_Y + (PROF_SECTION_COUNT + 2) * OVERLAY_LINE, COLOR_CYAN, buf);
+
+    /* Vertex buffer: worst frame against the budget, and the detail level */
+    prof_get_counter_stats(PROF_COUNT_VERTEX_BYTES, &stats);
+    snprintf(buf, sizeof(buf), "vbuf %.0f/%dK lod %u", stats.max_us / 1024.0f,
+             render_get_vertex_budget() / 1024, (unsigned)last_frame(PROF_SECTION_COUNT + PROF_COUNT_LOD_LEVEL));
+    render_draw_text(OVERLAY_X, OVERLAY_Y + (PROF_SECTION_COUNT + 3) * OVERLAY_LINE, COLOR_CYAN, buf);
+}
+
+void prof_dump(FILE *out) {
+    prof_stats_t stats;
+
+    fprintf(out, "profile: %d frames\n", history_count);
+    fprintf(out, "%-18s %9s %9s %9s %9s\n", "section", "min_us", "avg_us", "max_us", "p99_us");
+    for (int i = 0; i < PROF_SECTION_COUNT; i++) {
+        prof_get_stats((prof_section_t)i, &stats);
+        fprintf(out, "%-18s %9.0f %9.1f %9.0f %9.0f\n", section_names[i],
+                stats.min_us, stats.avg_us, stats.max_us, stats.p99_us);
+    }
+    fprintf(out, "pacing: %lu frames, %lu duplicated, %lu ticks dropped\n",
+            (unsigned long)pacing.frames, (unsigned long)pacing.duplicated,
+            (unsigned long)pacing.dropped);
+
+    fprintf(out, "%-18s %9s %9s %9s %9s\n", "counter", "min", "avg", "max", "p99");
+    for (int i = 0; i < PROF_COUNTER_COUNT; i++) {
+        prof_get_counter_stats((prof_counter_t)i, &stats);
+        fprintf(out, "%-18s %9.0f %9.1f %9.0f %9.0f\n", counter_names[i],
+                stats.min_us, stats.avg_us, stats.max_us, stats.p99_us);
+    }
+    prof_get_counter_stats(PROF_COUNT_VERTEX_BYTES, &stats);
+    fprintf(out, "vertex buffer: %d KB budget, %.0f KB peak, %.0f%% headroom\n",
+            render_get_vertex_budget() / 1024, stats.max_us / 1024.0f,
+            100.0f * (1.0f - stats.max_us / render_get_vertex_budget()));
+    fflush(out);
+}
@@ -0,0 +1,148 @@
+/*
+ * RetroRacer - PVR Command Stream Capture
+ * One frame of headers and vertices into a memory buffer, written out
+ * when the frame ends (a dcload /pc/ path on Dreamcast)
+ */
+
+#include "pvrcap.h"
+#include "render.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Room for a full vertex buffer of textured vertices, plus list records */
+#define VERTEX_RECORD_MAX 25
+#define CAPTURE_BYTES (PVRCAP_FILE_HEADER_BYTES + \
+                       (RENDER_VERTEX_BUFFER_BYTES / RENDER_VERTEX_BYTES) * VERTEX_RECORD_MAX + 256)
+#define CAPTURE_PATH_LEN 256
+
+typedef enum {
+    CAPTURE_IDLE,
+    CAPTURE_ARMED,          /* Starts at the next frame */
+    CAPTURE_RECORDING
+} capture_state_t;
+
+static capture_state_t state = CAPTURE_IDLE;
+static uint8_t *buf = NULL;
+static int len = 0;
+static int flags = 0;
+static int result = -1;
+static char path[CAPTURE_PATH_LEN];
+
+static void put_u16(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+static void put_f32(uint8_t *p, float f) {
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    put_u32(p, v);
+}
+
+/* Space for a record of n bytes, or NULL once the buffer is full */
+static uint8_t *record(int n) {
+    if (len + n > CAPTURE_BYTES - 1) {
+        flags |= PVRCAP_TRUNCATED;
+        return NULL;
+    }
+    uint8_t *p = buf + len;
+    len += n;
+    return p;
+}
+
+int pvrcap_request(const char *file) {
+    if (!buf) {
+        buf = (uint8_t *)malloc(CAPTURE_BYTES);
+        if (!buf) return 0;
+    }
+    strncpy(path, file, CAPTURE_PATH_LEN - 1);
+    path[CAPTURE_PATH_LEN - 1] = '\0';
+    state = CAPTURE_ARMED;
+    return 1;
+}
+
+int pvrcap_result(void) {
+    return result;
+}
+
+int pvrcap_frame_begin(void) {
+    if (state != CAPTURE_ARMED) return state == CAPTURE_RECORDING;
+
+    state = CAPTURE_RECORDING;
+    len = PVRCAP_FILE_HEADER_BYTES;
+    flags = 0;
+    return 1;
+}
+
+void pvrcap_background(uint32_t argb) {
+    uint8_t *p = record(5);
+    if (!p) return;
+    p[0] = PVRCAP_BACKGROUND;
+    put_u32(p + 1, argb);
+}
+
+void pvrcap_list_begin(int list) {
+    uint8_t *p = record(2);
+    if (!p) return;
+    p[0] = PVRCAP_LIST_BEGIN;
+    p[1] = (uint8_t)list;
+}
+
+void pvrcap_header(pvrcap_header_t header) {
+    uint8_t *p = record(2);
+    if (!p) return;
+    p[0] = PVRCAP_HEADER;
+    p[1] = (uint8_t)header;
+}
+
+void pvrcap_vertex(float x, float y, float z, float u, float v, uint32_t argb, int vertex_flags, int textured) {
+    uint8_t *p = record(textured ? 25 : 17);
+    if (!p) return;
+    p[0] = (uint8_t)(PVRCAP_VERTEX | vertex_flags);
+    put_f32(p + 1, x);
+    put_f32(p + 5, y);
+    put_f32(p + 9, z);
+    put_u32(p + 13, argb);
+    if (textured) {
+        put_f32(p + 17, u);
+        put_f32(p + 21, v);
+    }
+}
+
+void pvrcap_list_end(void) {
+    uint8_t *p = record(1);
+    if (p) p[0] = PVRCAP_LIST_END;
+}
+
+void pvrcap_frame_end(void) {
+    if (state != CAPTURE_RECORDING) return;
+    state = CAPTURE_IDLE;
+
+    /* The frame end always fits, record() keeps a byte back for it */
+    buf[len++] = PVRCAP_FRAME_END;
+
+    memcpy(buf, PVRCAP_MAGIC, 4);
+    buf[4] = PVRCAP_VERSION;
+    buf[5] = (uint8_t)flags;
+    put_u16(buf + 6, 640);
+    put_u16(buf + 8, 480);
+    put_u32(buf + 10, (uint32_t)(len - PVRCAP_FILE_HEADER_BYTES));
+
+    FILE *f = fopen(path, "wb");
+    result = 0;
+    if (f) {
+        result = fwrite(buf, 1, len, f) == (size_t)len;
+        result = (fclose(f) == 0) && result;
+    }
+    printf("PVR capture %s: %s (%d bytes%s)\n", result ? "written" : "failed", path, len,
+           (flags & PVRCAP_TRUNCATED) ? ", truncated" : "");
+
+    free(buf);
+    buf = NULL;
+}
@@ -4,6 +4,8 @@
  */
 
 #include "render.h"
+#include "profiler.h"
+#include "pvrcap.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -20,13 +22,88 @@
 #define SCREEN_HEIGHT 480.0f
 #define NEAR_CLIP 1.0f
 
+/* Triangles transformed per batch, even so quad pairs never split */
+#define XF_BATCH_TRIS 128
+
 static camera_t *current_camera = NULL;
+static render_cull_stats_t cull_stats;
+static render_submit_mode_t submit_mode = RENDER_SUBMIT_DIRECT;
+
+/* Vertex buffer accounting for the list being filled */
+static render_vertex_stats_t vertex_stats;
+static render_list_t current_list = RENDER_LIST_OPAQUE;
+
+/* Command stream capture of this frame (pvrcap.h) */
+static int capturing = 0;
+static int capture_textured = 0;    /* Current header takes UVs */
+static int capture_flags = 0;       /* Extra PVRCAP_VERTEX_* flags for the next vertices */
+
+/*
+ * Budget governor. Levels trade the far detail first: border strips
+ * and distant car bodies, then the draw distance itself.
+ */
+#define LOD_HIGH_WATER 0.85f        /* Share of the budget that steps detail down */
+#define LOD_LOW_WATER 0.6f          /* Frames under this share count toward stepping up */
+#define LOD_RECOVER_FRAMES 60
+#define LOD_UNLIMITED 1e18f
+
+static const render_lod_t lod_levels[RENDER_LOD_LEVELS] = {
+    {0, 1.00f, LOD_UNLIMITED, LOD_UNLIMITED},
+    {1, 1.00f, 200.0f, 150.0f},
+    {2, 0.85f, 140.0f, 100.0f},
+    {3, 0.70f, 100.0f, 60.0f},
+    {4, 0.55f, 60.0f, 40.0f}
+};
+
+static int lod_level = 0;
+static int lod_calm_frames = 0;
+static int vertex_budget = RENDER_VERTEX_BUFFER_BYTES;
+
+/* Transformed positions for the current batch */
+static vec3_t xf_buffer[XF_BATCH_TRIS * 3];
+
+/*
+ * Glyph atlas: printable ASCII from the BIOS font, 16 cells per row.
+ * Each cell is 16x24 texels holding one 12x24 glyph.
+ */
+#define FONT_FIRST_CHAR 32
+#define FONT_CHAR_COUNT 96
+#define FONT_GLYPH_W 12
+#define FONT_GLYPH_H 24
+#define FONT_CELL_W 16
+#define FONT_COLUMNS 16
+#define FONT_ATLAS_W 256
+#define FONT_ATLAS_H 256
+
+/* Glyph quads queued during the HUD list, sent in one run at the end */
+#define HUD_MAX_GLYPHS 512
+
+typedef struct {
+    float x, y;
+    uint32_t color;
+    int glyph;
+} hud_glyph_t;
+
+static hud_glyph_t hud_glyphs[HUD_MAX_GLYPHS];
+static int hud_glyph_count = 0;
+
+#ifdef DREAMCAST
+static matrix_t xf_matrix __attribute__((aligned(32)));
+#else
+static mat4_t xf_current;
+static render_vertex_sink_t vertex_sink = NULL;
+#endif
 
 #ifdef DREAMCAST
+static pvr_dr_state_t dr_state;
+static render_submit_mode_t list_submit_mode;  /* Mode of the open list */
 static pvr_poly_hdr_t poly_hdr;
 static pvr_poly_hdr_t poly_hdr_tr;  /* Transparent list header for HUD */
+static pvr_poly_hdr_t poly_hdr_font;  /* Textured transparent header for glyphs */
+static pvr_ptr_t font_texture = NULL;
 static int poly_hdr_initialized = 0;
 static int in_hud_mode = 0;  /* Track if we're rendering HUD */
+static int frame_ready = 0;  /* render_wait_ready() done for the next frame */
 
 static void init_poly_header(void) {
     if (poly_hdr_initialized) return;
@@ -47,55 +124,284 @@ static void init_poly_header(void) {
 
     poly_hdr_initialized = 1;
 }
+
+/* Draw the BIOS font into an ARGB4444 atlas in VRAM, white on clear */
+static void init_font_atlas(void) {
+    size_t size = FONT_ATLAS_W * FONT_ATLAS_H * sizeof(uint16_t);
+    uint16_t *atlas = (uint16_t *)calloc(1, size);
+    if (!atlas) return;
+
+    font_texture = pvr_mem_malloc(size);
+    if (!font_texture) {
+        free(atlas);
+        return;
+    }
+
+    bfont_set_foreground_color(0xFFFFFFFF);
+    bfont_set_background_color(0x00000000);
+    for (int i = 0; i < FONT_CHAR_COUNT; i++) {
+        int col = i % FONT_COLUMNS;
+        int row = i / FONT_COLUMNS;
+        uint16_t *cell = atlas + row * FONT_GLYPH_H * FONT_ATLAS_W + col * FONT_CELL_W;
+        bfont_draw(cell, FONT_ATLAS_W, 1, FONT_FIRST_CHAR + i);
+    }
+
+    pvr_txr_load(atlas, font_texture, size);
+    free(atlas);
+
+    /* Vertex color modulates the white glyphs */
+    pvr_poly_cxt_t cxt;
+    pvr_poly_cxt_txr(&cxt, PVR_LIST_TR_POLY, PVR_TXRFMT_ARGB4444 | PVR_TXRFMT_NONTWIDDLED,
+                     FONT_ATLAS_W, FONT_ATLAS_H, font_texture, PVR_FILTER_NONE);
+    cxt.gen.culling = PVR_CULLING_NONE;
+    cxt.blend.src = PVR_BLEND_SRCALPHA;
+    cxt.blend.dst = PVR_BLEND_INVSRCALPHA;
+    pvr_poly_compile(&poly_hdr_font, &cxt);
+}
+
+/* Open a list and send its header */
+static void submit_list_begin(pvr_list_t list, pvr_poly_hdr_t *hdr) {
+    pvr_list_begin(list);
+    pvr_prim(hdr, sizeof(pvr_poly_hdr_t));
+
+    /* Mode changes only take effect between lists */
+    list_submit_mode = submit_mode;
+    if (list_submit_mode == RENDER_SUBMIT_DIRECT) {
+        pvr_dr_init(&dr_state);
+    }
+}
+
+/* Switch polygon header inside an open list */
+static void submit_header(const pvr_poly_hdr_t *hdr) {
+    if (list_submit_mode == RENDER_SUBMIT_DIRECT) {
+        /* Headers are 32 bytes, the same as a vertex */
+        pvr_poly_hdr_t *target = (pvr_poly_hdr_t *)pvr_dr_target(dr_state);
+        *target = *hdr;
+        pvr_dr_commit(target);
+    } else {
+        pvr_prim((void *)hdr, sizeof(pvr_poly_hdr_t));
+    }
+}
+
+static void submit_list_finish(void) {
+    if (list_submit_mode == RENDER_SUBMIT_DIRECT) {
+        pvr_dr_finish();
+    }
+    pvr_list_finish();
+}
+#endif
+
+/* Note a polygon header in the capture */
+static void capture_header(pvrcap_header_t header) {
+    if (!capturing) return;
+    pvrcap_header(header);
+    capture_textured = header == PVRCAP_HDR_FONT;
+}
+
+/* Send one textured vertex, last ends the current strip */
+static void submit_vertex_uv(float x, float y, float z, float u, float v, uint32_t color, int last) {
+    vertex_stats.vertices[current_list]++;
+    if (capturing) {
+        pvrcap_vertex(x, y, z, u, v, color, capture_flags | (last ? PVRCAP_VERTEX_EOL : 0), capture_textured);
+    }
+
+#ifdef DREAMCAST
+    uint32_t flags = last ? PVR_CMD_VERTEX_EOL : PVR_CMD_VERTEX;
+
+    if (list_submit_mode == RENDER_SUBMIT_DIRECT) {
+        /* Write straight into the store queue, no stack copy */
+        pvr_vertex_t *vert = pvr_dr_target(dr_state);
+        vert->flags = flags;
+        vert->x = x; vert->y = y; vert->z = z;
+        vert->u = u; vert->v = v;
+        vert->argb = color;
+        vert->oargb = 0;
+        pvr_dr_commit(vert);
+    } else {
+        pvr_vertex_t vert;
+        vert.flags = flags;
+        vert.x = x; vert.y = y; vert.z = z;
+        vert.u = u; vert.v = v;
+        vert.argb = color;
+        vert.oargb = 0;
+        pvr_prim(&vert, sizeof(vert));
+    }
+#else
+    (void)u; (void)v;
+    if (vertex_sink) vertex_sink(x, y, z, color, last);
+#endif
+}
+
+/* Send one untextured vertex */
+static void submit_vertex(float x, float y, float z, uint32_t color, int last) {
+    submit_vertex_uv(x, y, z, 0, 0, color, last);
+}
+
+#ifndef DREAMCAST
+void render_set_vertex_sink(render_vertex_sink_t sink) {
+    vertex_sink = sink;
+}
 #endif
 
+void render_set_submit_mode(render_submit_mode_t mode) {
+    submit_mode = mode;
+}
+
+render_submit_mode_t render_get_submit_mode(void) {
+    return submit_mode;
+}
+
 void render_init(void) {
 #ifdef DREAMCAST
     pvr_init_params_t params = {
         { PVR_BINSIZE_16, PVR_BINSIZE_0, PVR_BINSIZE_16, PVR_BINSIZE_0, PVR_BINSIZE_0 },
-        512 * 1024
+        RENDER_VERTEX_BUFFER_BYTES
     };
     pvr_init(&params);
     vid_set_mode(DM_640x480, PM_RGB565);
     init_poly_header();
+    init_font_atlas();
+#endif
+}
+
+void render_wait_ready(void) {
+#ifdef DREAMCAST
+    if (!frame_ready) {
+        pvr_wait_ready();
+        frame_ready = 1;
+    }
 #endif
 }
 
 void render_begin_frame(void) {
+    memset(&cull_stats, 0, sizeof(cull_stats));
+    memset(&vertex_stats, 0, sizeof(vertex_stats));
+    current_list = RENDER_LIST_OPAQUE;
+    vertex_stats.headers[current_list]++;
+
+    capturing = pvrcap_frame_begin();
+    if (capturing) {
+        pvrcap_list_begin(RENDER_LIST_OPAQUE);
+        capture_header(PVRCAP_HDR_OPAQUE);
+    }
+
 #ifdef DREAMCAST
-    pvr_wait_ready();
+    render_wait_ready();
+    frame_ready = 0;
     pvr_scene_begin();
-    pvr_list_begin(PVR_LIST_OP_POLY);
-    pvr_prim(&poly_hdr, sizeof(poly_hdr));
+    submit_list_begin(PVR_LIST_OP_POLY, &poly_hdr);
 #endif
 }
 
 void render_end_frame(void) {
+    if (capturing) pvrcap_list_end();
 #ifdef DREAMCAST
-    pvr_list_finish();
+    submit_list_finish();
     /* Don't finish scene yet - HUD rendering may follow */
 #endif
 }
 
 /* Begin HUD rendering mode - switches to transparent polygon list */
 void render_begin_hud(void) {
+    hud_glyph_count = 0;
+    current_list = RENDER_LIST_TRANSLUCENT;
+    vertex_stats.headers[current_list]++;
+    if (capturing) {
+        pvrcap_list_begin(RENDER_LIST_TRANSLUCENT);
+        capture_header(PVRCAP_HDR_BLEND);
+    }
 #ifdef DREAMCAST
-    pvr_list_begin(PVR_LIST_TR_POLY);
-    pvr_prim(&poly_hdr_tr, sizeof(poly_hdr_tr));
+    submit_list_begin(PVR_LIST_TR_POLY, &poly_hdr_tr);
     in_hud_mode = 1;
 #endif
 }
 
+/* Send every queued glyph under a single textured header */
+static void flush_hud_glyphs(void) {
+    const float du = (float)FONT_GLYPH_W / FONT_ATLAS_W;
+    const float dv = (float)FONT_GLYPH_H / FONT_ATLAS_H;
+    const float z = 1.1f;  /* Just in front of HUD rectangles */
+
+    if (hud_glyph_count == 0) return;
+
+#ifdef DREAMCAST
+    if (!font_texture) {
+        hud_glyph_count = 0;
+        return;
+    }
+    submit_header(&poly_hdr_font);
+#endif
+    vertex_stats.headers[current_list]++;
+    capture_header(PVRCAP_HDR_FONT);
+
+    for (int i = 0; i < hud_glyph_count; i++) {
+        const hud_glyph_t *g = &hud_glyphs[i];
+        float u = (float)((g->glyph % FONT_COLUMNS) * FONT_CELL_W) / FONT_ATLAS_W;
+        float v = (float)((g->glyph / FONT_COLUMNS) * FONT_GLYPH_H) / FONT_ATLAS_H;
+        float x1 = g->x + FONT_GLYPH_W;
+        float y1 = g->y + FONT_GLYPH_H;
+
+        submit_vertex_uv(g->x, g->y, z, u, v, g->color, 0);
+        submit_vertex_uv(x1, g->y, z, u + du, v, g->color, 0);
+        submit_vertex_uv(g->x, y1, z, u, v + dv, g->color, 0);
+        submit_vertex_uv(x1, y1, z, u + du, v + dv, g->color, 1);
+    }
+    hud_glyph_count = 0;
+}
+
+/* Step the detail level from the bytes of the frame just finished */
+static void lod_govern(int bytes) {
+    if (bytes > vertex_budget * LOD_HIGH_WATER) {
+        if (lod_level < RENDER_LOD_LEVELS - 1) lod_level++;
+        lod_calm_frames = 0;
+    } else if (bytes < vertex_budget * LOD_LOW_WATER && lod_level > 0) {
+        if (++lod_calm_frames >= LOD_RECOVER_FRAMES) {
+            lod_level--;
+            lod_calm_frames = 0;
+        }
+    } else {
+        lod_calm_frames = 0;
+    }
+}
+
+/* Frame complete: total the lists, report them and govern the next frame */
+static void finish_vertex_stats(void) {
+    int total = 0;
+    for (int l = 0; l < RENDER_LIST_COUNT; l++) {
+        vertex_stats.bytes[l] = (vertex_stats.vertices[l] + vertex_stats.headers[l]) * RENDER_VERTEX_BYTES;
+        total += vertex_stats.bytes[l];
+    }
+
+    prof_count(PROF_COUNT_OP_VERTICES, (uint32_t)vertex_stats.vertices[RENDER_LIST_OPAQUE]);
+    prof_count(PROF_COUNT_TR_VERTICES, (uint32_t)vertex_stats.vertices[RENDER_LIST_TRANSLUCENT]);
+    prof_count(PROF_COUNT_VERTEX_BYTES, (uint32_t)total);
+    prof_count(PROF_COUNT_LOD_LEVEL, (uint32_t)lod_level);
+
+    lod_govern(total);
+}
+
 /* End HUD rendering and finish the scene */
 void render_end_hud(void) {
+    flush_hud_glyphs();
 #ifdef DREAMCAST
-    pvr_list_finish();
+    submit_list_finish();
+    prof_begin(PROF_SCENE_FINISH);
     pvr_scene_finish();
+    prof_end(PROF_SCENE_FINISH);
     in_hud_mode = 0;
 #endif
+    finish_vertex_stats();
+
+    if (capturing) {
+        pvrcap_list_end();
+        pvrcap_frame_end();
+        capturing = 0;
+        capture_textured = 0;
+    }
 }
 
 void render_clear(uint32_t color) {
+    if (capturing) pvrcap_background(color);
 #ifdef DREAMCAST
     pvr_set_bg_color(
         ((color >> 16) & 0xFF) / 255.0f,
@@ -117,63 +423,107 @@ void camera_update(camera_t *cam) {
         cam->near_plane,
         cam->far_plane
     );
+
+    float tan_half_fov = tanf(deg_to_rad(cam->fov) / 2.0f);
+    cam->frustum_tan_y = tan_half_fov;
+    cam->frustum_tan_x = tan_half_fov * cam->aspect;
+    cam->frustum_norm_x = 1.0f / sqrtf(1.0f + cam->frustum_tan_x * cam->frustum_tan_x);
+    cam->frustum_norm_y = 1.0f / sqrtf(1.0f + cam->frustum_tan_y * cam->frustum_tan_y);
+
+    /* Fold the screen projection scale into the view rows for x and y */
+    float scale_x = SCREEN_WIDTH * 0.5f / cam->frustum_tan_x;
+    float scale_y = -SCREEN_HEIGHT * 0.5f / cam->frustum_tan_y;
+    cam->screen_matrix = cam->view_matrix;
+    for (int c = 0; c < 4; c++) {
+        cam->screen_matrix.m[c * 4 + 0] *= scale_x;
+        cam->screen_matrix.m[c * 4 + 1] *= scale_y;
+    }
 }
 
-/* Transform point to view space (camera space) */
-static vec3_t transform_to_view(vec3_t world_pos) {
-    if (!current_camera) return world_pos;
+render_cull_stats_t *render_get_cull_stats(void) {
+    return &cull_stats;
+}
 
-    mat4_t mv = current_camera->view_matrix;
+const render_vertex_stats_t *render_get_vertex_stats(void) {
+    return &vertex_stats;
+}
 
-    /* Transform by view matrix only (no perspective yet) */
-    vec3_t view;
-    view.x = mv.m[0] * world_pos.x + mv.m[4] * world_pos.y + mv.m[8] * world_pos.z + mv.m[12];
-    view.y = mv.m[1] * world_pos.x + mv.m[5] * world_pos.y + mv.m[9] * world_pos.z + mv.m[13];
-    view.z = mv.m[2] * world_pos.x + mv.m[6] * world_pos.y + mv.m[10] * world_pos.z + mv.m[14];
+const render_lod_t *render_get_lod(void) {
+    return &lod_levels[lod_level];
+}
 
-    return view;
+void render_set_vertex_budget(int bytes) {
+    vertex_budget = bytes > 0 ? bytes : RENDER_VERTEX_BUFFER_BYTES;
+    lod_calm_frames = 0;
 }
 
-/* Project from view space to screen space */
-static int project_to_screen(vec3_t view_pos, float *sx, float *sy, float *sz) {
-    /* Check near plane - reject if behind camera */
-    if (view_pos.z > -NEAR_CLIP) {
-        return 0;
-    }
+int render_get_vertex_budget(void) {
+    return vertex_budget;
+}
+
+int render_sphere_visible(vec3_t center, float radius) {
+    if (!current_camera) return 0;
+
+    camera_t *cam = current_camera;
+    mat4_t *mv = &cam->view_matrix;
+
+    /* View space, camera looks down -Z */
+    float x = mv->m[0] * center.x + mv->m[4] * center.y + mv->m[8] * center.z + mv->m[12];
+    float y = mv->m[1] * center.x + mv->m[5] * center.y + mv->m[9] * center.z + mv->m[13];
+    float depth = -(mv->m[2] * center.x + mv->m[6] * center.y + mv->m[10] * center.z + mv->m[14]);
+
+    /* Near clip and cull distance */
+    if (depth + radius < NEAR_CLIP) return 0;
+    if (depth - radius > cam->cull_distance) return 0;
+
+    /* Side planes through the eye */
+    float limit_x = depth * cam->frustum_tan_x;
+    if ((x - limit_x) * cam->frustum_norm_x > radius) return 0;
+    if ((-x - limit_x) * cam->frustum_norm_x > radius) return 0;
+
+    float limit_y = depth * cam->frustum_tan_y;
+    if ((y - limit_y) * cam->frustum_norm_y > radius) return 0;
+    if ((-y - limit_y) * cam->frustum_norm_y > radius) return 0;
+
+    return 1;
+}
+
+/* Transform point by the camera's screen-scaled view matrix */
+static vec3_t transform_to_view(vec3_t world_pos) {
+    const float *m = current_camera->screen_matrix.m;
 
-    /* Get projection parameters */
-    float fov_rad = deg_to_rad(current_camera->fov);
-    float tan_half_fov = tanf(fov_rad / 2.0f);
-    float aspect = current_camera->aspect;
+    vec3_t view;
+    view.x = m[0] * world_pos.x + m[4] * world_pos.y + m[8] * world_pos.z + m[12];
+    view.y = m[1] * world_pos.x + m[5] * world_pos.y + m[9] * world_pos.z + m[13];
+    view.z = m[2] * world_pos.x + m[6] * world_pos.y + m[10] * world_pos.z + m[14];
 
-    /* Perspective projection */
-    float inv_z = -1.0f / view_pos.z;
-    float proj_x = view_pos.x * inv_z / (aspect * tan_half_fov);
-    float proj_y = view_pos.y * inv_z / tan_half_fov;
+    return view;
+}
 
-    /* Convert from NDC [-1,1] to screen coordinates */
-    *sx = (proj_x + 1.0f) * 0.5f * SCREEN_WIDTH;
-    *sy = (1.0f - proj_y) * 0.5f * SCREEN_HEIGHT;
+/* Project a screen-scaled view space point, caller keeps z in front of the near plane */
+static inline void project_to_screen(const vec3_t *view_pos, float *sx, float *sy, float *sz) {
+    /* Projection scale is already in x/y, see camera_update() */
+    float inv_z = -1.0f / view_pos->z;
+    *sx = view_pos->x * inv_z + SCREEN_WIDTH * 0.5f;
+    *sy = view_pos->y * inv_z + SCREEN_HEIGHT * 0.5f;
     *sz = inv_z;  /* PVR uses 1/z for depth */
 
     /* Clamp depth to valid PVR range */
     /* Lower minimum allows better depth separation for far geometry */
     if (*sz < 0.0001f) *sz = 0.0001f;
     if (*sz > 1.0f) *sz = 1.0f;
-
-    return 1;
 }
 
 /* Clip and interpolate edge against near plane */
-static vec3_t clip_edge(vec3_t v_in, vec3_t v_out, uint32_t c_in, uint32_t c_out, uint32_t *c_new) {
-    float d_in = -v_in.z - NEAR_CLIP;
-    float d_out = -v_out.z - NEAR_CLIP;
+static vec3_t clip_edge(const vec3_t *v_in, const vec3_t *v_out, uint32_t c_in, uint32_t c_out, uint32_t *c_new) {
+    float d_in = -v_in->z - NEAR_CLIP;
+    float d_out = -v_out->z - NEAR_CLIP;
     float t = d_in / (d_in - d_out);
 
     vec3_t result;
-    result.x = v_in.x + t * (v_out.x - v_in.x);
-    result.y = v_in.y + t * (v_out.y - v_in.y);
-    result.z = v_in.z + t * (v_out.z - v_in.z);
+    result.x = v_in->x + t * (v_out->x - v_in->x);
+    result.y = v_in->y + t * (v_out->y - v_in->y);
+    result.z = v_in->z + t * (v_out->z - v_in->z);
 
     /* Interpolate color (simple approach) */
     *c_new = c_in;  /* Just use the inside color for simplicity */
@@ -186,80 +536,55 @@ static vec3_t clip_edge(vec3_t v_in, vec3_t v_out, uint32_t c_in, uint32_t c_out
 static void submit_triangle(float x0, float y0, float z0, uint32_t c0,
                             float x1, float y1, float z1, uint32_t c1,
                             float x2, float y2, float z2, uint32_t c2) {
-#ifdef DREAMCAST
-    pvr_vertex_t vert;
-
-    vert.flags = PVR_CMD_VERTEX;
-    vert.x = x0; vert.y = y0; vert.z = z0;
-    vert.u = 0; vert.v = 0;
-    vert.argb = c0;
-    vert.oargb = 0;
-    pvr_prim(&vert, sizeof(vert));
-
-    vert.x = x1; vert.y = y1; vert.z = z1;
-    vert.argb = c1;
-    pvr_prim(&vert, sizeof(vert));
-
-    vert.flags = PVR_CMD_VERTEX_EOL;
-    vert.x = x2; vert.y = y2; vert.z = z2;
-    vert.argb = c2;
-    pvr_prim(&vert, sizeof(vert));
-#else
-    (void)x0; (void)y0; (void)z0; (void)c0;
-    (void)x1; (void)y1; (void)z1; (void)c1;
-    (void)x2; (void)y2; (void)z2; (void)c2;
-#endif
+    submit_vertex(x0, y0, z0, c0, 0);
+    submit_vertex(x1, y1, z1, c1, 0);
+    submit_vertex(x2, y2, z2, c2, 1);
 }
 
-void render_draw_triangle(vertex_t *v0, vertex_t *v1, vertex_t *v2) {
-    if (!current_camera) return;
-
-    /* Transform to view space */
-    vec3_t vp0 = transform_to_view(v0->pos);
-    vec3_t vp1 = transform_to_view(v1->pos);
-    vec3_t vp2 = transform_to_view(v2->pos);
-
+/* Clip and draw a triangle already in screen-scaled view space */
+static void draw_view_triangle(const vec3_t *vp0, const vec3_t *vp1, const vec3_t *vp2,
+                               uint32_t col0, uint32_t col1, uint32_t col2) {
     /* Check which vertices are in front of near plane */
     /* In view space, camera looks down -Z, so z < -NEAR_CLIP is visible */
-    int in0 = (vp0.z < -NEAR_CLIP) ? 1 : 0;
-    int in1 = (vp1.z < -NEAR_CLIP) ? 1 : 0;
-    int in2 = (vp2.z < -NEAR_CLIP) ? 1 : 0;
+    int in0 = (vp0->z < -NEAR_CLIP) ? 1 : 0;
+    int in1 = (vp1->z < -NEAR_CLIP) ? 1 : 0;
+    int in2 = (vp2->z < -NEAR_CLIP) ? 1 : 0;
     int num_in = in0 + in1 + in2;
 
     /* All vertices behind camera - skip entirely */
     if (num_in == 0) return;
 
-    float sx0, sy0, sz0;
-    float sx1, sy1, sz1;
-    float sx2, sy2, sz2;
-
     if (num_in == 3) {
         /* All vertices visible - project and draw */
-        if (!project_to_screen(vp0, &sx0, &sy0, &sz0)) return;
-        if (!project_to_screen(vp1, &sx1, &sy1, &sz1)) return;
-        if (!project_to_screen(vp2, &sx2, &sy2, &sz2)) return;
+        float sx0, sy0, sz0;
+        float sx1, sy1, sz1;
+        float sx2, sy2, sz2;
+
+        project_to_screen(vp0, &sx0, &sy0, &sz0);
+        project_to_screen(vp1, &sx1, &sy1, &sz1);
+        project_to_screen(vp2, &sx2, &sy2, &sz2);
 
-        submit_triangle(sx0, sy0, sz0, v0->color,
-                        sx1, sy1, sz1, v1->color,
-                        sx2, sy2, sz2, v2->color);
+        submit_triangle(sx0, sy0, sz0, col0,
+                        sx1, sy1, sz1, col1,
+                        sx2, sy2, sz2, col2);
     }
     else if (num_in == 1) {
         /* One vertex visible - clip to form one triangle */
-        vec3_t vp_in, vp_out1, vp_out2;
+        const vec3_t *vp_in, *vp_out1, *vp_out2;
         uint32_t c_in, c_out1, c_out2;
 
         if (in0) {
-            vp_in = vp0; c_in = v0->color;
-            vp_out1 = vp1; c_out1 = v1->color;
-            vp_out2 = vp2; c_out2 = v2->color;
+            vp_in = vp0; c_in = col0;
+            vp_out1 = vp1; c_out1 = col1;
+            vp_out2 = vp2; c_out2 = col2;
         } else if (in1) {
-            vp_in = vp1; c_in = v1->color;
-            vp_out1 = vp0; c_out1 = v0->color;
-            vp_out2 = vp2; c_out2 = v2->color;
+            vp_in = vp1; c_in = col1;
+            vp_out1 = vp0; c_out1 = col0;
+            vp_out2 = vp2; c_out2 = col2;
         } else {
-            vp_in = vp2; c_in = v2->color;
-            vp_out1 = vp0; c_out1 = v0->color;
-            vp_out2 = vp1; c_out2 = v1->color;
+            vp_in = vp2; c_in = col2;
+            vp_out1 = vp0; c_out1 = col0;
+            vp_out2 = vp1; c_out2 = col1;
         }
 
         uint32_t c_clip1, c_clip2;
@@ -270,31 +595,33 @@ void render_draw_triangle(vertex_t *v0, vertex_t *v1, vertex_t *v2) {
         float sx_c1, sy_c1, sz_c1;
         float sx_c2, sy_c2, sz_c2;
 
-        if (!project_to_screen(vp_in, &sx_in, &sy_in, &sz_in)) return;
-        if (!project_to_screen(vp_clip1, &sx_c1, &sy_c1, &sz_c1)) return;
-        if (!project_to_screen(vp_clip2, &sx_c2, &sy_c2, &sz_c2)) return;
+        project_to_screen(vp_in, &sx_in, &sy_in, &sz_in);
+        project_to_screen(&vp_clip1, &sx_c1, &sy_c1, &sz_c1);
+        project_to_screen(&vp_clip2, &sx_c2, &sy_c2, &sz_c2);
 
+        capture_flags = PVRCAP_VERTEX_CLIPPED;
         submit_triangle(sx_in, sy_in, sz_in, c_in,
                         sx_c1, sy_c1, sz_c1, c_clip1,
                         sx_c2, sy_c2, sz_c2, c_clip2);
+        capture_flags = 0;
     }
-    else if (num_in == 2) {
+    else {
         /* Two vertices visible - clip to form a quad (two triangles) */
-        vec3_t vp_in1, vp_in2, vp_out;
+        const vec3_t *vp_in1, *vp_in2, *vp_out;
         uint32_t c_in1, c_in2, c_out;
 
         if (!in0) {
-            vp_out = vp0; c_out = v0->color;
-            vp_in1 = vp1; c_in1 = v1->color;
-            vp_in2 = vp2; c_in2 = v2->color;
+            vp_out = vp0; c_out = col0;
+            vp_in1 = vp1; c_in1 = col1;
+            vp_in2 = vp2; c_in2 = col2;
         } else if (!in1) {
-            vp_out = vp1; c_out = v1->color;
-            vp_in1 = vp0; c_in1 = v0->color;
-            vp_in2 = vp2; c_in2 = v2->color;
+            vp_out = vp1; c_out = col1;
+            vp_in1 = vp0; c_in1 = col0;
+            vp_in2 = vp2; c_in2 = col2;
         } else {
-            vp_out = vp2; c_out = v2->color;
-            vp_in1 = vp0; c_in1 = v0->color;
-            vp_in2 = vp1; c_in2 = v1->color;
+            vp_out = vp2; c_out = col2;
+            vp_in1 = vp0; c_in1 = col0;
+            vp_in2 = vp1; c_in2 = col1;
         }
 
         uint32_t c_clip1, c_clip2;
@@ -306,12 +633,13 @@ void render_draw_triangle(vertex_t *v0, vertex_t *v1, vertex_t *v2) {
         float sx_c1, sy_c1, sz_c1;
         float sx_c2, sy_c2, sz_c2;
 
-        if (!project_to_screen(vp_in1, &sx_i1, &sy_i1, &sz_i1)) return;
-        if (!project_to_screen(vp_in2, &sx_i2, &sy_i2, &sz_i2)) return;
-        if (!project_to_screen(vp_clip1, &sx_c1, &sy_c1, &sz_c1)) return;
-        if (!project_to_screen(vp_clip2, &sx_c2, &sy_c2, &sz_c2)) return;
+        project_to_screen(vp_in1, &sx_i1, &sy_i1, &sz_i1);
+        project_to_screen(vp_in2, &sx_i2, &sy_i2, &sz_i2);
+        project_to_screen(&vp_clip1, &sx_c1, &sy_c1, &sz_c1);
+        project_to_screen(&vp_clip2, &sx_c2, &sy_c2, &sz_c2);
 
         /* First triangle */
+        capture_flags = PVRCAP_VERTEX_CLIPPED;
         submit_triangle(sx_i1, sy_i1, sz_i1, c_in1,
                         sx_c1, sy_c1, sz_c1, c_clip1,
                         sx_i2, sy_i2, sz_i2, c_in2);
@@ -320,27 +648,146 @@ void render_draw_triangle(vertex_t *v0, vertex_t *v1, vertex_t *v2) {
         submit_triangle(sx_i2, sy_i2, sz_i2, c_in2,
                         sx_c1, sy_c1, sz_c1, c_clip1,
                         sx_c2, sy_c2, sz_c2, c_clip2);
+        capture_flags = 0;
     }
 }
 
-void render_draw_mesh(mesh_t *mesh, mat4_t transform) {
-    if (!mesh || !current_camera) return;
+/* Load the combined transform used by xf_transform_vertices() */
+static void xf_load_matrix(const mat4_t *m) {
+#ifdef DREAMCAST
+    /* mat4_t is column-major, the same layout XMTRX expects */
+    memcpy(xf_matrix, m->m, sizeof(xf_matrix));
+    mat_load(&xf_matrix);
+#else
+    xf_current = *m;
+#endif
+}
+
+/* Transform count vertex positions into xf_buffer (first pass) */
+static void xf_transform_vertices(const vertex_t *restrict in, int count) {
+    vec3_t *restrict out = xf_buffer;
+
+#ifdef DREAMCAST
+    for (int i = 0; i < count; i++) {
+        float x = in[i].pos.x;
+        float y = in[i].pos.y;
+        float z = in[i].pos.z;
+        mat_trans_single3_nodiv(x, y, z);
+        out[i].x = x;
+        out[i].y = y;
+        out[i].z = z;
+    }
+#else
+    /* Matrix in locals so the loop has no aliasing and can vectorize */
+    const float *m = xf_current.m;
+    const float m0 = m[0], m1 = m[1], m2 = m[2];
+    const float m4 = m[4], m5 = m[5], m6 = m[6];
+    const float m8 = m[8], m9 = m[9], m10 = m[10];
+    const float m12 = m[12], m13 = m[13], m14 = m[14];
+
+    for (int i = 0; i < count; i++) {
+        float x = in[i].pos.x;
+        float y = in[i].pos.y;
+        float z = in[i].pos.z;
+        out[i].x = m0 * x + m4 * y + m8 * z + m12;
+        out[i].y = m1 * x + m5 * y + m9 * z + m13;
+        out[i].z = m2 * x + m6 * y + m10 * z + m14;
+    }
+#endif
+}
 
-    for (int i = 0; i < mesh->tri_count; i++) {
-        triangle_t *tri = &mesh->triangles[i];
+/*
+ * Draw quad (a,b,c) + (a,c,d) from transformed corners as one 4-vertex strip b,c,a,d.
+ * Strips end at each quad: no mesh has quads sharing an edge with the next one.
+ * Track segments are separately rotated boxes, alternately coloured, baked
+ * into stream slots in any order, so a ribbon would need new road geometry.
+ */
+static void draw_quad_strip(const vec3_t *xf, const triangle_t *t0, const triangle_t *t1) {
+    const vec3_t *order[4] = {&xf[1], &xf[2], &xf[0], &xf[5]};
+    uint32_t color[4] = {t0->v[1].color, t0->v[2].color, t0->v[0].color, t1->v[2].color};
+    float sx[4], sy[4], sz[4];
+
+    /* Any vertex behind the near plane needs per-triangle clipping */
+    for (int i = 0; i < 4; i++) {
+        if (order[i]->z >= -NEAR_CLIP) {
+            draw_view_triangle(&xf[0], &xf[1], &xf[2], t0->v[0].color, t0->v[1].color, t0->v[2].color);
+            draw_view_triangle(&xf[3], &xf[4], &xf[5], t1->v[0].color, t1->v[1].color, t1->v[2].color);
+            return;
+        }
+    }
 
-        vertex_t v0 = tri->v[0];
-        vertex_t v1 = tri->v[1];
-        vertex_t v2 = tri->v[2];
+    for (int i = 0; i < 4; i++) {
+        project_to_screen(order[i], &sx[i], &sy[i], &sz[i]);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        submit_vertex(sx[i], sy[i], sz[i], color[i], i == 3);
+    }
+}
 
-        v0.pos = mat4_transform_vec3(transform, v0.pos);
-        v1.pos = mat4_transform_vec3(transform, v1.pos);
-        v2.pos = mat4_transform_vec3(transform, v2.pos);
+/* Transform triangles [first, end) with m in batches, then clip and submit */
+static void draw_mesh_batched(mesh_t *mesh, int first, int end, const mat4_t *m) {
+    int quads = mesh->strip_quads && (first & 1) == 0;
+
+    xf_load_matrix(m);
+
+    while (first < end) {
+        int n = end - first;
+        if (n > XF_BATCH_TRIS) n = XF_BATCH_TRIS;
+
+        const triangle_t *tris = &mesh->triangles[first];
+        xf_transform_vertices((const vertex_t *)tris, n * 3);
+
+        const vec3_t *xf = xf_buffer;
+        int i = 0;
+        if (quads) {
+            for (; i + 1 < n; i += 2, xf += 6) {
+                draw_quad_strip(xf, &tris[i], &tris[i + 1]);
+            }
+        }
+        for (; i < n; i++, xf += 3) {
+            draw_view_triangle(&xf[0], &xf[1], &xf[2],
+                               tris[i].v[0].color, tris[i].v[1].color, tris[i].v[2].color);
+        }
 
-        render_draw_triangle(&v0, &v1, &v2);
+        first += n;
     }
 }
 
+void render_draw_triangle(vertex_t *v0, vertex_t *v1, vertex_t *v2) {
+    if (!current_camera) return;
+
+    vec3_t vp0 = transform_to_view(v0->pos);
+    vec3_t vp1 = transform_to_view(v1->pos);
+    vec3_t vp2 = transform_to_view(v2->pos);
+
+    draw_view_triangle(&vp0, &vp1, &vp2, v0->color, v1->color, v2->color);
+}
+
+void render_draw_mesh(mesh_t *mesh, const mat4_t *transform) {
+    if (!mesh || !current_camera) return;
+
+    /* Model, view and projection scale in one matrix */
+    mat4_t combined;
+    mat4_mul_into(&combined, &current_camera->screen_matrix, transform);
+    draw_mesh_batched(mesh, 0, mesh->tri_count, &combined);
+}
+
+void render_draw_mesh_world(mesh_t *mesh) {
+    if (!mesh) return;
+
+    render_draw_mesh_world_range(mesh, 0, mesh->tri_count);
+}
+
+void render_draw_mesh_world_range(mesh_t *mesh, int first, int count) {
+    if (!mesh || !current_camera) return;
+
+    int end = first + count;
+    if (end > mesh->tri_count) end = mesh->tri_count;
+
+    draw_mesh_batched(mesh, first, end, &current_camera->screen_matrix);
+}
+
 void render_draw_quad(vec3_t pos, float width, float height, uint32_t color) {
     vertex_t v0, v1, v2, v3;
 
@@ -365,131 +812,74 @@ void render_wait_vram_ready(void) {
 
 /* Draw a full-screen sky background at minimum depth (behind all 3D geometry) */
 void render_draw_sky_background(uint32_t color) {
-#ifdef DREAMCAST
-    pvr_vertex_t vert;
-
     /* Use a small depth value to ensure sky is always behind 3D geometry */
     /* PVR uses 1/z where higher values are closer, so small values are far away */
     /* Must be less than track's minimum (0.001) but large enough for PVR precision */
     float z = 0.0005f;
 
     /* Full screen quad covering the entire viewport */
-    vert.flags = PVR_CMD_VERTEX;
-    vert.x = 0.0f;
-    vert.y = 0.0f;
-    vert.z = z;
-    vert.u = 0;
-    vert.v = 0;
-    vert.argb = color;
-    vert.oargb = 0;
-    pvr_prim(&vert, sizeof(vert));
-
-    vert.x = 640.0f;
-    vert.y = 0.0f;
-    pvr_prim(&vert, sizeof(vert));
-
-    vert.x = 0.0f;
-    vert.y = 480.0f;
-    pvr_prim(&vert, sizeof(vert));
-
-    vert.flags = PVR_CMD_VERTEX_EOL;
-    vert.x = 640.0f;
-    vert.y = 480.0f;
-    pvr_prim(&vert, sizeof(vert));
-#else
-    (void)color;
-#endif
+    submit_vertex(0.0f, 0.0f, z, color, 0);
+    submit_vertex(640.0f, 0.0f, z, color, 0);
+    submit_vertex(0.0f, 480.0f, z, color, 0);
+    submit_vertex(640.0f, 480.0f, z, color, 1);
 }
 
 /* Draw a 2D rectangle on screen (in HUD mode) */
 void render_draw_rect_2d(int x, int y, int w, int h, uint32_t color) {
-#ifdef DREAMCAST
-    pvr_vertex_t vert;
-
     float fx = (float)x;
     float fy = (float)y;
     float fw = (float)w;
     float fh = (float)h;
     float z = 1.0f;  /* Front of screen */
 
-    vert.flags = PVR_CMD_VERTEX;
-    vert.x = fx;
-    vert.y = fy;
-    vert.z = z;
-    vert.u = 0;
-    vert.v = 0;
-    vert.argb = color;
-    vert.oargb = 0;
-    pvr_prim(&vert, sizeof(vert));
-
-    vert.x = fx + fw;
-    vert.y = fy;
-    pvr_prim(&vert, sizeof(vert));
-
-    vert.x = fx;
-    vert.y = fy + fh;
-    pvr_prim(&vert, sizeof(vert));
-
-    vert.flags = PVR_CMD_VERTEX_EOL;
-    vert.x = fx + fw;
-    vert.y = fy + fh;
-    pvr_prim(&vert, sizeof(vert));
-#else
-    (void)x; (void)y; (void)w; (void)h; (void)color;
-#endif
+    submit_vertex(fx, fy, z, color, 0);
+    submit_vertex(fx + fw, fy, z, color, 0);
+    submit_vertex(fx, fy + fh, z, color, 0);
+    submit_vertex(fx + fw, fy + fh, z, color, 1);
 }
 
-/* Draw text using simple rectangle-based characters (PVR compatible) */
-/* This draws blocky text that works with PVR rendering */
+/* Queue text as glyph quads, drawn over the rest of the HUD at render_end_hud() */
 void render_draw_text(int x, int y, uint32_t color, const char *text) {
-#ifdef DREAMCAST
-    int char_width = 12;
-    int char_height = 24;
-    int cx = x;
-
-    while (*text) {
-        char c = *text++;
-
-        if (c == ' ') {
-            cx += char_width;
-            continue;
-        }
-
-        /* Draw a simple filled rectangle for each character */
-        /* This gives us visible text until we implement proper font textures */
-
-        /* Draw character background block */
-        render_draw_rect_2d(cx, y, char_width - 2, char_height, color);
-
-        /* For numbers and some letters, draw a pattern to make them recognizable */
-        if (c >= '0' && c <= '9') {
-            /* Draw number pattern - dark inset */
-            uint32_t dark = 0xFF000000 | ((color & 0x00FEFEFE) >> 1);
-            int n = c - '0';
-
-            /* Simple patterns for digits */
-            if (n == 0) {
-                render_draw_rect_2d(cx + 3, y + 3, char_width - 8, char_height - 6, dark);
-            } else if (n == 1) {
-                render_draw_rect_2d(cx + 1, y + 2, 4, char_height - 4, dark);
-            } else {
-                /* Other numbers - just show solid */
-            }
+    float cx = (float)x;
+
+    for (const char *c = text; *c; c++) {
+        int glyph = (unsigned char)*c - FONT_FIRST_CHAR;
+
+        /* Spaces and unknown characters only advance */
+        if (glyph > 0 && glyph < FONT_CHAR_COUNT && hud_glyph_count < HUD_MAX_GLYPHS) {
+            hud_glyph_t *g = &hud_glyphs[hud_glyph_count++];
+            g->x = cx;
+            g->y = (float)y;
+            g->color = color;
+            g->glyph = glyph;
         }
-
-        cx += char_width;
+        cx += FONT_GLYPH_W;
     }
-#else
-    (void)x; (void)y; (void)color;
+
+#ifndef DREAMCAST
     printf("%s\n", text);
 #endif
 }
 
+int render_text_stale(render_text_t *t, int k0, int k1, int k2, int k3) {
+    if (t->valid && t->key[0] == k0 && t->key[1] == k1 && t->key[2] == k2 && t->key[3] == k3) {
+        return 0;
+    }
+    t->key[0] = k0;
+    t->key[1] = k1;
+    t->key[2] = k2;
+    t->key[3] = k3;
+    t->valid = 1;
+    return 1;
+}
+
 /* Create a simple cube mesh */
 mesh_t *mesh_create_cube(float size, uint32_t color) {
     mesh_t *mesh = (mesh_t *)malloc(sizeof(mesh_t));
     mesh->tri_count = 12;
     mesh->triangles = (triangle_t *)malloc(sizeof(triangle_t) * mesh->tri_count);
+    mesh->tri_capacity = mesh->tri_count;
+    mesh->strip_quads = 1;
     mesh->base_color = color;
 
     float hs = size * 0.5f;
@@ -531,9 +921,11 @@ mesh_t *mesh_create_vehicle(uint32_t color) {
     mesh_t *mesh = (mesh_t *)malloc(sizeof(mesh_t));
     mesh->tri_count = 12;
     mesh->triangles = (triangle_t *)malloc(sizeof(triangle_t) * mesh->tri_count);
+    mesh->tri_capacity = mesh->tri_count;
+    mesh->strip_quads = 1;
     mesh->base_color = color;
 
-    float bw = 0.8f, bh = 0.4f, bl = 1.5f;
+    float bw = VEHICLE_MESH_WIDTH, bh = VEHICLE_MESH_HEIGHT, bl = VEHICLE_MESH_LENGTH;
 
     vec3_t body[8] = {
         {-bw/2, 0, -bl/2}, {bw/2, 0, -bl/2},
@@ -570,11 +962,56 @@ mesh_t *mesh_create_vehicle(uint32_t color) {
     return mesh;
 }
 
-/* Create track segment mesh */
-mesh_t *mesh_create_track_segment(float width, float length, uint32_t color) {
+mesh_t *mesh_create_vehicle_impostor(uint32_t color) {
     mesh_t *mesh = (mesh_t *)malloc(sizeof(mesh_t));
     mesh->tri_count = 2;
     mesh->triangles = (triangle_t *)malloc(sizeof(triangle_t) * mesh->tri_count);
+    mesh->tri_capacity = mesh->tri_count;
+    mesh->strip_quads = 1;
+    mesh->base_color = color;
+
+    vec3_t corner[4] = {
+        {-0.5f, 0, 0}, {0.5f, 0, 0},
+        {0.5f, VEHICLE_MESH_HEIGHT, 0}, {-0.5f, VEHICLE_MESH_HEIGHT, 0}
+    };
+
+    for (int t = 0; t < 2; t++) {
+        mesh->triangles[t].v[0].pos = corner[0];
+        mesh->triangles[t].v[1].pos = corner[t + 1];
+        mesh->triangles[t].v[2].pos = corner[t + 2];
+        for (int k = 0; k < 3; k++) {
+            mesh->triangles[t].v[k].color = color;
+        }
+    }
+    return mesh;
+}
+
+/* Mesh header and triangle storage, from the heap or an arena */
+static mesh_t *mesh_alloc(arena_t *arena, int max_triangles) {
+    mesh_t *mesh;
+    if (arena) {
+        mesh = (mesh_t *)arena_alloc(arena, sizeof(mesh_t));
+        if (!mesh) return NULL;
+        mesh->triangles = (triangle_t *)arena_alloc(arena, sizeof(triangle_t) * max_triangles);
+        if (!mesh->triangles) return NULL;
+    } else {
+        mesh = (mesh_t *)malloc(sizeof(mesh_t));
+        mesh->triangles = (triangle_t *)malloc(sizeof(triangle_t) * max_triangles);
+    }
+    mesh->tri_capacity = max_triangles;
+    return mesh;
+}
+
+/* Create track segment mesh */
+mesh_t *mesh_create_track_segment(float width, float length, uint32_t color) {
+    return mesh_create_track_segment_in(NULL, width, length, color);
+}
+
+mesh_t *mesh_create_track_segment_in(arena_t *arena, float width, float length, uint32_t color) {
+    mesh_t *mesh = mesh_alloc(arena, 2);
+    if (!mesh) return NULL;
+    mesh->tri_count = 2;
+    mesh->strip_quads = 1;
     mesh->base_color = color;
 
     float hw = width * 0.5f;
@@ -596,6 +1033,65 @@ mesh_t *mesh_create_track_segment(float width, float length, uint32_t color) {
     return mesh;
 }
 
+/* Create empty mesh for baked geometry */
+mesh_t *mesh_create_static(int max_triangles) {
+    return mesh_create_static_in(NULL, max_triangles);
+}
+
+mesh_t *mesh_create_static_in(arena_t *arena, int max_triangles) {
+    mesh_t *mesh = mesh_alloc(arena, max_triangles);
+    if (!mesh) return NULL;
+    mesh->tri_count = 0;
+    mesh->strip_quads = 1;  /* Stays set while only quad pairs are appended */
+    mesh->base_color = COLOR_WHITE;
+    return mesh;
+}
+
+int mesh_append_transformed(mesh_t *dst, mesh_t *src, const mat4_t *transform) {
+    int first = dst->tri_count;
+
+    if (!src->strip_quads || (src->tri_count & 1)) {
+        dst->strip_quads = 0;
+    }
+
+    for (int i = 0; i < src->tri_count && dst->tri_count < dst->tri_capacity; i++) {
+        triangle_t *tri = &dst->triangles[dst->tri_count++];
+        *tri = src->triangles[i];
+
+        mat4_transform_into(&tri->v[0].pos, transform, &tri->v[0].pos);
+        mat4_transform_into(&tri->v[1].pos, transform, &tri->v[1].pos);
+        mat4_transform_into(&tri->v[2].pos, transform, &tri->v[2].pos);
+    }
+
+    return first;
+}
+
+int mesh_append_quad(mesh_t *dst, vec3_t pos, float width, float height, uint32_t color) {
+    int first = dst->tri_count;
+    if (dst->tri_count + 2 > dst->tri_capacity) return first;
+
+    /* Same layout as render_draw_quad() */
+    float hw = width * 0.5f;
+    float hh = height * 0.5f;
+
+    vertex_t v0, v1, v2, v3;
+    memset(&v0, 0, sizeof(vertex_t));
+    v0.color = color;
+    v1 = v2 = v3 = v0;
+
+    v0.pos = vec3_create(pos.x - hw, pos.y, pos.z - hh);
+    v1.pos = vec3_create(pos.x + hw, pos.y, pos.z - hh);
+    v2.pos = vec3_create(pos.x + hw, pos.y, pos.z + hh);
+    v3.pos = vec3_create(pos.x - hw, pos.y, pos.z + hh);
+
+    triangle_t *tri = &dst->triangles[dst->tri_count++];
+    tri->v[0] = v0; tri->v[1] = v1; tri->v[2] = v2;
+    tri = &dst->triangles[dst->tri_count++];
+    tri->v[0] = v0; tri->v[1] = v2; tri->v[2] = v3;
+
+    return first;
+}
+
 void mesh_destroy(mesh_t *mesh) {
     if (mesh) {
         if (mesh->triangles) free(mesh->triangles);
@@ -0,0 +1,469 @@
+/*
+ * RetroRacer - Replay and Ghost System Implementation
+ *
+ * Input stream, one token per run of ticks:
+ *   0x00-0x7F  previous controls for (token + 1) ticks
+ *   0x80|mask  one tick, followed by a zigzag varint delta for each
+ *              changed channel (bit 0 steering, 1 throttle, 2 brake)
+ *
+ * Pose stream, one keyframe every REPLAY_KEYFRAME_TICKS: quantized x, y,
+ * z and heading as zigzag varints, the first absolute and the rest as the
+ * change in delta from the previous keyframe. A car moving steadily
+ * costs about one byte per component.
+ */
+
+#include "replay.h"
+#include "game.h"
+#include "fastmath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef DREAMCAST
+#include <kos.h>
+#include <kos/fs.h>
+#include <dc/vmu_pkg.h>
+#endif
+
+#define REPLAY_VERSION 1
+#define REPLAY_VMU_PATH "/vmu/a1/RRGHOST"
+
+/* Longest single token in each stream */
+#define INPUT_TOKEN_MAX (1 + 3 * 2)
+#define POSE_TOKEN_MAX (4 * 5)
+
+#define HEADING_SCALE (REPLAY_HEADING_STEPS / 6.28318531f)
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static int put_varint(uint8_t *buf, int len, int32_t value) {
+    uint32_t v = zigzag(value);
+    while (v >= 0x80) {
+        buf[len++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    buf[len++] = (uint8_t)v;
+    return len;
+}
+
+/* Returns the new offset, or -1 if the value runs past len */
+static int get_varint(const uint8_t *buf, int offset, int len, int32_t *value) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (offset >= len) return -1;
+        uint8_t b = buf[offset++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *value = unzigzag(v);
+            return offset;
+        }
+    }
+    return -1;
+}
+
+replay_input_t replay_quantize_input(float steering, float throttle, float brake) {
+    replay_input_t in;
+    in.steering = (int8_t)(clamp(steering, -1.0f, 1.0f) * 127.0f + (steering < 0 ? -0.5f : 0.5f));
+    in.throttle = (uint8_t)(clamp(throttle, 0.0f, 1.0f) * 255.0f + 0.5f);
+    in.brake = (uint8_t)(clamp(brake, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return in;
+}
+
+void replay_apply_input(const replay_input_t *in, vehicle_t *vehicle) {
+    vehicle_set_steering(vehicle, in->steering * (1.0f / 127.0f));
+    vehicle_set_throttle(vehicle, in->throttle * (1.0f / 255.0f));
+    vehicle_set_brake(vehicle, in->brake * (1.0f / 255.0f));
+}
+
+void replay_begin(replay_t *r, const replay_setup_t *setup) {
+    memset(r, 0, sizeof(replay_t));
+    r->setup = *setup;
+    r->finish_time = -1.0f;
+    r->flags = REPLAY_HAS_INPUTS;
+}
+
+static void flush_repeat(replay_t *r) {
+    if (r->repeat > 0) {
+        r->inputs[r->input_len++] = (uint8_t)(r->repeat - 1);
+        r->repeat = 0;
+    }
+}
+
+static void record_input(replay_t *r, const replay_input_t *in) {
+    if (r->flags & REPLAY_INPUTS_FULL) return;
+    /* Room for a pending repeat, this tick's token and the final flush */
+    if (r->input_len + 2 + INPUT_TOKEN_MAX > REPLAY_INPUT_BYTES) {
+        flush_repeat(r);
+        r->flags |= REPLAY_INPUTS_FULL;
+        return;
+    }
+
+    replay_input_t *last = &r->last_input;
+    if (in->steering == last->steering && in->throttle == last->throttle && in->brake == last->brake) {
+        if (++r->repeat == 128) flush_repeat(r);
+        return;
+    }
+
+    flush_repeat(r);
+    int mask = (in->steering != last->steering ? 1 : 0) |
+               (in->throttle != last->throttle ? 2 : 0) |
+               (in->brake != last->brake ? 4 : 0);
+    r->inputs[r->input_len++] = (uint8_t)(0x80 | mask);
+    if (mask & 1) r->input_len = put_varint(r->inputs, r->input_len, in->steering - last->steering);
+    if (mask & 2) r->input_len = put_varint(r->inputs, r->input_len, in->throttle - last->throttle);
+    if (mask & 4) r->input_len = put_varint(r->inputs, r->input_len, in->brake - last->brake);
+    *last = *in;
+}
+
+static void record_pose(replay_t *r, vec3_t pos, float heading) {
+    if (r->flags & REPLAY_POSES_FULL) return;
+    if (r->pose_len + POSE_TOKEN_MAX > REPLAY_POSE_BYTES) {
+        r->flags |= REPLAY_POSES_FULL;
+        return;
+    }
+
+    int32_t q[4];
+    q[0] = (int32_t)floorf(pos.x * REPLAY_POS_SCALE + 0.5f);
+    q[1] = (int32_t)floorf(pos.y * REPLAY_POS_SCALE + 0.5f);
+    q[2] = (int32_t)floorf(pos.z * REPLAY_POS_SCALE + 0.5f);
+    q[3] = (int32_t)floorf(heading * HEADING_SCALE + 0.5f) & (REPLAY_HEADING_STEPS - 1);
+
+    for (int c = 0; c < 4; c++) {
+        int32_t value;
+        if (r->pose_count == 0) {
+            value = q[c];
+        } else {
+            int32_t d = q[c] - r->pose_last[c];
+            if (c == 3) {
+                /* Shortest way round */
+                d = ((d + REPLAY_HEADING_STEPS / 2) & (REPLAY_HEADING_STEPS - 1)) - REPLAY_HEADING_STEPS / 2;
+            }
+            value = d - r->pose_delta[c];
+            r->pose_delta[c] = d;
+        }
+        r->pose_len = put_varint(r->poses, r->pose_len, value);
+        r->pose_last[c] = q[c];
+    }
+    r->pose_count++;
+}
+
+void replay_record_tick(replay_t *r, const replay_input_t *in, vec3_t pos, float heading) {
+    record_input(r, in);
+    if (r->ticks % REPLAY_KEYFRAME_TICKS == 0) {
+        record_pose(r, pos, heading);
+    }
+    r->ticks++;
+}
+
+void replay_finish(replay_t *r, float finish_time) {
+    if (!(r->flags & REPLAY_INPUTS_FULL)) {
+        flush_repeat(r);
+    }
+    r->finish_time = finish_time;
+}
+
+void replay_reader_init(replay_reader_t *reader) {
+    memset(reader, 0, sizeof(replay_reader_t));
+}
+
+void replay_read_input(const replay_t *r, replay_reader_t *reader, replay_input_t *out) {
+    if (reader->repeat > 0) {
+        reader->repeat--;
+        *out = reader->current;
+        return;
+    }
+
+    if (reader->offset >= r->input_len) {
+        memset(&reader->current, 0, sizeof(replay_input_t));
+        *out = reader->current;
+        return;
+    }
+
+    uint8_t token = r->inputs[reader->offset++];
+    if (token < 0x80) {
+        reader->repeat = token;
+    } else {
+        int32_t d[3] = {0, 0, 0};
+        int offset = reader->offset;
+        for (int c = 0; c < 3 && offset >= 0; c++) {
+            if (token & (1 << c)) offset = get_varint(r->inputs, offset, r->input_len, &d[c]);
+        }
+
+        if (offset < 0) {
+            /* Cut off mid token, treat as the end of the stream */
+            reader->offset = r->input_len;
+        } else {
+            replay_input_t *cur = &reader->current;
+            cur->steering = (int8_t)(cur->steering + d[0]);
+            cur->throttle = (uint8_t)(cur->throttle + d[1]);
+            cur->brake = (uint8_t)(cur->brake + d[2]);
+            reader->offset = offset;
+        }
+    }
+    *out = reader->current;
+}
+
+void replay_ghost_init(replay_ghost_t *ghost) {
+    memset(ghost, 0, sizeof(replay_ghost_t));
+    ghost->index = -1;
+}
+
+/* Decode the next keyframe into key[1], returns 0 at the end of the stream */
+static int ghost_next_key(const replay_t *r, replay_ghost_t *ghost) {
+    if (ghost->index + 1 >= r->pose_count) return 0;
+
+    int32_t v[4];
+    int offset = ghost->offset;
+    for (int c = 0; c < 4; c++) {
+        offset = get_varint(r->poses, offset, r->pose_len, &v[c]);
+        if (offset < 0) return 0;
+    }
+
+    memcpy(ghost->key[0], ghost->key[1], sizeof(ghost->key[0]));
+    for (int c = 0; c < 4; c++) {
+        if (ghost->index < 0) {
+            ghost->key[1][c] = v[c];
+        } else {
+            ghost->delta[c] += v[c];
+            ghost->key[1][c] += ghost->delta[c];
+        }
+    }
+    ghost->offset = offset;
+    ghost->index++;
+    return 1;
+}
+
+int replay_ghost_sample(const replay_t *r, replay_ghost_t *ghost, float t, vec3_t *pos, float *heading) {
+    if (r->pose_count == 0) return 0;
+
+    float k = t * ((float)TARGET_FPS / REPLAY_KEYFRAME_TICKS);
+    if (k < 0) k = 0;
+    int i0 = (int)k;
+    float u = k - (float)i0;
+
+    /* Time went back (a restart), decode from the start again */
+    if (ghost->index > i0 + 1) replay_ghost_init(ghost);
+
+    while (ghost->index < i0 + 1) {
+        if (!ghost_next_key(r, ghost)) break;
+    }
+
+    const float inv_pos = 1.0f / REPLAY_POS_SCALE;
+    const float inv_heading = 1.0f / HEADING_SCALE;
+    const int32_t *k1 = ghost->key[1];
+
+    if (ghost->index < i0 + 1 || ghost->index == 0) {
+        /* Before the second keyframe or past the end, hold the pose */
+        *pos = vec3_create(k1[0] * inv_pos, k1[1] * inv_pos, k1[2] * inv_pos);
+        *heading = k1[3] * inv_heading;
+        return 1;
+    }
+
+    /* Hermite on XZ, tangents along each keyframe's heading */
+    const int32_t *k0 = ghost->key[0];
+    float x0 = k0[0] * inv_pos, z0 = k0[2] * inv_pos;
+    float x1 = k1[0] * inv_pos, z1 = k1[2] * inv_pos;
+    float h0 = k0[3] * inv_heading;
+    float h1 = k1[3] * inv_heading;
+    float chord = sqrtf((x1 - x0) * (x1 - x0) + (z1 - z0) * (z1 - z0));
+
+    float s0, c0, s1, c1;
+    fast_sincos(h0, &s0, &c0);
+    fast_sincos(h1, &s1, &c1);
+
+    float u2 = u * u, u3 = u2 * u;
+    float b00 = 2 * u3 - 3 * u2 + 1;
+    float b10 = u3 - 2 * u2 + u;
+    float b01 = -2 * u3 + 3 * u2;
+    float b11 = u3 - u2;
+
+    pos->x = b00 * x0 + b10 * chord * s0 + b01 * x1 + b11 * chord * s1;
+    pos->z = b00 * z0 + b10 * chord * c0 + b01 * z1 + b11 * chord * c1;
+    pos->y = (k0[1] + (k1[1] - k0[1]) * u) * inv_pos;
+    *heading = h0 + (h1 - h0) * u;
+    return 1;
+}
+
+/* Little endian field access for the file header */
+static void put_u16(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+static uint32_t get_u16(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return get_u16(p) | (get_u16(p + 2) << 16);
+}
+
+/* FNV-1a */
+static uint32_t checksum(const uint8_t *p, int len) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+int replay_encode(const replay_t *r, int include_inputs, uint8_t *buf, int cap) {
+    /* A recording still in progress has a run of ticks not yet written */
+    int pending = (include_inputs && r->repeat > 0) ? 1 : 0;
+    int input_len = include_inputs ? r->input_len + pending : 0;
+    int len = REPLAY_HEADER_BYTES + r->pose_len + input_len + 4;
+    if (len > cap) return 0;
+
+    uint32_t flags = r->flags & ~(uint32_t)REPLAY_HAS_INPUTS;
+    if (include_inputs && (r->flags & REPLAY_HAS_INPUTS)) flags |= REPLAY_HAS_INPUTS;
+
+    uint32_t finish_bits;
+    memcpy(&finish_bits, &r->finish_time, sizeof(finish_bits));
+
+    memset(buf, 0, REPLAY_HEADER_BYTES);
+    memcpy(buf, "RRPL", 4);
+    buf[4] = REPLAY_VERSION;
+    buf[5] = (uint8_t)flags;
+    put_u16(buf + 6, (uint32_t)r->pose_count);
+    put_u32(buf + 8, r->setup.seed);
+    buf[12] = r->setup.mode;
+    buf[13] = r->setup.num_laps;
+    buf[14] = r->setup.num_opponents;
+    buf[15] = r->setup.vehicle_class;
+    buf[16] = r->setup.ai_difficulty;
+    put_u32(buf + 20, r->ticks);
+    put_u32(buf + 24, finish_bits);
+    put_u16(buf + 28, (uint32_t)r->pose_len);
+    put_u16(buf + 30, (uint32_t)input_len);
+
+    memcpy(buf + REPLAY_HEADER_BYTES, r->poses, r->pose_len);
+    memcpy(buf + REPLAY_HEADER_BYTES + r->pose_len, r->inputs, input_len - pending);
+    if (pending) buf[REPLAY_HEADER_BYTES + r->pose_len + input_len - 1] = (uint8_t)(r->repeat - 1);
+    put_u32(buf + len - 4, checksum(buf, len - 4));
+    return len;
+}
+
+int replay_decode(replay_t *r, const uint8_t *buf, int len) {
+    if (len < REPLAY_HEADER_BYTES + 4) return 0;
+    if (memcmp(buf, "RRPL", 4) != 0 || buf[4] != REPLAY_VERSION) return 0;
+
+    int pose_len = (int)get_u16(buf + 28);
+    int input_len = (int)get_u16(buf + 30);
+    if (pose_len > REPLAY_POSE_BYTES || input_len > REPLAY_INPUT_BYTES) return 0;
+    if (len != REPLAY_HEADER_BYTES + pose_len + input_len + 4) return 0;
+    if (get_u32(buf + len - 4) != checksum(buf, len - 4)) return 0;
+
+    replay_setup_t setup;
+    setup.seed = get_u32(buf + 8);
+    setup.mode = buf[12];
+    setup.num_laps = buf[13];
+    setup.num_opponents = buf[14];
+    setup.vehicle_class = buf[15];
+    setup.ai_difficulty = buf[16];
+    replay_begin(r, &setup);
+
+    uint32_t finish_bits = get_u32(buf + 24);
+    memcpy(&r->finish_time, &finish_bits, sizeof(finish_bits));
+    r->flags = buf[5];
+    r->pose_count = (int)get_u16(buf + 6);
+    r->ticks = get_u32(buf + 20);
+    r->pose_len = pose_len;
+    r->input_len = input_len;
+    memcpy(r->poses, buf + REPLAY_HEADER_BYTES, pose_len);
+    memcpy(r->inputs, buf + REPLAY_HEADER_BYTES + pose_len, input_len);
+    return 1;
+}
+
+int replay_save(const replay_t *r, int include_inputs, const char *path) {
+    uint8_t *buf = (uint8_t *)malloc(REPLAY_ENCODED_MAX);
+    if (!buf) return 0;
+
+    int ok = 0;
+    int len = replay_encode(r, include_inputs, buf, REPLAY_ENCODED_MAX);
+    FILE *f = len ? fopen(path, "wb") : NULL;
+    if (f) {
+        ok = fwrite(buf, 1, len, f) == (size_t)len;
+        ok = (fclose(f) == 0) && ok;
+    }
+    free(buf);
+    return ok;
+}
+
+int replay_load(replay_t *r, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+
+    uint8_t *buf = (uint8_t *)malloc(REPLAY_ENCODED_MAX + 1);
+    int ok = 0;
+    if (buf) {
+        size_t len = fread(buf, 1, REPLAY_ENCODED_MAX + 1, f);
+        ok = len <= REPLAY_ENCODED_MAX && replay_decode(r, buf, (int)len);
+        free(buf);
+    }
+    fclose(f);
+    return ok;
+}
+
+#ifdef DREAMCAST
+int replay_save_vmu(const replay_t *r) {
+    uint8_t *buf = (uint8_t *)malloc(REPLAY_ENCODED_MAX);
+    if (!buf) return 0;
+
+    int len = replay_encode(r, 0, buf, REPLAY_ENCODED_MAX);
+    if (!len) {
+        free(buf);
+        return 0;
+    }
+
+    vmu_pkg_t pkg;
+    memset(&pkg, 0, sizeof(pkg));
+    strcpy(pkg.desc_short, "RetroRacer");
+    strcpy(pkg.desc_long, "Time trial ghost");
+    strcpy(pkg.app_id, "RETRORACER");
+    pkg.data_len = len;
+    pkg.data = buf;
+
+    uint8 *out;
+    int out_len;
+    int ok = 0;
+    if (vmu_pkg_build(&pkg, &out, &out_len) >= 0) {
+        file_t f = fs_open(REPLAY_VMU_PATH, O_WRONLY);
+        if (f != FILEHND_INVALID) {
+            ok = fs_write(f, out, out_len) == out_len;
+            fs_close(f);
+        }
+        free(out);
+    }
+    free(buf);
+    return ok;
+}
+
+int replay_load_vmu(replay_t *r) {
+    file_t f = fs_open(REPLAY_VMU_PATH, O_RDONLY);
+    if (f == FILEHND_INVALID) return 0;
+
+    int ok = 0;
+    int size = (int)fs_total(f);
+    uint8_t *buf = size > 0 ? (uint8_t *)malloc(size) : NULL;
+    if (buf && fs_read(f, buf, size) == size) {
+        vmu_pkg_t pkg;
+        if (vmu_pkg_parse(buf, &pkg) >= 0) {
+            ok = replay_decode(r, pkg.data, pkg.data_len);
+        }
+    }
+    free(buf);
+    fs_close(f);
+    return ok;
+}
+#endif
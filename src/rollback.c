@@ -0,0 +1,54 @@
+/*
+ * RetroRacer - Rollback
+ * Snapshot ring and resimulation on top of game_sim_update()
+ */
+
+#include "rollback.h"
+#include <string.h>
+
+static void step(rollback_t *rb, uint32_t tick) {
+    int slot = tick % ROLLBACK_MAX_TICKS;
+    game_t *g = rb->game;
+
+    game_sim_save(g, &rb->snapshots[slot]);
+    g->tick_input = &rb->inputs[slot];
+    game_sim_update(g, FRAME_TIME);
+    g->tick_input = NULL;
+}
+
+void rollback_init(rollback_t *rb, game_t *g) {
+    memset(rb, 0, sizeof(*rb));
+    rb->game = g;
+}
+
+void rollback_advance(rollback_t *rb, const replay_input_t *controls) {
+    rb->inputs[rb->tick % ROLLBACK_MAX_TICKS] = *controls;
+    step(rb, rb->tick);
+    rb->tick++;
+}
+
+int rollback_correct(rollback_t *rb, uint32_t tick, const replay_input_t *controls) {
+    if (tick >= rb->tick || rb->tick - tick > ROLLBACK_MAX_TICKS) {
+        return -1;
+    }
+
+    replay_input_t *stored = &rb->inputs[tick % ROLLBACK_MAX_TICKS];
+    if (memcmp(stored, controls, sizeof(*stored)) == 0) {
+        return 0;
+    }
+    *stored = *controls;
+
+    if (!game_sim_restore(rb->game, &rb->snapshots[tick % ROLLBACK_MAX_TICKS])) {
+        return -1;
+    }
+
+    /* Later ticks keep their controls, their snapshots are retaken */
+    for (uint32_t t = tick; t < rb->tick; t++) {
+        step(rb, t);
+    }
+
+    int count = (int)(rb->tick - tick);
+    rb->rollbacks++;
+    rb->resim_ticks += count;
+    return count;
+}
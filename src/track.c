@@ -9,29 +9,30 @@
 #include <stdio.h>
 #include <time.h>
 
-/* Simple PRNG for procedural generation */
-static uint32_t track_rand_state = 12345;
-
-static uint32_t track_rand(void) {
-    track_rand_state = track_rand_state * 1103515245 + 12345;
-    return (track_rand_state >> 16) & 0x7FFF;
+/* Simple PRNG for procedural generation, state is owned by the caller */
+static uint32_t track_rand(uint32_t *state) {
+    *state = *state * 1103515245 + 12345;
+    return (*state >> 16) & 0x7FFF;
 }
 
-static float track_rand_float(void) {
-    return (float)track_rand() / 32767.0f;
+static float track_rand_float(uint32_t *state) {
+    return (float)track_rand(state) / 32767.0f;
 }
 
-static float track_rand_range(float min, float max) {
-    return min + track_rand_float() * (max - min);
+static float track_rand_range(uint32_t *state, float min, float max) {
+    return min + track_rand_float(state) * (max - min);
 }
 
+/* Only used to pick seeds for new tracks, never during generation */
+static uint32_t seed_rand_state = 12345;
+
 void track_init(void) {
-    track_rand_state = (uint32_t)time(NULL);
+    seed_rand_state = (uint32_t)time(NULL);
 }
 
 track_params_t track_default_params(void) {
     track_params_t params;
-    params.seed = track_random_seed();
+    params.seed = 0;
     params.num_segments = 32;
     params.track_width = 12.0f;
     params.min_straight_length = 20.0f;
@@ -39,38 +40,435 @@ track_params_t track_default_params(void) {
     params.max_curve_angle = 45.0f;
     params.max_elevation = 5.0f;
     params.difficulty = 2;
+    params.closed_loop = 1;
     return params;
 }
 
 uint32_t track_random_seed(void) {
-    return (uint32_t)time(NULL) ^ (track_rand() << 16);
+    return (uint32_t)time(NULL) ^ (track_rand(&seed_rand_state) << 16);
 }
 
-track_t *track_generate(track_params_t *params) {
-    track_t *track = (track_t *)malloc(sizeof(track_t));
-    memset(track, 0, sizeof(track_t));
+/* Segment geometry transform: position, then rotation to face direction */
+static void segment_transform(const track_segment_t *seg, mat4_t *transform) {
+    mat4_translate_into(transform, seg->start_pos.x, seg->start_pos.y, seg->start_pos.z);
+    mat4_rotate_y_by(transform, atan2f(seg->direction.x, seg->direction.z));
+}
 
-    track_rand_state = params->seed;
-    track->seed = params->seed;
+/* Bounding sphere around the midpoint, over the road and border corners */
+static void segment_bounds(track_segment_t *seg) {
+    mat4_t transform;
+    segment_transform(seg, &transform);
+
+    float hw = seg->width / 2 + 1.0f;
+    seg->bound_center = seg->center;
+    seg->bound_radius = 0;
+    for (int k = 0; k < 4; k++) {
+        vec3_t corner = vec3_create((k & 1) ? hw : -hw, 0.05f, (k & 2) ? seg->length : 0);
+        mat4_transform_into(&corner, &transform, &corner);
+        float d = vec3_distance(seg->center, corner);
+        if (d > seg->bound_radius) seg->bound_radius = d;
+    }
+}
 
-    sprintf(track->name, "Track %u", params->seed % 1000);
+static int stream_slots(int num_segments) {
+    return num_segments < TRACK_STREAM_SLOTS ? num_segments : TRACK_STREAM_SLOTS;
+}
 
-    vec3_t current_pos = vec3_create(0, 0, 0);
-    float current_angle = 0;  /* Direction in radians */
-    float total_length = 0;
+/* Geometry pool and the unit quads segments are baked from */
+static int track_stream_init(track_t *track) {
+    track_stream_t *st = &track->stream;
 
-    track->start_position = current_pos;
-    track->start_direction = vec3_create(0, 0, 1);
+    st->slot_count = stream_slots(track->segment_count);
+    st->mesh = mesh_create_static_in(&track->arena, st->slot_count * TRACK_SEGMENT_TRIS + 2);
+    st->road[0] = mesh_create_track_segment_in(&track->arena, 1.0f, 1.0f, PACK_COLOR(255, 70, 70, 70));
+    st->road[1] = mesh_create_track_segment_in(&track->arena, 1.0f, 1.0f, COLOR_ASPHALT);
+    st->border = mesh_create_track_segment_in(&track->arena, 1.0f, 1.0f, COLOR_WHITE);
+    if (!st->mesh || !st->road[0] || !st->road[1] || !st->border) return 0;
 
-    int num_segments = params->num_segments;
-    int checkpoint_interval = num_segments / 8;
-    if (checkpoint_interval < 1) checkpoint_interval = 1;
+    for (int s = 0; s < TRACK_STREAM_SLOTS; s++) {
+        st->slot_segment[s] = -1;
+    }
+    for (int i = 0; i < track->segment_count; i++) {
+        track->segments[i].slot = -1;
+        if (track->segments[i].bound_radius > st->max_bound_radius) {
+            st->max_bound_radius = track->segments[i].bound_radius;
+        }
+    }
+
+    /* Start/finish line, always resident after the slots */
+    vec3_t start_pos = track->start_position;
+    start_pos.y += 0.1f;
+    st->mesh->tri_count = st->slot_count * TRACK_SEGMENT_TRIS;
+    st->start_line_first = mesh_append_quad(st->mesh, start_pos, track->segments[0].width, 2.0f, COLOR_WHITE);
+    return 1;
+}
+
+/* Transform segment i's road and borders into pool slot s */
+static void bake_segment(track_t *track, int i, int s) {
+    track_stream_t *st = &track->stream;
+    track_segment_t *seg = &track->segments[i];
+
+    mat4_t transform;
+    segment_transform(seg, &transform);
+
+    /* Borders sit just outside the road edges */
+    mat4_t left = transform;
+    mat4_t right = transform;
+    mat4_translate_by(&left, -seg->width / 2 - 0.5f, 0.05f, 0);
+    mat4_translate_by(&right, seg->width / 2 + 0.5f, 0.05f, 0);
+
+    mat4_t road = mat4_multiply(transform, mat4_scale(seg->width, 1.0f, seg->length));
+    mat4_t border_scale = mat4_scale(1.0f, 1.0f, seg->length);
+    left = mat4_multiply(left, border_scale);
+    right = mat4_multiply(right, border_scale);
+
+    /* Append at the slot, then put the count back to the whole pool */
+    int count = st->mesh->tri_count;
+    st->mesh->tri_count = s * TRACK_SEGMENT_TRIS;
+    mesh_append_transformed(st->mesh, st->road[i & 1], &road);
+    mesh_append_transformed(st->mesh, st->border, &left);
+    mesh_append_transformed(st->mesh, st->border, &right);
+    st->mesh->tri_count = count;
+
+    st->slot_segment[s] = i;
+    seg->slot = s;
+    st->baked++;
+}
+
+static int in_stream_window(const track_segment_t *seg, vec3_t pos, float radius) {
+    return vec3_distance(pos, seg->bound_center) - seg->bound_radius < radius;
+}
+
+/* Visit the segments within radius of pos through the grid. Returns how
+ * many there are, baking the ones that aren't resident if bake is set. */
+static int stream_window(track_t *track, vec3_t pos, float radius, float reach, int bake) {
+    track_grid_t *grid = &track->grid;
+    track_stream_t *st = &track->stream;
+
+    /* Cells of every midpoint whose bounding sphere can reach the window */
+    float r = radius + reach;
+    int x0 = (int)floorf((pos.x - r - grid->min_x) * grid->inv_cell_size);
+    int x1 = (int)floorf((pos.x + r - grid->min_x) * grid->inv_cell_size);
+    int z0 = (int)floorf((pos.z - r - grid->min_z) * grid->inv_cell_size);
+    int z1 = (int)floorf((pos.z + r - grid->min_z) * grid->inv_cell_size);
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 >= grid->cols) x1 = grid->cols - 1;
+    if (z1 >= grid->rows) z1 = grid->rows - 1;
+
+    int count = 0;
+    int free_slot = 0;
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            int c = z * grid->cols + x;
+            for (int k = grid->cell_start[c]; k < grid->cell_start[c + 1]; k++) {
+                int i = grid->items[k];
+                track_segment_t *seg = &track->segments[i];
+                if (!in_stream_window(seg, pos, radius)) continue;
+                count++;
+
+                if (!bake || seg->slot >= 0) continue;
+                while (free_slot < st->slot_count && st->slot_segment[free_slot] >= 0) free_slot++;
+                if (free_slot == st->slot_count) continue;
+                bake_segment(track, i, free_slot);
+            }
+        }
+    }
+    return count;
+}
+
+void track_stream_update(track_t *track, vec3_t pos, float cull_distance) {
+    track_stream_t *st = &track->stream;
+    if (!st->mesh || track->segment_count == 0) return;
+
+    if (st->valid && vec3_distance(pos, st->center) < TRACK_STREAM_STEP) return;
+    st->center = pos;
+    st->valid = 1;
+
+    float reach = st->max_bound_radius;
+
+    /* Shrink the window until it fits the pool, dropping the far edge */
+    float radius = (cull_distance > 0 ? cull_distance : 1e6f) + TRACK_STREAM_MARGIN;
+    while (stream_window(track, pos, radius, reach, 0) > st->slot_count && radius > 1.0f) {
+        radius *= 0.8f;
+    }
+
+    /* Release what left the window, then bake what entered it */
+    for (int s = 0; s < st->slot_count; s++) {
+        int i = st->slot_segment[s];
+        if (i >= 0 && !in_stream_window(&track->segments[i], pos, radius)) {
+            track->segments[i].slot = -1;
+            st->slot_segment[s] = -1;
+        }
+    }
+    stream_window(track, pos, radius, reach, 1);
+}
+
+static int grid_cell_of(const track_grid_t *grid, vec3_t c) {
+    int cx = (int)((c.x - grid->min_x) * grid->inv_cell_size);
+    int cz = (int)((c.z - grid->min_z) * grid->inv_cell_size);
+    if (cx >= grid->cols) cx = grid->cols - 1;
+    if (cz >= grid->rows) cz = grid->rows - 1;
+    return cz * grid->cols + cx;
+}
+
+/* Build the uniform grid over segment midpoints, returns 0 if out of memory */
+static int track_build_grid(track_t *track) {
+    track_grid_t *grid = &track->grid;
+
+    if (track->segment_count == 0) {
+        memset(grid, 0, sizeof(track_grid_t));
+        return 1;
+    }
+
+    grid->items = (uint16_t *)arena_alloc(&track->arena, sizeof(uint16_t) * (size_t)track->segment_count);
+    if (!grid->items) return 0;
+
+    /* Bounds of all midpoints */
+    float min_x = track->segments[0].center.x, max_x = min_x;
+    float min_z = track->segments[0].center.z, max_z = min_z;
+    for (int i = 1; i < track->segment_count; i++) {
+        vec3_t c = track->segments[i].center;
+        if (c.x < min_x) min_x = c.x;
+        if (c.x > max_x) max_x = c.x;
+        if (c.z < min_z) min_z = c.z;
+        if (c.z > max_z) max_z = c.z;
+    }
+
+    /* Cells roughly one segment long, capped at TRACK_GRID_DIM per axis */
+    float cell = track->total_length / track->segment_count;
+    float extent = (max_x - min_x > max_z - min_z) ? max_x - min_x : max_z - min_z;
+    if (cell < extent / (TRACK_GRID_DIM - 2)) cell = extent / (TRACK_GRID_DIM - 2);
+    if (cell < 1.0f) cell = 1.0f;
+
+    /* Pad by one cell so cars just off the track still hit the grid */
+    grid->cell_size = cell;
+    grid->inv_cell_size = 1.0f / cell;
+    grid->min_x = min_x - cell;
+    grid->min_z = min_z - cell;
+    grid->cols = (int)((max_x - grid->min_x) * grid->inv_cell_size) + 2;
+    grid->rows = (int)((max_z - grid->min_z) * grid->inv_cell_size) + 2;
+    if (grid->cols > TRACK_GRID_DIM) grid->cols = TRACK_GRID_DIM;
+    if (grid->rows > TRACK_GRID_DIM) grid->rows = TRACK_GRID_DIM;
+    grid->max_x = grid->min_x + grid->cols * cell;
+    grid->max_z = grid->min_z + grid->rows * cell;
+
+    /* Counting sort of segments into cells */
+    int num_cells = grid->cols * grid->rows;
+    memset(grid->cell_start, 0, sizeof(grid->cell_start));
+
+    for (int i = 0; i < track->segment_count; i++) {
+        grid->cell_start[grid_cell_of(grid, track->segments[i].center) + 1]++;
+    }
+    for (int c = 0; c < num_cells; c++) {
+        grid->cell_start[c + 1] += grid->cell_start[c];
+    }
+
+    uint16_t fill[TRACK_GRID_CELLS];
+    memcpy(fill, grid->cell_start, sizeof(uint16_t) * num_cells);
+    for (int i = 0; i < track->segment_count; i++) {
+        grid->items[fill[grid_cell_of(grid, track->segments[i].center)]++] = (uint16_t)i;
+    }
+    return 1;
+}
+
+/*
+ * Racing line. The centreline is a polyline whose heading only changes
+ * at segment joints, so curvature is estimated over a window around each
+ * sample. The line moves toward the inside where the curvature peaks
+ * (the apex) and toward the outside RACING_LINE_APEX_LEAD metres before
+ * and after it. Target speed comes from the line's own curvature at
+ * RACING_LINE_LAT_ACCEL, then a backward pass caps every sample at what
+ * can still brake down to the samples after it.
+ */
+#define RACING_LINE_CURVE_WINDOW 10.0f  /* Half-width of the curvature estimate, m */
+#define RACING_LINE_APEX_LEAD 15.0f
+#define RACING_LINE_OFFSET_GAIN 60.0f  /* Offset in m per 1/m of curvature */
+#define RACING_LINE_EDGE_MARGIN 1.5f
+#define RACING_LINE_SMOOTH_PASSES 2
+#define RACING_LINE_LAT_ACCEL 100.0f    /* m/s^2 */
+#define RACING_LINE_BRAKE_DECEL 25.0f   /* m/s^2 */
+#define RACING_LINE_MAX_SPEED 120.0f
+
+/* Upper bound on samples for any track these params can produce */
+static int racing_line_capacity(const track_params_t *params, int num_segments) {
+    float longest = num_segments * params->max_straight_length;
+    int count = (int)(longest / RACING_LINE_SPACING) + 2;
+    return count < RACING_LINE_MAX_SAMPLES ? count : RACING_LINE_MAX_SAMPLES;
+}
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846f
+#endif
+
+static float wrap_angle(float a) {
+    while (a > M_PI) a -= 2.0f * M_PI;
+    while (a < -M_PI) a += 2.0f * M_PI;
+    return a;
+}
+
+/* Neighbour index: wraps on a closed loop, clamps to the ends otherwise */
+static int line_index(int k, int n, int closed) {
+    if (!closed) return k < 0 ? 0 : (k >= n ? n - 1 : k);
+    k %= n;
+    return k < 0 ? k + n : k;
+}
+
+/* Unwrapped heading at any index: line[] holds one lap and on a closed
+ * loop each further lap adds turn, the total heading change */
+static float unwrapped_at(const racing_line_sample_t *line, int n, int closed, float turn, int k) {
+    if (!closed) return line[line_index(k, n, 0)].heading;
+    int lap = (k >= 0) ? k / n : -((n - 1 - k) / n);
+    return line[k - lap * n].heading + lap * turn;
+}
+
+/* Unwrap the heading field in place, returns the turn over one loop */
+static float unwrap_headings(racing_line_sample_t *line, int n) {
+    float first = line[0].heading;
+    float prev = first;
+    float acc = first;
+    for (int k = 1; k < n; k++) {
+        float h = line[k].heading;
+        acc += wrap_angle(h - prev);
+        prev = h;
+        line[k].heading = acc;
+    }
+    return acc + wrap_angle(first - prev) - first;
+}
 
-    for (int i = 0; i < num_segments && i < MAX_TRACK_SEGMENTS; i++) {
+/* Windowed curvature from unwrapped headings into the curvature field */
+static void estimate_curvature(racing_line_sample_t *line, int n, int closed, float turn,
+                               float spacing, int half) {
+    for (int k = 0; k < n; k++) {
+        float ahead = unwrapped_at(line, n, closed, turn, k + half);
+        float behind = unwrapped_at(line, n, closed, turn, k - half);
+        line[k].curvature = (ahead - behind) / (2.0f * half * spacing);
+    }
+}
+
+static void track_build_racing_line(track_t *track, int capacity) {
+    int n = (int)(track->total_length / RACING_LINE_SPACING) + 1;
+    if (n > capacity) n = capacity;
+    if (n < 3) return;
+
+    racing_line_sample_t *line = (racing_line_sample_t *)arena_alloc(
+        &track->arena, sizeof(racing_line_sample_t) * (size_t)n);
+    if (!line) return;
+
+    float spacing = track->total_length / n;
+    int half = (int)(RACING_LINE_CURVE_WINDOW / spacing + 0.5f);
+    int lead = (int)(RACING_LINE_APEX_LEAD / spacing + 0.5f);
+    if (half < 1) half = 1;
+
+    /* Tracks don't have to meet their start, only wrap around if they do */
+    const track_segment_t *last = &track->segments[track->segment_count - 1];
+    int closed = vec3_length(vec3_sub(last->end_pos, track->segments[0].start_pos)) < last->width;
+
+    /* Centreline samples */
+    int cursor = -1;
+    for (int k = 0; k < n; k++) {
+        vec3_t pos, dir;
+        track_get_position_cached(track, k * spacing, &cursor, &pos, &dir);
+        line[k].x = pos.x;
+        line[k].y = pos.y;
+        line[k].z = pos.z;
+        line[k].heading = atan2f(dir.x, dir.z);
+        line[k].speed = track->segments[cursor].width;  /* Scratch: road width */
+    }
+
+    float turn = unwrap_headings(line, n);
+    estimate_curvature(line, n, closed, turn, spacing, half);
+
+    /* Apex-aware offset: inside at the curvature peak, outside either side */
+    for (int k = 0; k < n; k++) {
+        float around = line[line_index(k - lead, n, closed)].curvature +
+                       line[line_index(k + lead, n, closed)].curvature;
+        line[k].offset = RACING_LINE_OFFSET_GAIN * (line[k].curvature - 0.5f * around);
+    }
+
+    /* Smooth with a 5-tap box filter in place, keeping the unfiltered
+     * values the window still needs, then keep off the edges */
+    for (int pass = 0; pass < RACING_LINE_SMOOTH_PASSES; pass++) {
+        float head[2] = { line[0].offset, line[1].offset };
+        float w0 = line[line_index(-2, n, closed)].offset;
+        float w1 = line[line_index(-1, n, closed)].offset;
+        for (int k = 0; k < n; k++) {
+            int i1 = line_index(k + 1, n, closed);
+            int i2 = line_index(k + 2, n, closed);
+            float cur = line[k].offset;
+            float a1 = (i1 < k) ? head[i1] : line[i1].offset;
+            float a2 = (i2 < k) ? head[i2] : line[i2].offset;
+            line[k].offset = (w0 + w1 + cur + a1 + a2) * 0.2f;
+            w0 = w1;
+            w1 = cur;
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        float limit = line[k].speed * 0.5f - RACING_LINE_EDGE_MARGIN;
+        if (limit < 0) limit = 0;
+        line[k].offset = clamp(line[k].offset, -limit, limit);
+
+        /* Toward the inside of a heading-increasing turn: (cos h, 0, -sin h) */
+        float h = line[k].heading;
+        line[k].x += cosf(h) * line[k].offset;
+        line[k].z -= sinf(h) * line[k].offset;
+    }
+
+    /* Heading and curvature of the offset line itself */
+    for (int k = 0; k < n; k++) {
+        const racing_line_sample_t *next = &line[line_index(k + 1, n, closed)];
+        const racing_line_sample_t *prev = &line[line_index(k - 1, n, closed)];
+        line[k].speed = atan2f(next->x - prev->x, next->z - prev->z);  /* Scratch: heading */
+    }
+    for (int k = 0; k < n; k++) {
+        line[k].heading = line[k].speed;
+    }
+    turn = unwrap_headings(line, n);
+    estimate_curvature(line, n, closed, turn, spacing, half);
+
+    /* Cornering speed, then braking from each corner back up the line */
+    for (int k = 0; k < n; k++) {
+        float kappa = fabsf(line[k].curvature);
+        float v = kappa > 1e-4f ? sqrtf(RACING_LINE_LAT_ACCEL / kappa) : RACING_LINE_MAX_SPEED;
+        line[k].speed = v < RACING_LINE_MAX_SPEED ? v : RACING_LINE_MAX_SPEED;
+        line[k].heading = wrap_angle(line[k].heading);
+    }
+    float brake_step = 2.0f * RACING_LINE_BRAKE_DECEL * spacing;
+    for (int k = (closed ? 2 * n : n - 1) - 1; k >= 0; k--) {
+        racing_line_sample_t *s = &line[k % n];
+        float after = line[(k + 1) % n].speed;
+        float reachable = sqrtf(after * after + brake_step);
+        if (s->speed > reachable) s->speed = reachable;
+    }
+
+    track->racing_line = line;
+    track->racing_line_count = n;
+    track->racing_line_closed = closed;
+    track->racing_line_inv_spacing = 1.0f / spacing;
+}
+
+/* Geometry of a segment leaving start with heading (radians, after its
+ * turn). Type, length, curve angle and elevation change are set already. */
+static void place_segment(track_segment_t *seg, vec3_t start, float heading, float width) {
+    seg->start_pos = start;
+    seg->width = width;
+    seg->direction = vec3_create(sinf(heading), 0, cosf(heading));
+    seg->end_pos = vec3_add(start, vec3_scale(seg->direction, seg->length));
+    seg->end_pos.y += seg->elevation_change;
+    seg->center = vec3_lerp(seg->start_pos, seg->end_pos, 0.5f);
+}
+
+/* Random walk from the start, the ends are left open */
+static void generate_open(track_t *track, const track_params_t *params, int num_segments, uint32_t *rng) {
+    vec3_t current_pos = vec3_create(0, 0, 0);
+    float current_angle = 0;  /* Direction in radians */
+
+    for (int i = 0; i < num_segments; i++) {
         track_segment_t *seg = &track->segments[i];
 
         /* Determine segment type */
-        float r = track_rand_float();
+        float r = track_rand_float(rng);
         if (r < 0.4f) {
             seg->type = SEGMENT_STRAIGHT;
         } else if (r < 0.6f) {
@@ -88,14 +486,8 @@ track_t *track_generate(track_params_t *params) {
             seg->type = SEGMENT_STRAIGHT;
         }
 
-        seg->start_pos = current_pos;
-        seg->width = params->track_width;
-
         /* Calculate segment length */
-        seg->length = track_rand_range(params->min_straight_length, params->max_straight_length);
-
-        /* Calculate end position and update direction */
-        vec3_t dir = vec3_create(sinf(current_angle), 0, cosf(current_angle));
+        seg->length = track_rand_range(rng, params->min_straight_length, params->max_straight_length);
 
         switch (seg->type) {
             case SEGMENT_STRAIGHT:
@@ -104,48 +496,412 @@ track_t *track_generate(track_params_t *params) {
                 break;
 
             case SEGMENT_CURVE_LEFT:
-                seg->curve_angle = track_rand_range(15.0f, params->max_curve_angle);
+                seg->curve_angle = track_rand_range(rng, 15.0f, params->max_curve_angle);
                 current_angle -= deg_to_rad(seg->curve_angle);
                 seg->elevation_change = 0;
                 break;
 
             case SEGMENT_CURVE_RIGHT:
-                seg->curve_angle = track_rand_range(15.0f, params->max_curve_angle);
+                seg->curve_angle = track_rand_range(rng, 15.0f, params->max_curve_angle);
                 current_angle += deg_to_rad(seg->curve_angle);
                 seg->elevation_change = 0;
                 break;
 
             case SEGMENT_HILL_UP:
                 seg->curve_angle = 0;
-                seg->elevation_change = track_rand_range(1.0f, params->max_elevation);
+                seg->elevation_change = track_rand_range(rng, 1.0f, params->max_elevation);
                 break;
 
             case SEGMENT_HILL_DOWN:
                 seg->curve_angle = 0;
-                seg->elevation_change = -track_rand_range(1.0f, params->max_elevation);
+                seg->elevation_change = -track_rand_range(rng, 1.0f, params->max_elevation);
                 if (current_pos.y + seg->elevation_change < 0) {
                     seg->elevation_change = -current_pos.y;
                 }
                 break;
         }
 
-        /* Calculate end position */
-        dir = vec3_create(sinf(current_angle), 0, cosf(current_angle));
-        seg->direction = dir;
-        seg->end_pos = vec3_add(current_pos, vec3_scale(dir, seg->length));
-        seg->end_pos.y += seg->elevation_change;
-
-        /* Create segment mesh */
-        uint32_t road_color = COLOR_ASPHALT;
-        if (i % 2 == 0) {
-            /* Slightly different shade for visual variety */
-            road_color = PACK_COLOR(255, 70, 70, 70);
+        place_segment(seg, current_pos, current_angle, params->track_width);
+        current_pos = seg->end_pos;
+    }
+}
+
+/*
+ * Closed circuits. The walk steers toward a point a little ahead on a
+ * guide loop through the start (a circle with a few random bulges),
+ * mixed with the usual random curves. Each candidate segment is checked
+ * against a spatial hash of the segments already placed and redrawn if
+ * it passes too close to one, backing up a segment when every draw is
+ * blocked. The last two segments join up with the start exactly. A walk
+ * that runs out of backups starts over on a new guide, and after
+ * LOOP_ATTEMPTS the plain polygon is used, so the work is bounded by
+ * about LOOP_ATTEMPTS * 3n * LOOP_DRAWS hash queries.
+ */
+#define LOOP_ATTEMPTS 8             /* Walks before falling back to the polygon */
+#define LOOP_DRAWS 8                /* Candidates per segment before backing up */
+#define LOOP_CLEARANCE 8.0f         /* Gap between road edges, grass included */
+#define LOOP_PURSUIT 0.6f           /* Share of a turn that steers back to the guide */
+#define LOOP_MIN_SEGMENTS 8         /* Fewer can't turn all the way round */
+#define POLYGON_MIN_SEGMENTS 3      /* Fewer collapse the fallback polygon */
+#define LOOP_HARMONICS 3
+#define LOOP_HASH_BUCKETS 512       /* Power of two */
+#define LOOP_HASH_EMPTY 0xFFFF
+
+typedef struct {
+    float side;                     /* +1 loops to the right, -1 to the left */
+    float radius;
+    float amp[LOOP_HARMONICS];
+    float phase[LOOP_HARMONICS];
+    float perimeter;
+} loop_guide_t;
+
+/* Placed segments chained by the hash cell of their midpoint. Cells are
+ * at least a segment plus the clearance across, so any segment close
+ * enough to matter is in one of the 3x3 cells around a candidate. */
+typedef struct {
+    float inv_cell;
+    float min_gap_sq;
+    uint16_t head[LOOP_HASH_BUCKETS];
+    uint16_t *next;                 /* One per segment */
+} loop_hash_t;
+
+static float guide_radius(const loop_guide_t *g, float phi) {
+    float r = 1.0f;
+    for (int h = 0; h < LOOP_HARMONICS; h++) {
+        r += g->amp[h] * (cosf((h + 2) * phi + g->phase[h]) - cosf(g->phase[h]));
+    }
+    return r * g->radius;
+}
+
+/* Centre at (side * radius, 0), phi = 0 is the start heading along +z */
+static vec3_t guide_point(const loop_guide_t *g, float phi) {
+    float r = guide_radius(g, phi);
+    return vec3_create(g->side * (g->radius - r * cosf(phi)), 0, r * sinf(phi));
+}
+
+static float guide_phase(const loop_guide_t *g, vec3_t p) {
+    return atan2f(p.z, g->radius - g->side * p.x);
+}
+
+/* Random guide about num_segments average segments round */
+static void guide_init(loop_guide_t *g, const track_params_t *params, int num_segments, uint32_t *rng) {
+    g->side = track_rand_float(rng) < 0.5f ? -1.0f : 1.0f;
+    for (int h = 0; h < LOOP_HARMONICS; h++) {
+        g->amp[h] = track_rand_range(rng, 0, 0.02f * params->difficulty);
+        g->phase[h] = track_rand_range(rng, 0, 2.0f * M_PI);
+    }
+
+    g->radius = 1.0f;
+    float unit = 0;
+    vec3_t prev = guide_point(g, 0);
+    for (int k = 1; k <= 64; k++) {
+        vec3_t p = guide_point(g, 2.0f * M_PI * k / 64);
+        unit += vec3_distance(prev, p);
+        prev = p;
+    }
+    g->perimeter = num_segments * 0.5f * (params->min_straight_length + params->max_straight_length);
+    g->radius = g->perimeter / unit;
+}
+
+static int loop_bucket(const loop_hash_t *hash, vec3_t p, int dx, int dz) {
+    uint32_t cx = (uint32_t)((int)floorf(p.x * hash->inv_cell) + dx);
+    uint32_t cz = (uint32_t)((int)floorf(p.z * hash->inv_cell) + dz);
+    return (int)((cx * 73856093u ^ cz * 19349663u) & (LOOP_HASH_BUCKETS - 1));
+}
+
+static void loop_hash_insert(loop_hash_t *hash, const track_segment_t *segs, int i) {
+    int b = loop_bucket(hash, segs[i].center, 0, 0);
+    hash->next[i] = hash->head[b];
+    hash->head[b] = (uint16_t)i;
+}
+
+/* Only the most recent insertion can be removed, it heads its chain */
+static void loop_hash_remove(loop_hash_t *hash, const track_segment_t *segs, int i) {
+    int b = loop_bucket(hash, segs[i].center, 0, 0);
+    hash->head[b] = hash->next[i];
+}
+
+/* Squared ground distance between segments ab and cd, from their closest
+ * points (0 if they cross). Both have non-zero length. */
+static float segment_gap_sq(vec3_t a, vec3_t b, vec3_t c, vec3_t d) {
+    float ux = b.x - a.x, uz = b.z - a.z;
+    float vx = d.x - c.x, vz = d.z - c.z;
+    float wx = a.x - c.x, wz = a.z - c.z;
+    float uu = ux * ux + uz * uz, vv = vx * vx + vz * vz, uv = ux * vx + uz * vz;
+    float uw = ux * wx + uz * wz, vw = vx * wx + vz * wz;
+
+    float denom = uu * vv - uv * uv;
+    float s = denom > 1e-6f * uu * vv ? clamp((uv * vw - uw * vv) / denom, 0, 1) : 0;
+    float t = (uv * s + vw) / vv;
+    if (t < 0) {
+        t = 0;
+        s = clamp(-uw / uu, 0, 1);
+    } else if (t > 1) {
+        t = 1;
+        s = clamp((uv - uw) / uu, 0, 1);
+    }
+
+    float dx = wx + ux * s - vx * t, dz = wz + uz * s - vz * t;
+    return dx * dx + dz * dz;
+}
+
+/* Is candidate segment i of n too close to a placed one? Its neighbours
+ * two either side round the loop share ends with it or nearly, skip them. */
+static int loop_blocked(const loop_hash_t *hash, const track_segment_t *segs, int i, int n) {
+    const track_segment_t *seg = &segs[i];
+    for (int dz = -1; dz <= 1; dz++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            int b = loop_bucket(hash, seg->center, dx, dz);
+            for (int j = hash->head[b]; j != LOOP_HASH_EMPTY; j = hash->next[j]) {
+                if ((i - j + n) % n <= 2 || (j - i + n) % n <= 2) continue;
+                if (segment_gap_sq(seg->start_pos, seg->end_pos, segs[j].start_pos, segs[j].end_pos) <
+                    hash->min_gap_sq) {
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static float segment_heading(const track_segment_t *seg) {
+    return atan2f(seg->direction.x, seg->direction.z);
+}
+
+/* Draw segment i of the walk, returns 0 if every candidate was blocked */
+static int loop_step(track_t *track, const track_params_t *params, int n, const loop_guide_t *g,
+                     const loop_hash_t *hash, float *progress, vec3_t approach, float end_phase,
+                     uint32_t *rng, int i) {
+    track_segment_t *seg = &track->segments[i];
+    const track_segment_t *prev = &track->segments[i - 1];
+    vec3_t pos = prev->end_pos;
+    float heading = segment_heading(prev);
+    float max_turn = params->max_curve_angle;
+
+    /* Spread what is left of the guide over the rest of the walk and the link */
+    float remaining = g->perimeter * (end_phase - progress[i - 1]) / (2.0f * M_PI);
+    float share = remaining / (n - 1 - i);
+    int closing = i > n * 3 / 4;
+
+    for (int d = 0; d < LOOP_DRAWS; d++) {
+        float pursuit = LOOP_PURSUIT + (1.0f - LOOP_PURSUIT) * d / (LOOP_DRAWS - 1);
+        float r = track_rand_float(rng);
+        seg->length = clamp(share * track_rand_range(rng, 0.75f, 1.25f),
+                            params->min_straight_length, params->max_straight_length);
+
+        float ahead = progress[i - 1] + 1.5f * seg->length / g->radius;
+        vec3_t aim = ahead < end_phase ? guide_point(g, ahead) : approach;
+        float steer = rad_to_deg(wrap_angle(atan2f(aim.x - pos.x, aim.z - pos.z) - heading));
+        float wander = 0;
+        if (r >= 0.4f && r < 0.8f) {
+            wander = track_rand_range(rng, 15.0f, max_turn) * (r < 0.6f ? -1.0f : 1.0f);
+        }
+        float turn = clamp(pursuit * steer + (1.0f - pursuit) * wander, -max_turn, max_turn);
+
+        seg->curve_angle = 0;
+        seg->elevation_change = 0;
+        if (fabsf(turn) >= 7.5f) {
+            seg->type = turn < 0 ? SEGMENT_CURVE_LEFT : SEGMENT_CURVE_RIGHT;
+            seg->curve_angle = fabsf(turn) > 15.0f ? fabsf(turn) : 15.0f;
+        } else if (r >= 0.8f && r < 0.9f && !closing) {
+            seg->type = SEGMENT_HILL_UP;
+            seg->elevation_change = track_rand_range(rng, 1.0f, params->max_elevation);
+        } else if (r >= 0.9f) {
+            seg->type = SEGMENT_HILL_DOWN;
+            seg->elevation_change = -track_rand_range(rng, 1.0f, params->max_elevation);
+            if (pos.y + seg->elevation_change < 0) seg->elevation_change = -pos.y;
+        } else {
+            seg->type = SEGMENT_STRAIGHT;
+        }
+
+        float h = heading;
+        if (seg->type == SEGMENT_CURVE_LEFT) h -= deg_to_rad(seg->curve_angle);
+        if (seg->type == SEGMENT_CURVE_RIGHT) h += deg_to_rad(seg->curve_angle);
+        place_segment(seg, pos, h, params->track_width);
+
+        if (!loop_blocked(hash, track->segments, i, n)) {
+            float at = progress[i - 1];
+            progress[i] = at + wrap_angle(guide_phase(g, seg->end_pos) - at);
+            return 1;
         }
-        seg->mesh = mesh_create_track_segment(seg->width, seg->length, road_color);
+    }
+    return 0;
+}
 
-        /* Create border meshes */
-        seg->border_left = mesh_create_track_segment(1.0f, seg->length, COLOR_WHITE);
-        seg->border_right = mesh_create_track_segment(1.0f, seg->length, COLOR_WHITE);
+static segment_type_t turn_type(float turn, float elevation_change) {
+    if (turn < -0.5f) return SEGMENT_CURVE_LEFT;
+    if (turn > 0.5f) return SEGMENT_CURVE_RIGHT;
+    return elevation_change < 0 ? SEGMENT_HILL_DOWN : SEGMENT_STRAIGHT;
+}
+
+/* Link from the walk's end to the approach point, then the straight down
+ * to the line, level with the start. Returns 0 if either turn is too
+ * sharp, the link too short or long, or one of them is blocked. */
+static int loop_close(track_t *track, const track_params_t *params, int n, const loop_hash_t *hash,
+                      vec3_t approach) {
+    track_segment_t *link = &track->segments[n - 2];
+    track_segment_t *last = &track->segments[n - 1];
+    const track_segment_t *prev = &track->segments[n - 3];
+    vec3_t pos = prev->end_pos;
+
+    float dx = approach.x - pos.x, dz = approach.z - pos.z;
+    float heading = atan2f(dx, dz);
+    float turn_in = rad_to_deg(wrap_angle(heading - segment_heading(prev)));
+    float turn_out = rad_to_deg(wrap_angle(-heading));
+    link->length = sqrtf(dx * dx + dz * dz);
+    if (link->length < 0.5f * params->min_straight_length || link->length > params->max_straight_length ||
+        fabsf(turn_in) > params->max_curve_angle || fabsf(turn_out) > params->max_curve_angle) {
+        return 0;
+    }
+
+    link->elevation_change = -pos.y;
+    link->type = turn_type(turn_in, link->elevation_change);
+    link->curve_angle = fabsf(turn_in);
+    place_segment(link, pos, heading, params->track_width);
+
+    last->length = -approach.z;
+    last->elevation_change = 0;
+    last->type = turn_type(turn_out, 0);
+    last->curve_angle = fabsf(turn_out);
+    place_segment(last, link->end_pos, 0, params->track_width);
+
+    return !loop_blocked(hash, track->segments, n - 2, n) && !loop_blocked(hash, track->segments, n - 1, n);
+}
+
+/* One walk round a new guide, returns 0 if it got stuck */
+static int loop_walk(track_t *track, const track_params_t *params, int n, loop_hash_t *hash,
+                     float *progress, uint32_t *rng) {
+    track_segment_t *segs = track->segments;
+    loop_guide_t guide;
+    guide_init(&guide, params, n, rng);
+
+    /* The final straight runs along +z into the start */
+    vec3_t approach = vec3_create(0, 0, -track_rand_range(rng, params->min_straight_length,
+                                                            params->max_straight_length));
+    float end_phase = guide_phase(&guide, approach) + 2.0f * M_PI;
+
+    memset(hash->head, 0xFF, sizeof(hash->head));
+    segs[0].type = SEGMENT_STRAIGHT;
+    segs[0].length = track_rand_range(rng, params->min_straight_length, params->max_straight_length);
+    segs[0].curve_angle = 0;
+    segs[0].elevation_change = 0;
+    place_segment(&segs[0], vec3_create(0, 0, 0), 0, params->track_width);
+    loop_hash_insert(hash, segs, 0);
+    progress[0] = guide_phase(&guide, segs[0].end_pos);
+
+    int backups = n;
+    int i = 1;
+    while (i < n) {
+        int placed = (i < n - 2) ? loop_step(track, params, n, &guide, hash, progress, approach, end_phase, rng, i)
+                                 : loop_close(track, params, n, hash, approach);
+        if (placed) {
+            loop_hash_insert(hash, segs, i);
+            if (i == n - 2) loop_hash_insert(hash, segs, ++i);
+            i++;
+            continue;
+        }
+        if (i == 1 || --backups < 0) return 0;
+        loop_hash_remove(hash, segs, --i);
+    }
+    return 1;
+}
+
+/* Fallback: equal sides turning right, always closed and never crossing */
+static void generate_polygon(track_t *track, const track_params_t *params, int num_segments) {
+    float turn = 2.0f * M_PI / num_segments;
+    vec3_t pos = vec3_create(0, 0, 0);
+    for (int i = 0; i < num_segments; i++) {
+        track_segment_t *seg = &track->segments[i];
+        seg->type = i == 0 ? SEGMENT_STRAIGHT : SEGMENT_CURVE_RIGHT;
+        seg->length = 0.5f * (params->min_straight_length + params->max_straight_length);
+        seg->curve_angle = i == 0 ? 0 : rad_to_deg(turn);
+        seg->elevation_change = 0;
+        place_segment(seg, pos, i * turn, params->track_width);
+        pos = seg->end_pos;
+    }
+}
+
+static void generate_closed(track_t *track, const track_params_t *params, int num_segments,
+                            uint16_t *hash_next, float *progress, uint32_t *rng) {
+    if (num_segments >= LOOP_MIN_SEGMENTS) {
+        loop_hash_t hash;
+        float min_gap = params->track_width + LOOP_CLEARANCE;
+        hash.inv_cell = 1.0f / (params->max_straight_length + min_gap);
+        hash.min_gap_sq = min_gap * min_gap;
+        hash.next = hash_next;
+
+        for (int attempt = 0; attempt < LOOP_ATTEMPTS; attempt++) {
+            if (loop_walk(track, params, num_segments, &hash, progress, rng)) return;
+        }
+    }
+    generate_polygon(track, params, num_segments);
+}
+
+/* Arena bytes for a track: segment tables, grid entries and closed loop
+ * scratch, the geometry pool with its unit quads and the racing line */
+static size_t track_arena_size(const track_params_t *params, int num_segments) {
+    size_t n = (size_t)num_segments;
+    return ARENA_SIZE(sizeof(track_segment_t) * n) + ARENA_SIZE(sizeof(float) * (n + 1)) +
+           ARENA_SIZE(sizeof(uint16_t) * n) + ARENA_SIZE(sizeof(uint16_t) * n) + ARENA_SIZE(sizeof(float) * n) +
+           MESH_ARENA_SIZE(stream_slots(num_segments) * TRACK_SEGMENT_TRIS + 2) + 3 * MESH_ARENA_SIZE(2) +
+           ARENA_SIZE(sizeof(racing_line_sample_t) * (size_t)racing_line_capacity(params, num_segments));
+}
+
+track_t *track_generate(track_params_t *params) {
+    track_t *track = (track_t *)malloc(sizeof(track_t));
+    if (!track) return NULL;
+    arena_init(&track->arena);
+
+    if (!track_generate_into(track, params)) {
+        track_destroy(track);
+        return NULL;
+    }
+    return track;
+}
+
+int track_generate_into(track_t *track, track_params_t *params) {
+    int num_segments = params->num_segments;
+    if (num_segments > MAX_TRACK_SEGMENTS) num_segments = MAX_TRACK_SEGMENTS;
+    if (num_segments < 0) num_segments = 0;
+    if (params->closed_loop && num_segments < POLYGON_MIN_SEGMENTS) num_segments = POLYGON_MIN_SEGMENTS;
+
+    /* Keep the arena block, everything else starts from zero */
+    arena_t arena = track->arena;
+    memset(track, 0, sizeof(track_t));
+    track->arena = arena;
+    if (!arena_reserve(&track->arena, track_arena_size(params, num_segments))) {
+        return 0;
+    }
+    track->segments = (track_segment_t *)arena_alloc(&track->arena, sizeof(track_segment_t) * (size_t)num_segments);
+    track->segment_distance = (float *)arena_alloc(&track->arena, sizeof(float) * (size_t)(num_segments + 1));
+    if ((num_segments > 0 && !track->segments) || !track->segment_distance) {
+        return 0;
+    }
+
+    uint32_t rng = params->seed;
+    track->seed = params->seed;
+
+    sprintf(track->name, "Track %u", params->seed % 1000);
+
+    track->start_position = vec3_create(0, 0, 0);
+    track->start_direction = vec3_create(0, 0, 1);
+
+    if (params->closed_loop) {
+        uint16_t *hash_next = (uint16_t *)arena_alloc(&track->arena, sizeof(uint16_t) * (size_t)num_segments);
+        float *progress = (float *)arena_alloc(&track->arena, sizeof(float) * (size_t)num_segments);
+        if (num_segments > 0 && (!hash_next || !progress)) return 0;
+        generate_closed(track, params, num_segments, hash_next, progress, &rng);
+    } else {
+        generate_open(track, params, num_segments, &rng);
+    }
+
+    int checkpoint_interval = num_segments / 8;
+    if (checkpoint_interval < 1) checkpoint_interval = 1;
+
+    float total_length = 0;
+    for (int i = 0; i < num_segments; i++) {
+        track_segment_t *seg = &track->segments[i];
+        segment_bounds(seg);
 
         /* Add checkpoint */
         if ((i + 1) % checkpoint_interval == 0 && track->checkpoint_count < MAX_CHECKPOINTS) {
@@ -158,8 +914,8 @@ track_t *track_generate(track_params_t *params) {
             track->checkpoint_count++;
         }
 
+        track->segment_distance[i] = total_length;
         total_length += seg->length;
-        current_pos = seg->end_pos;
         track->segment_count++;
     }
 
@@ -175,20 +931,65 @@ track_t *track_generate(track_params_t *params) {
     }
 
     track->total_length = total_length;
+    track->segment_distance[track->segment_count] = total_length;
 
-    return track;
+    /* Spatial index for nearest-segment queries and streaming */
+    if (!track_build_grid(track)) return 0;
+
+    /* Render geometry pool, filled by track_render() */
+    if (track->segment_count > 0 && !track_stream_init(track)) {
+        return 0;
+    }
+
+    /* AI lookup table */
+    if (track->total_length > 0) {
+        track_build_racing_line(track, racing_line_capacity(params, num_segments));
+    }
+
+    return 1;
 }
 
 void track_destroy(track_t *track) {
     if (!track) return;
 
-    for (int i = 0; i < track->segment_count; i++) {
-        mesh_destroy(track->segments[i].mesh);
-        mesh_destroy(track->segments[i].border_left);
-        mesh_destroy(track->segments[i].border_right);
+    /* All arrays and meshes live in the arena */
+    arena_free(&track->arena);
+    free(track);
+}
+
+void track_pool_init(track_pool_t *pool) {
+    memset(pool, 0, sizeof(track_pool_t));
+}
+
+track_t *track_pool_acquire(track_pool_t *pool) {
+    for (int i = 0; i < TRACK_POOL_SIZE; i++) {
+        if (pool->in_use[i]) continue;
+
+        if (!pool->tracks[i]) {
+            pool->tracks[i] = (track_t *)malloc(sizeof(track_t));
+            if (!pool->tracks[i]) return NULL;
+            arena_init(&pool->tracks[i]->arena);
+        }
+        pool->in_use[i] = 1;
+        return pool->tracks[i];
+    }
+    return NULL;
+}
+
+void track_pool_release(track_pool_t *pool, track_t *track) {
+    for (int i = 0; i < TRACK_POOL_SIZE; i++) {
+        if (pool->tracks[i] == track) {
+            pool->in_use[i] = 0;
+            return;
+        }
     }
+}
 
-    free(track);
+void track_pool_shutdown(track_pool_t *pool) {
+    for (int i = 0; i < TRACK_POOL_SIZE; i++) {
+        track_destroy(pool->tracks[i]);
+    }
+    track_pool_init(pool);
 }
 
 /* Render grass ground plane around camera position */
@@ -220,93 +1021,296 @@ void track_render(track_t *track, camera_t *cam) {
     /* Render grass ground plane first (below track, above sky background) */
     render_grass(cam);
 
-    /* Render each segment */
-    for (int i = 0; i < track->segment_count; i++) {
+    /* Road and borders of the segments around the camera */
+    track_stream_update(track, cam->position, cam->cull_distance);
+
+    track_stream_t *st = &track->stream;
+    render_cull_stats_t *stats = render_get_cull_stats();
+    stats->segments_total += track->segment_count;
+    if (!st->mesh) return;
+
+    /* Far segments lose their borders when the vertex budget is tight */
+    float border_distance = render_get_lod()->border_distance;
+    float border_sq = border_distance * border_distance;
+
+    int run_first = 0;
+    int run_count = 0;
+
+    for (int s = 0; s < st->slot_count; s++) {
+        int i = st->slot_segment[s];
+        if (i < 0) continue;
+
         track_segment_t *seg = &track->segments[i];
+        if (!render_sphere_visible(seg->bound_center, seg->bound_radius)) {
+            continue;
+        }
+        stats->segments_visible++;
 
-        /* Calculate segment transform */
-        mat4_t transform = mat4_identity();
+        int count = TRACK_SEGMENT_TRIS;
+        vec3_t to_cam = vec3_sub(seg->bound_center, cam->position);
+        if (vec3_dot(to_cam, to_cam) > border_sq) count = TRACK_SEGMENT_ROAD_TRIS;
 
-        /* Position */
-        mat4_t trans = mat4_translate(seg->start_pos.x, seg->start_pos.y, seg->start_pos.z);
+        /* Merge visible segments in neighbouring slots into one draw */
+        int first = s * TRACK_SEGMENT_TRIS;
+        if (run_count > 0 && run_first + run_count == first) {
+            run_count += count;
+        } else {
+            render_draw_mesh_world_range(st->mesh, run_first, run_count);
+            run_first = first;
+            run_count = count;
+        }
 
-        /* Rotation to face direction */
-        float angle = atan2f(seg->direction.x, seg->direction.z);
-        mat4_t rot = mat4_rotate_y(angle);
+        /* Start/finish line sits on the first segment */
+        if (i == 0) {
+            render_draw_mesh_world_range(st->mesh, st->start_line_first, 2);
+        }
+    }
+    render_draw_mesh_world_range(st->mesh, run_first, run_count);
+}
 
-        transform = mat4_multiply(trans, rot);
+/* Wrap distance for looping track */
+static float wrap_distance(track_t *track, float distance) {
+    if (distance >= 0 && distance < track->total_length) return distance;
 
-        /* Render track surface */
-        render_draw_mesh(seg->mesh, transform);
+    distance = fmodf(distance, track->total_length);
+    if (distance < 0) distance += track->total_length;
+    if (distance >= track->total_length) distance = 0;
+    return distance;
+}
+
+/* First segment whose end lies beyond distance (distance already wrapped) */
+static int segment_at_wrapped_distance(track_t *track, float distance, int hint) {
+    const float *table = track->segment_distance;
+    int n = track->segment_count;
 
-        /* Render borders */
-        mat4_t left_offset = mat4_translate(-seg->width / 2 - 0.5f, 0.05f, 0);
-        mat4_t right_offset = mat4_translate(seg->width / 2 + 0.5f, 0.05f, 0);
+    /* Try the hint and the segment after it before searching */
+    if (hint >= 0 && hint < n) {
+        if (table[hint] <= distance && table[hint + 1] > distance) return hint;
 
-        render_draw_mesh(seg->border_left, mat4_multiply(transform, left_offset));
-        render_draw_mesh(seg->border_right, mat4_multiply(transform, right_offset));
+        int next = (hint + 1 < n) ? hint + 1 : 0;
+        if (table[next] <= distance && table[next + 1] > distance) return next;
     }
 
-    /* Render start/finish line */
-    vec3_t start_pos = track->start_position;
-    start_pos.y += 0.1f;
-    render_draw_quad(start_pos, track->segments[0].width, 2.0f, COLOR_WHITE);
+    /* Binary search for the first table[i + 1] > distance */
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (table[mid + 1] > distance) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return (lo < n) ? lo : -1;
 }
 
-void track_get_position(track_t *track, float distance, vec3_t *pos, vec3_t *dir) {
+int track_segment_at_distance(track_t *track, float distance, int hint) {
+    if (!track || track->segment_count == 0) return -1;
+
+    return segment_at_wrapped_distance(track, wrap_distance(track, distance), hint);
+}
+
+void track_get_position_cached(track_t *track, float distance, int *cursor, vec3_t *pos, vec3_t *dir) {
     if (!track || track->segment_count == 0) {
         *pos = vec3_create(0, 0, 0);
         *dir = vec3_create(0, 0, 1);
         return;
     }
 
-    /* Wrap distance for looping track */
-    while (distance < 0) distance += track->total_length;
-    while (distance >= track->total_length) distance -= track->total_length;
+    distance = wrap_distance(track, distance);
 
-    float accumulated = 0;
-    for (int i = 0; i < track->segment_count; i++) {
-        track_segment_t *seg = &track->segments[i];
+    int i = segment_at_wrapped_distance(track, distance, cursor ? *cursor : -1);
+    if (i < 0) {
+        /* Default to start */
+        *pos = track->start_position;
+        *dir = track->start_direction;
+        return;
+    }
 
-        if (accumulated + seg->length > distance) {
-            float t = (distance - accumulated) / seg->length;
-            *pos = vec3_lerp(seg->start_pos, seg->end_pos, t);
-            *dir = seg->direction;
-            return;
-        }
+    track_segment_t *seg = &track->segments[i];
+    float t = (distance - track->segment_distance[i]) / seg->length;
+    *pos = vec3_lerp(seg->start_pos, seg->end_pos, t);
+    *dir = seg->direction;
 
-        accumulated += seg->length;
+    if (cursor) *cursor = i;
+}
+
+void track_racing_line_at(track_t *track, float distance, racing_line_sample_t *out) {
+    if (!track) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    if (track->racing_line_count == 0) {
+        vec3_t pos, dir;
+        track_get_position(track, distance, &pos, &dir);
+        memset(out, 0, sizeof(*out));
+        out->x = pos.x;
+        out->y = pos.y;
+        out->z = pos.z;
+        out->heading = atan2f(dir.x, dir.z);
+        out->speed = RACING_LINE_MAX_SPEED;
+        return;
     }
 
-    /* Default to start */
-    *pos = track->start_position;
-    *dir = track->start_direction;
+    int n = track->racing_line_count;
+    float f = wrap_distance(track, distance) * track->racing_line_inv_spacing;
+    int k = (int)f;
+    float t = f - (float)k;
+    if (k >= n) k = n - 1;
+
+    const racing_line_sample_t *a = &track->racing_line[k];
+    const racing_line_sample_t *b = &track->racing_line[line_index(k + 1, n, track->racing_line_closed)];
+    out->x = a->x + (b->x - a->x) * t;
+    out->y = a->y + (b->y - a->y) * t;
+    out->z = a->z + (b->z - a->z) * t;
+    out->heading = wrap_angle(a->heading + wrap_angle(b->heading - a->heading) * t);
+    out->curvature = a->curvature + (b->curvature - a->curvature) * t;
+    out->offset = a->offset + (b->offset - a->offset) * t;
+    out->speed = a->speed + (b->speed - a->speed) * t;
 }
 
-int track_find_segment(track_t *track, vec3_t pos) {
-    if (!track) return -1;
+void track_get_position(track_t *track, float distance, vec3_t *pos, vec3_t *dir) {
+    track_get_position_cached(track, distance, NULL, pos, dir);
+}
 
+void track_get_positions(track_t *track, const float *distances, int count, vec3_t *pos, vec3_t *dir) {
+    int cursor = -1;
+    vec3_t unused_dir;
+
+    for (int i = 0; i < count; i++) {
+        track_get_position_cached(track, distances[i], &cursor, &pos[i], dir ? &dir[i] : &unused_dir);
+    }
+}
+
+/* Closer candidate wins; ties go to the lower index like a linear scan */
+static void consider_segment(track_t *track, int i, vec3_t pos, int *best, float *best_dist) {
+    float dist = vec3_distance(pos, track->segments[i].center);
+    if (dist < *best_dist || (dist == *best_dist && i < *best)) {
+        *best_dist = dist;
+        *best = i;
+    }
+}
+
+static int find_segment_linear(track_t *track, vec3_t pos) {
     float min_dist = 1e10f;
     int closest = -1;
 
     for (int i = 0; i < track->segment_count; i++) {
-        track_segment_t *seg = &track->segments[i];
-        vec3_t center = vec3_lerp(seg->start_pos, seg->end_pos, 0.5f);
-        float dist = vec3_distance(pos, center);
+        consider_segment(track, i, pos, &closest, &min_dist);
+    }
 
-        if (dist < min_dist) {
-            min_dist = dist;
-            closest = i;
+    return closest;
+}
+
+/* Slack on grid distance bounds so rounding never skips a closer cell */
+#define GRID_BOUND_EPSILON 0.01f
+
+/* Expanding ring search from the cell containing pos */
+static int find_segment_grid(track_t *track, vec3_t pos, int best, float best_dist) {
+    track_grid_t *grid = &track->grid;
+    float cs = grid->cell_size;
+
+    int cx = (int)((pos.x - grid->min_x) * grid->inv_cell_size);
+    int cz = (int)((pos.z - grid->min_z) * grid->inv_cell_size);
+    if (cx >= grid->cols) cx = grid->cols - 1;
+    if (cz >= grid->rows) cz = grid->rows - 1;
+
+    int max_ring = cx;
+    if (grid->cols - 1 - cx > max_ring) max_ring = grid->cols - 1 - cx;
+    if (cz > max_ring) max_ring = cz;
+    if (grid->rows - 1 - cz > max_ring) max_ring = grid->rows - 1 - cz;
+
+    for (int r = 0; r <= max_ring; r++) {
+        if (r > 0) {
+            /* Nearest point outside the already searched block */
+            float lb = 1e10f;
+            if (cx - r >= 0) {
+                float d = pos.x - (grid->min_x + (cx - r + 1) * cs);
+                if (d < lb) lb = d;
+            }
+            if (cx + r < grid->cols) {
+                float d = grid->min_x + (cx + r) * cs - pos.x;
+                if (d < lb) lb = d;
+            }
+            if (cz - r >= 0) {
+                float d = pos.z - (grid->min_z + (cz - r + 1) * cs);
+                if (d < lb) lb = d;
+            }
+            if (cz + r < grid->rows) {
+                float d = grid->min_z + (cz + r) * cs - pos.z;
+                if (d < lb) lb = d;
+            }
+            if (lb > best_dist + GRID_BOUND_EPSILON) break;
+        }
+
+        for (int z = cz - r; z <= cz + r; z++) {
+            if (z < 0 || z >= grid->rows) continue;
+
+            /* Interior rows only need the two edge cells of the ring */
+            int step = (z == cz - r || z == cz + r) ? 1 : 2 * r;
+            if (step == 0) step = 1;
+
+            for (int x = cx - r; x <= cx + r; x += step) {
+                if (x < 0 || x >= grid->cols) continue;
+
+                /* Skip cells whose box is farther than the current best */
+                float x0 = grid->min_x + x * cs;
+                float z0 = grid->min_z + z * cs;
+                float dx = (pos.x < x0) ? x0 - pos.x : (pos.x > x0 + cs ? pos.x - x0 - cs : 0);
+                float dz = (pos.z < z0) ? z0 - pos.z : (pos.z > z0 + cs ? pos.z - z0 - cs : 0);
+                float cell_dist = sqrtf(dx * dx + dz * dz);
+                if (cell_dist > best_dist + GRID_BOUND_EPSILON) continue;
+
+                int c = z * grid->cols + x;
+                for (int k = grid->cell_start[c]; k < grid->cell_start[c + 1]; k++) {
+                    consider_segment(track, grid->items[k], pos, &best, &best_dist);
+                }
+            }
         }
     }
 
-    return closest;
+    return best;
+}
+
+int track_find_segment(track_t *track, vec3_t pos) {
+    return track_find_segment_near(track, pos, -1);
+}
+
+int track_find_segment_near(track_t *track, vec3_t pos, int hint) {
+    if (!track) return -1;
+    if (track->segment_count == 0) return -1;
+
+    track_grid_t *grid = &track->grid;
+
+    /* Outside the padded grid the bounds don't hold - scan everything */
+    if (pos.x < grid->min_x || pos.x >= grid->max_x ||
+        pos.z < grid->min_z || pos.z >= grid->max_z) {
+        return find_segment_linear(track, pos);
+    }
+
+    /* Seed the search with the hint and its neighbours */
+    int best = -1;
+    float best_dist = 1e10f;
+    if (hint >= 0 && hint < track->segment_count) {
+        int n = track->segment_count;
+        consider_segment(track, hint, pos, &best, &best_dist);
+        consider_segment(track, (hint + 1) % n, pos, &best, &best_dist);
+        consider_segment(track, (hint + n - 1) % n, pos, &best, &best_dist);
+    }
+
+    return find_segment_grid(track, pos, best, best_dist);
 }
 
 int track_is_on_surface(track_t *track, vec3_t pos, float *height) {
     if (!track) return 0;
 
     int seg_idx = track_find_segment(track, pos);
+    return track_is_on_segment(track, seg_idx, pos, height);
+}
+
+int track_is_on_segment(track_t *track, int seg_idx, vec3_t pos, float *height) {
+    if (!track) return 0;
     if (seg_idx < 0) return 0;
 
     track_segment_t *seg = &track->segments[seg_idx];
@@ -345,12 +1349,11 @@ int track_check_checkpoint(track_t *track, vec3_t pos, int last_checkpoint) {
 float track_get_progress(track_t *track, vec3_t pos, int current_segment) {
     if (!track || track->segment_count == 0) return 0;
 
-    float progress = 0;
-
-    /* Sum length of completed segments */
-    for (int i = 0; i < current_segment && i < track->segment_count; i++) {
-        progress += track->segments[i].length;
-    }
+    /* Length of completed segments */
+    int completed = current_segment;
+    if (completed < 0) completed = 0;
+    if (completed > track->segment_count) completed = track->segment_count;
+    float progress = track->segment_distance[completed];
 
     /* Add partial progress in current segment */
     if (current_segment >= 0 && current_segment < track->segment_count) {
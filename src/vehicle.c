@@ -5,50 +5,90 @@
 
 #include "vehicle.h"
 #include "physics.h"
+#include "fastmath.h"
 #include <stdlib.h>
 #include <string.h>
 
-/* Vehicle class stats */
+/*
+ * Vehicle class stats: class, kernel suffix, max speed, acceleration,
+ * brake rate, steering rate, grip. Each row also becomes a pair of
+ * update kernels with its stats as constants (CLASS_KERNELS below).
+ */
+#define VEHICLE_CLASSES(X) \
+    X(VEHICLE_STANDARD, standard, 80.0f, 25.0f, 40.0f, 2.5f, 0.9f) \
+    X(VEHICLE_SPEED,    speed,    100.0f, 30.0f, 35.0f, 2.0f, 0.8f) \
+    X(VEHICLE_HANDLING, handling, 70.0f, 22.0f, 45.0f, 3.2f, 0.95f) \
+    X(VEHICLE_BALANCED, balanced, 85.0f, 27.0f, 42.0f, 2.7f, 0.88f)
+
 static const struct {
     float max_speed;
     float acceleration;
     float brake_rate;
     float steering;
     float grip;
-} vehicle_stats[] = {
-    /* VEHICLE_STANDARD */  {80.0f, 25.0f, 40.0f, 2.5f, 0.9f},
-    /* VEHICLE_SPEED */     {100.0f, 30.0f, 35.0f, 2.0f, 0.8f},
-    /* VEHICLE_HANDLING */  {70.0f, 22.0f, 45.0f, 3.2f, 0.95f},
-    /* VEHICLE_BALANCED */  {85.0f, 27.0f, 42.0f, 2.7f, 0.88f}
+} vehicle_stats[VEHICLE_CLASS_COUNT] = {
+#define CLASS_STATS(id, name, max_speed, accel, brake, steer, grip) [id] = {max_speed, accel, brake, steer, grip},
+    VEHICLE_CLASSES(CLASS_STATS)
+#undef CLASS_STATS
 };
 
+/* Kernel bodies are inlined into each class's copy so the stats fold in */
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+
 void vehicle_init(void) {
     /* Nothing to initialize */
 }
 
-vehicle_t *vehicle_create(vehicle_class_t vclass, uint32_t color, int is_player) {
+/* Refresh the heading basis after rotation_y[s] changed */
+static void update_basis(vehicle_pool_t *p, int s) {
+    float sn, cs;
+    fast_sincos(p->rotation_y[s], &sn, &cs);
+    p->forward_x[s] = sn;
+    p->forward_z[s] = cs;
+    p->right_x[s] = -cs;
+    p->right_z[s] = sn;
+}
+
+void vehicle_pool_init(vehicle_pool_t *pool) {
+    memset(pool, 0, sizeof(vehicle_pool_t));
+}
+
+vehicle_t *vehicle_create(vehicle_pool_t *pool, vehicle_class_t vclass, uint32_t color, int is_player) {
+    if (pool->count >= MAX_VEHICLES) return NULL;
+
     vehicle_t *v = (vehicle_t *)malloc(sizeof(vehicle_t));
     memset(v, 0, sizeof(vehicle_t));
 
+    int s = pool->count++;
+    v->pool = pool;
+    v->slot = s;
+    pool->owner[s] = v;
+    update_basis(pool, s);
+
     v->vehicle_class = vclass;
     v->color = color;
     v->is_player = is_player;
-
-    /* Set stats from class */
-    v->max_speed = vehicle_stats[vclass].max_speed;
-    v->acceleration_rate = vehicle_stats[vclass].acceleration;
-    v->brake_rate = vehicle_stats[vclass].brake_rate;
-    v->steering_rate = vehicle_stats[vclass].steering;
-    v->grip = vehicle_stats[vclass].grip;
+    pool->class_slots[vclass][pool->class_count[vclass]++] = (uint8_t)s;
     v->drag = 0.01f;
 
     /* Create mesh */
     v->mesh = mesh_create_vehicle(color);
+    v->impostor = mesh_create_vehicle_impostor(color);
+
+    /* Bounding sphere around the model origin */
+    v->bound_radius = 0;
+    for (int i = 0; i < v->mesh->tri_count; i++) {
+        for (int k = 0; k < 3; k++) {
+            float d = vec3_length(v->mesh->triangles[i].v[k].pos);
+            if (d > v->bound_radius) v->bound_radius = d;
+        }
+    }
 
     /* Initialize race state */
     v->current_lap = 0;
     v->total_laps = 3;
     v->current_checkpoint = 0;
+    v->current_segment = -1;
     v->best_lap_time = 999999.0f;
 
     return v;
@@ -56,196 +96,416 @@ vehicle_t *vehicle_create(vehicle_class_t vclass, uint32_t color, int is_player)
 
 void vehicle_destroy(vehicle_t *vehicle) {
     if (vehicle) {
+        vehicle->pool->owner[vehicle->slot] = NULL;
         mesh_destroy(vehicle->mesh);
+        mesh_destroy(vehicle->impostor);
         free(vehicle);
     }
 }
 
 vec3_t vehicle_get_forward(vehicle_t *vehicle) {
-    float angle = vehicle->rotation_y;
-    return vec3_create(sinf(angle), 0, cosf(angle));
+    vehicle_pool_t *p = vehicle->pool;
+    int s = vehicle->slot;
+    return vec3_create(p->forward_x[s], 0, p->forward_z[s]);
+}
+
+vec3_t vehicle_get_right(vehicle_t *vehicle) {
+    vehicle_pool_t *p = vehicle->pool;
+    int s = vehicle->slot;
+    return vec3_create(p->right_x[s], 0, p->right_z[s]);
+}
+
+vec3_t vehicle_get_position(vehicle_t *vehicle) {
+    vehicle_pool_t *p = vehicle->pool;
+    int s = vehicle->slot;
+    return vec3_create(p->pos_x[s], p->pos_y[s], p->pos_z[s]);
+}
+
+void vehicle_set_position(vehicle_t *vehicle, vec3_t pos) {
+    vehicle_pool_t *p = vehicle->pool;
+    int s = vehicle->slot;
+    p->pos_x[s] = pos.x;
+    p->pos_y[s] = pos.y;
+    p->pos_z[s] = pos.z;
+}
+
+vec3_t vehicle_get_velocity(vehicle_t *vehicle) {
+    vehicle_pool_t *p = vehicle->pool;
+    int s = vehicle->slot;
+    return vec3_create(p->vel_x[s], p->vel_y[s], p->vel_z[s]);
+}
+
+void vehicle_set_velocity(vehicle_t *vehicle, vec3_t vel) {
+    vehicle_pool_t *p = vehicle->pool;
+    int s = vehicle->slot;
+    p->vel_x[s] = vel.x;
+    p->vel_y[s] = vel.y;
+    p->vel_z[s] = vel.z;
+}
+
+float vehicle_get_rotation(vehicle_t *vehicle) {
+    return vehicle->pool->rotation_y[vehicle->slot];
+}
+
+float vehicle_get_speed(vehicle_t *vehicle) {
+    return vehicle->pool->speed[vehicle->slot];
+}
+
+float vehicle_get_steering(vehicle_t *vehicle) {
+    return vehicle->pool->steering[vehicle->slot];
+}
+
+float vehicle_get_max_speed(vehicle_t *vehicle) {
+    return vehicle_stats[vehicle->vehicle_class].max_speed;
+}
+
+int vehicle_is_on_track(vehicle_t *vehicle) {
+    return vehicle->pool->is_on_track[vehicle->slot];
 }
 
 void vehicle_set_throttle(vehicle_t *vehicle, float throttle) {
-    vehicle->throttle = clamp(throttle, 0.0f, 1.0f);
+    vehicle->pool->throttle[vehicle->slot] = clamp(throttle, 0.0f, 1.0f);
 }
 
 void vehicle_set_brake(vehicle_t *vehicle, float brake) {
-    vehicle->brake = clamp(brake, 0.0f, 1.0f);
+    vehicle->pool->brake[vehicle->slot] = clamp(brake, 0.0f, 1.0f);
 }
 
 void vehicle_set_steering(vehicle_t *vehicle, float steering) {
-    vehicle->steering = clamp(steering, -1.0f, 1.0f);
+    vehicle->pool->steering[vehicle->slot] = clamp(steering, -1.0f, 1.0f);
 }
 
 void vehicle_reset(vehicle_t *vehicle, vec3_t pos, float rotation) {
-    vehicle->position = pos;
-    vehicle->velocity = vec3_create(0, 0, 0);
-    vehicle->acceleration = vec3_create(0, 0, 0);
-    vehicle->rotation_y = rotation;
+    vehicle_pool_t *p = vehicle->pool;
+    int s = vehicle->slot;
+
+    vehicle_set_position(vehicle, pos);
+    vehicle_set_velocity(vehicle, vec3_create(0, 0, 0));
+    p->rotation_y[s] = rotation;
+    update_basis(p, s);
     vehicle->rotation_x = 0;
     vehicle->rotation_z = 0;
-    vehicle->speed = 0;
-    vehicle->throttle = 0;
-    vehicle->brake = 0;
-    vehicle->steering = 0;
-    vehicle->is_on_track = 1;
-    vehicle->is_airborne = 0;
+    p->speed[s] = 0;
+    p->throttle[s] = 0;
+    p->brake[s] = 0;
+    p->steering[s] = 0;
+    p->is_on_track[s] = 1;
+    p->is_airborne[s] = 0;
     vehicle->current_checkpoint = 0;
+    vehicle->current_segment = -1;
 }
 
-void vehicle_update(vehicle_t *vehicle, track_t *track, float dt) {
-    vec3_t forward = vehicle_get_forward(vehicle);
-    vec3_t right = vec3_cross(forward, vec3_create(0, 1, 0));
-
-    /* Check if on track */
-    float ground_height = 0;
-    vehicle->is_on_track = track_is_on_surface(track, vehicle->position, &ground_height);
+/*
+ * The integration is split into passes over the pool. Passes marked
+ * vectorizable are straight-line per slot: every branch of the original
+ * per-car update is computed as a select, so the compiler can map them
+ * to SIMD lanes (or paired FPU ops on SH-4). Track lookups and sin/cos
+ * stay in scalar passes.
+ *
+ * The vector passes without class stats always run all MAX_VEHICLES
+ * slots so the trip count is a compile-time constant. Unused slots are
+ * zeroed by vehicle_pool_init() and stay finite; nothing reads them back.
+ * Passes that use class stats run once per class over its slots, with
+ * the stats as constants.
+ */
 
-    /* Apply gravity */
-    if (vehicle->position.y > ground_height + 0.1f) {
-        vehicle->velocity.y -= GRAVITY * dt;
-        vehicle->is_airborne = 1;
-    } else {
-        vehicle->position.y = ground_height;
-        vehicle->velocity.y = 0;
-        vehicle->is_airborne = 0;
+/* Scalar: surface contact from the track */
+static void update_contact(vehicle_pool_t *p, track_t *track) {
+    for (int s = 0; s < p->count; s++) {
+        vehicle_t *v = p->owner[s];
+        vec3_t pos = vec3_create(p->pos_x[s], p->pos_y[s], p->pos_z[s]);
+        float ground_height = 0;
+        v->current_segment = track_find_segment_near(track, pos, v->current_segment);
+        p->is_on_track[s] = track_is_on_segment(track, v->current_segment, pos, &ground_height);
+        p->ground_height[s] = ground_height;
     }
+}
 
-    /* Calculate speed */
-    vehicle->speed = vec3_length(vec3_create(vehicle->velocity.x, 0, vehicle->velocity.z));
+/* Vectorizable: gravity, ground snap and planar speed */
+static void update_gravity(vehicle_pool_t *restrict p, float dt) {
+    for (int s = 0; s < MAX_VEHICLES; s++) {
+        float y = p->pos_y[s];
+        float vy = p->vel_y[s];
+        float ground = p->ground_height[s];
+        int airborne = y > ground + 0.1f;
+        p->vel_y[s] = airborne ? vy - GRAVITY * dt : 0.0f;
+        p->pos_y[s] = airborne ? y : ground;
+        p->is_airborne[s] = airborne;
+        p->speed[s] = sqrtf(p->vel_x[s] * p->vel_x[s] + p->vel_z[s] * p->vel_z[s]);
+    }
+}
 
-    /* Apply steering (only when moving) */
-    if (vehicle->speed > 1.0f && !vehicle->is_airborne) {
-        float steer_amount = vehicle->steering * vehicle->steering_rate * dt;
+/* Scalar: apply steering to heading (only when moving and grounded).
+ * The heading is a select, only the basis refresh is skipped. */
+KERNEL_INLINE void heading_kernel(vehicle_pool_t *p, const uint8_t *slots, int n, float dt,
+                                  float steering_rate, float max_speed) {
+    for (int k = 0; k < n; k++) {
+        int s = slots[k];
+        float speed = p->speed[s];
+        float steer_amount = p->steering[s] * steering_rate * dt;
 
         /* Reduce steering at high speed */
-        float speed_factor = 1.0f - (vehicle->speed / vehicle->max_speed) * 0.5f;
+        float speed_factor = 1.0f - (speed / max_speed) * 0.5f;
         steer_amount *= speed_factor;
 
-        vehicle->rotation_y += steer_amount;
-
-        /* Update velocity direction based on grip */
-        vec3_t desired_dir = vehicle_get_forward(vehicle);
-        vec3_t current_dir = vec3_normalize(vec3_create(vehicle->velocity.x, 0, vehicle->velocity.z));
-
-        vec3_t blended = vec3_lerp(current_dir, desired_dir, vehicle->grip);
-        blended = vec3_normalize(blended);
-
-        vehicle->velocity.x = blended.x * vehicle->speed;
-        vehicle->velocity.z = blended.z * vehicle->speed;
+        int turn = (speed > 1.0f) & !p->is_airborne[s] & (steer_amount != 0.0f);
+        float rotation = p->rotation_y[s];
+        p->rotation_y[s] = turn ? rotation + steer_amount : rotation;
+        if (turn) update_basis(p, s);
     }
+}
 
-    /* Apply throttle */
-    if (vehicle->throttle > 0 && !vehicle->is_airborne) {
-        float accel = vehicle->acceleration_rate * vehicle->throttle;
+/* Vectorizable: grip blend, throttle, brakes, drag and position */
+KERNEL_INLINE void motion_kernel(vehicle_pool_t *restrict p, const uint8_t *slots, int n, float dt,
+                                 float max_speed, float acceleration, float brake_rate, float grip) {
+    for (int k = 0; k < n; k++) {
+        int s = slots[k];
+        float vx = p->vel_x[s];
+        float vy = p->vel_y[s];
+        float vz = p->vel_z[s];
+        float speed = p->speed[s];
+        float fx = p->forward_x[s];
+        float fz = p->forward_z[s];
+        float throttle = p->throttle[s];
+        float brake = p->brake[s];
+        int grounded = !p->is_airborne[s];
+        int on_track = p->is_on_track[s];
+
+        /* Blend velocity direction toward heading based on grip */
+        int steer = (speed > 1.0f) & grounded;
+        float inv_speed = 1.0f / (steer ? speed : 1.0f);
+        float cx = vx * inv_speed;
+        float cz = vz * inv_speed;
+        float bx = cx + (fx - cx) * grip;
+        float bz = cz + (fz - cz) * grip;
+        float blen = sqrtf(bx * bx + bz * bz);
+        int blen_ok = blen > 0.0001f;
+        float inv_blen = 1.0f / (blen_ok ? blen : 1.0f);
+        float nx = blen_ok ? bx * inv_blen : 0.0f;
+        float nz = blen_ok ? bz * inv_blen : 0.0f;
+        vx = steer ? nx * speed : vx;
+        vz = steer ? nz * speed : vz;
+
+        /* Throttle, halved off track, limited to max speed */
+        float accel = acceleration * throttle;
+        accel = on_track ? accel : accel * 0.5f;
+        int push = (throttle > 0) & grounded & (speed < max_speed);
+        float ax = vx + fx * (accel * dt);
+        float az = vz + fz * (accel * dt);
+        vx = push ? ax : vx;
+        vz = push ? az : vz;
+
+        /* Brakes reduce speed along the current direction */
+        int braking = (brake > 0) & grounded;
+        float braked = speed - brake_rate * brake * dt;
+        braked = braked < 0 ? 0.0f : braked;
+        float len = sqrtf(vx * vx + vz * vz);
+        int len_ok = len > 0.0001f;
+        float inv_len = 1.0f / (len_ok ? len : 1.0f);
+        int moving = braked > 0.1f;
+        float dx = len_ok ? vx * inv_len : 0.0f;
+        float dz = len_ok ? vz * inv_len : 0.0f;
+        float bvx = moving ? dx * braked : 0.0f;
+        float bvz = moving ? dz * braked : 0.0f;
+        vx = braking ? bvx : vx;
+        vz = braking ? bvz : vz;
+        p->speed[s] = braking ? braked : speed;
+
+        /* Drag */
+        float drag_factor = on_track ? 0.99f : 0.95f;
+        vx *= drag_factor;
+        vy *= drag_factor;
+        vz *= drag_factor;
+
+        /* Position */
+        p->pos_x[s] += vx * dt;
+        p->pos_y[s] += vy * dt;
+        p->pos_z[s] += vz * dt;
+        p->vel_x[s] = vx;
+        p->vel_y[s] = vy;
+        p->vel_z[s] = vz;
+    }
+}
 
-        /* Reduce acceleration when off track */
-        if (!vehicle->is_on_track) {
-            accel *= 0.5f;
-        }
+/* One heading and one motion kernel per class */
+typedef void (*class_kernel_t)(vehicle_pool_t *p, const uint8_t *slots, int n, float dt);
 
-        /* Limit to max speed */
-        if (vehicle->speed < vehicle->max_speed) {
-            forward = vehicle_get_forward(vehicle);
-            vehicle->velocity = vec3_add(vehicle->velocity, vec3_scale(forward, accel * dt));
-        }
+#define CLASS_KERNELS(id, name, max_speed, accel, brake, steer, grip) \
+    static void update_heading_##name(vehicle_pool_t *p, const uint8_t *slots, int n, float dt) { \
+        heading_kernel(p, slots, n, dt, steer, max_speed); \
+    } \
+    static void update_motion_##name(vehicle_pool_t *p, const uint8_t *slots, int n, float dt) { \
+        motion_kernel(p, slots, n, dt, max_speed, accel, brake, grip); \
     }
+VEHICLE_CLASSES(CLASS_KERNELS)
+#undef CLASS_KERNELS
+
+static const struct {
+    class_kernel_t heading;
+    class_kernel_t motion;
+} class_kernels[VEHICLE_CLASS_COUNT] = {
+#define CLASS_KERNEL_ENTRY(id, name, ...) [id] = {update_heading_##name, update_motion_##name},
+    VEHICLE_CLASSES(CLASS_KERNEL_ENTRY)
+#undef CLASS_KERNEL_ENTRY
+};
 
-    /* Apply brakes */
-    if (vehicle->brake > 0 && !vehicle->is_airborne) {
-        float brake_force = vehicle->brake_rate * vehicle->brake * dt;
-        vehicle->speed -= brake_force;
-        if (vehicle->speed < 0) vehicle->speed = 0;
-
-        /* Update velocity magnitude */
-        if (vehicle->speed > 0.1f) {
-            vec3_t dir = vec3_normalize(vec3_create(vehicle->velocity.x, 0, vehicle->velocity.z));
-            vehicle->velocity.x = dir.x * vehicle->speed;
-            vehicle->velocity.z = dir.z * vehicle->speed;
-        } else {
-            vehicle->velocity.x = 0;
-            vehicle->velocity.z = 0;
+/* Scalar: checkpoints, laps, timing and progress */
+static void update_race_state(vehicle_pool_t *p, track_t *track, float dt) {
+    for (int s = 0; s < p->count; s++) {
+        vehicle_t *vehicle = p->owner[s];
+        vec3_t pos = vec3_create(p->pos_x[s], p->pos_y[s], p->pos_z[s]);
+
+        /* Update checkpoint */
+        int new_cp = track_check_checkpoint(track, pos, vehicle->current_checkpoint);
+        if (new_cp != vehicle->current_checkpoint) {
+            vehicle->current_checkpoint = new_cp;
+
+            /* Check for lap completion */
+            if (new_cp == 0 && vehicle->current_checkpoint == 0) {
+                /* Completed a lap */
+                if (vehicle->current_lap < VEHICLE_MAX_LAPS) {
+                    vehicle->lap_times[vehicle->current_lap] = vehicle->lap_time;
+                }
+                vehicle->current_lap++;
+
+                /* Update best lap time */
+                if (vehicle->lap_time < vehicle->best_lap_time && vehicle->lap_time > 1.0f) {
+                    vehicle->best_lap_time = vehicle->lap_time;
+                }
+
+                vehicle->lap_time = 0;
+            }
         }
-    }
 
-    /* Apply drag */
-    float drag_factor = vehicle->is_on_track ? 0.99f : 0.95f;
-    vehicle->velocity = vec3_scale(vehicle->velocity, drag_factor);
+        /* Update timing */
+        vehicle->lap_time += dt;
+        vehicle->total_time += dt;
+        vehicle->off_track_time += p->is_on_track[s] ? 0.0f : dt;
 
-    /* Update position */
-    vehicle->position = vec3_add(vehicle->position, vec3_scale(vehicle->velocity, dt));
+        /* Calculate track progress */
+        vehicle->current_segment = track_find_segment_near(track, pos, vehicle->current_segment);
+        vehicle->track_progress = track_get_progress(track, pos, vehicle->current_segment);
 
-    /* Update checkpoint */
-    int new_cp = track_check_checkpoint(track, vehicle->position, vehicle->current_checkpoint);
-    if (new_cp != vehicle->current_checkpoint) {
-        vehicle->current_checkpoint = new_cp;
+        /* Check if finished */
+        if (vehicle->current_lap >= vehicle->total_laps && !vehicle->finished) {
+            vehicle->finished = 1;
+            vehicle->finish_time = vehicle->total_time;
+        }
 
-        /* Check for lap completion */
-        if (new_cp == 0 && vehicle->current_checkpoint == 0) {
-            /* Completed a lap */
-            vehicle->current_lap++;
+        /* Tilt based on steering */
+        vehicle->rotation_z = -p->steering[s] * 0.1f;
+    }
+}
 
-            /* Update best lap time */
-            if (vehicle->lap_time < vehicle->best_lap_time && vehicle->lap_time > 1.0f) {
-                vehicle->best_lap_time = vehicle->lap_time;
-            }
+void vehicle_update_all(vehicle_pool_t *pool, track_t *track, float dt) {
+    update_contact(pool, track);
+    update_gravity(pool, dt);
 
-            vehicle->lap_time = 0;
-        }
+    /* Cars only read their own slot, so classes can go one after another */
+    for (int c = 0; c < VEHICLE_CLASS_COUNT; c++) {
+        int n = pool->class_count[c];
+        if (n == 0) continue;
+        class_kernels[c].heading(pool, pool->class_slots[c], n, dt);
+        class_kernels[c].motion(pool, pool->class_slots[c], n, dt);
     }
 
-    /* Update timing */
-    vehicle->lap_time += dt;
-    vehicle->total_time += dt;
+    update_race_state(pool, track, dt);
+}
 
-    /* Calculate track progress */
-    int seg = track_find_segment(track, vehicle->position);
-    vehicle->track_progress = track_get_progress(track, vehicle->position, seg);
+void vehicle_get_pose(vehicle_t *vehicle, vehicle_pose_t *pose) {
+    pose->position = vehicle_get_position(vehicle);
+    pose->forward_x = vehicle->pool->forward_x[vehicle->slot];
+    pose->forward_z = vehicle->pool->forward_z[vehicle->slot];
+    pose->rotation_x = vehicle->rotation_x;
+    pose->rotation_z = vehicle->rotation_z;
+}
 
-    /* Check if finished */
-    if (vehicle->current_lap >= vehicle->total_laps) {
-        vehicle->finished = 1;
+void vehicle_pose_lerp(const vehicle_pose_t *a, const vehicle_pose_t *b, float t, vehicle_pose_t *out) {
+    out->position = vec3_lerp(a->position, b->position, t);
+    out->rotation_x = a->rotation_x + (b->rotation_x - a->rotation_x) * t;
+    out->rotation_z = a->rotation_z + (b->rotation_z - a->rotation_z) * t;
+
+    /* Blend the heading vectors, a tick turns far less than half a circle */
+    float fx = a->forward_x + (b->forward_x - a->forward_x) * t;
+    float fz = a->forward_z + (b->forward_z - a->forward_z) * t;
+    float len_sq = fx * fx + fz * fz;
+    if (len_sq > 1e-6f) {
+        float inv = 1.0f / sqrtf(len_sq);
+        out->forward_x = fx * inv;
+        out->forward_z = fz * inv;
+    } else {
+        out->forward_x = b->forward_x;
+        out->forward_z = b->forward_z;
     }
-
-    /* Tilt based on steering */
-    vehicle->rotation_z = -vehicle->steering * 0.1f;
 }
 
 void vehicle_render(vehicle_t *vehicle, camera_t *cam) {
-    if (!vehicle || !vehicle->mesh) return;
+    if (!vehicle) return;
 
-    render_set_camera(cam);
+    vehicle_pose_t pose;
+    vehicle_get_pose(vehicle, &pose);
+    vehicle_render_pose(vehicle, &pose, cam);
+}
 
-    /* Build transform matrix */
-    mat4_t transform = mat4_identity();
+void vehicle_render_pose(vehicle_t *vehicle, const vehicle_pose_t *pose, camera_t *cam) {
+    if (!vehicle || !vehicle->mesh) return;
 
-    /* Position */
-    mat4_t trans = mat4_translate(
-        vehicle->position.x,
-        vehicle->position.y + 0.3f,  /* Offset to sit on ground */
-        vehicle->position.z
-    );
+    render_set_camera(cam);
 
-    /* Rotation */
-    mat4_t rot_y = mat4_rotate_y(vehicle->rotation_y);
-    mat4_t rot_x = mat4_rotate_x(vehicle->rotation_x);
-    mat4_t rot_z = mat4_rotate_z(vehicle->rotation_z);
+    /* Offset to sit on ground */
+    vec3_t origin = pose->position;
+    origin.y += 0.3f;
+
+    /* Skip cars outside the view before building any matrices */
+    render_cull_stats_t *stats = render_get_cull_stats();
+    stats->vehicles_total++;
+    if (!render_sphere_visible(origin, vehicle->bound_radius)) return;
+    stats->vehicles_visible++;
+
+    /* Far away under a tight vertex budget, one quad turned to the camera
+     * as wide as the body looks from there */
+    float to_cam_x = cam->position.x - origin.x;
+    float to_cam_z = cam->position.z - origin.z;
+    float dist_sq = to_cam_x * to_cam_x + to_cam_z * to_cam_z;
+    float impostor_distance = render_get_lod()->impostor_distance;
+    if (vehicle->impostor && dist_sq > impostor_distance * impostor_distance) {
+        float inv = 1.0f / sqrtf(dist_sq);
+        to_cam_x *= inv;
+        to_cam_z *= inv;
+        float along = fabsf(to_cam_x * pose->forward_x + to_cam_z * pose->forward_z);
+        float side = 1.0f - along * along;
+        float width = along * VEHICLE_MESH_WIDTH + sqrtf(side > 0 ? side : 0) * VEHICLE_MESH_LENGTH;
+
+        mat4_t transform;
+        mat4_translate_into(&transform, origin.x, origin.y, origin.z);
+        mat4_rotate_y_by_sincos(&transform, to_cam_x, to_cam_z);
+        transform = mat4_multiply(transform, mat4_scale(width, 1.0f, 1.0f));
+        render_draw_mesh(vehicle->impostor, &transform);
+        return;
+    }
 
-    mat4_t rotation = mat4_multiply(rot_y, mat4_multiply(rot_x, rot_z));
-    transform = mat4_multiply(trans, rotation);
+    /* Build transform in place: translate * rot_y * rot_x * rot_z */
+    mat4_t transform;
+    mat4_translate_into(&transform, origin.x, origin.y, origin.z);
+    mat4_rotate_y_by_sincos(&transform, pose->forward_x, pose->forward_z);
+    mat4_rotate_x_by(&transform, pose->rotation_x);
+    mat4_rotate_z_by(&transform, pose->rotation_z);
 
-    render_draw_mesh(vehicle->mesh, transform);
+    render_draw_mesh(vehicle->mesh, &transform);
 }
 
 int vehicle_check_collision(vehicle_t *a, vehicle_t *b) {
-    float dist = vec3_distance(a->position, b->position);
+    float dist = vec3_distance(vehicle_get_position(a), vehicle_get_position(b));
     float collision_radius = 2.0f;  /* Vehicle radius */
     return dist < collision_radius * 2;
 }
 
 void vehicle_resolve_collision(vehicle_t *a, vehicle_t *b) {
-    vec3_t delta = vec3_sub(a->position, b->position);
+    vec3_t pos_a = vehicle_get_position(a);
+    vec3_t pos_b = vehicle_get_position(b);
+    vec3_t vel_a = vehicle_get_velocity(a);
+    vec3_t vel_b = vehicle_get_velocity(b);
+    vec3_t delta = vec3_sub(pos_a, pos_b);
     float dist = vec3_length(delta);
 
     if (dist < 0.001f) {
@@ -258,18 +518,18 @@ void vehicle_resolve_collision(vehicle_t *a, vehicle_t *b) {
     /* Separate vehicles */
     float overlap = 4.0f - dist;  /* 2 * collision radius */
     if (overlap > 0) {
-        a->position = vec3_add(a->position, vec3_scale(normal, overlap * 0.5f));
-        b->position = vec3_sub(b->position, vec3_scale(normal, overlap * 0.5f));
+        vehicle_set_position(a, vec3_add(pos_a, vec3_scale(normal, overlap * 0.5f)));
+        vehicle_set_position(b, vec3_sub(pos_b, vec3_scale(normal, overlap * 0.5f)));
     }
 
     /* Exchange momentum */
-    vec3_t rel_vel = vec3_sub(a->velocity, b->velocity);
+    vec3_t rel_vel = vec3_sub(vel_a, vel_b);
     float vel_along_normal = vec3_dot(rel_vel, normal);
 
     if (vel_along_normal < 0) {
         vec3_t impulse = vec3_scale(normal, vel_along_normal * 0.5f);
-        a->velocity = vec3_sub(a->velocity, impulse);
-        b->velocity = vec3_add(b->velocity, impulse);
+        vehicle_set_velocity(a, vec3_sub(vel_a, impulse));
+        vehicle_set_velocity(b, vec3_add(vel_b, impulse));
     }
 }
 
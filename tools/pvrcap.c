@@ -0,0 +1,452 @@
+/*
+ * RetroRacer - PVR Capture Analyzer
+ * Reads a frame captured by src/pvrcap.c and reports what the PVR was
+ * given: polygons and strips per list, near-plane clipped triangles,
+ * tile bin load and overdraw. Optionally rasterizes a preview.
+ *
+ * Build with "make -f Makefile.native pvrcap", then
+ *   ./retroracer_pvrcap FILE [--ppm OUT] [--tiles]
+ *
+ * The preview is a plain software rasterizer, not a PVR emulator: the
+ * opaque list is depth tested GREATER on 1/w like the renderer's header,
+ * the translucent list is blended in submission order against the
+ * opaque depth (the PVR sorts it per pixel), and glyphs, whose texture
+ * isn't captured, are drawn as faint boxes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pvrcap.h"
+#include "render.h"
+
+/* PVR tiles are 32x32 pixels */
+#define TILE_SIZE 32
+#define MAX_WIDTH 1024
+#define MAX_HEIGHT 1024
+#define MAX_TILES ((MAX_WIDTH / TILE_SIZE) * (MAX_HEIGHT / TILE_SIZE))
+
+/* Strip length histogram buckets, by vertex count */
+#define STRIP_BUCKETS 5
+static const char *strip_bucket_names[STRIP_BUCKETS] = {"3", "4", "5-8", "9-16", "17+"};
+
+/* Glyph boxes get this share of the glyph colour's alpha */
+#define GLYPH_ALPHA_SCALE 0.25f
+
+/* Tiles listed in the report, by bin count */
+#define REPORT_TILES 5
+
+typedef struct {
+    float x, y, z;
+    uint32_t argb;
+    int flags;
+} cap_vertex_t;
+
+typedef struct {
+    int headers;
+    int strips;
+    int vertices;
+    int triangles;
+    int clipped;            /* With a vertex from the near plane clip */
+    int offscreen;          /* Bounding box entirely off screen */
+    int degenerate;         /* No area */
+    int strip_hist[STRIP_BUCKETS];
+    int longest_strip;
+    double fragments;       /* Pixel centres covered */
+} list_stats_t;
+
+static int width, height;
+static int tiles_x, tiles_y;
+static list_stats_t stats[RENDER_LIST_COUNT];
+static int tile_bins[RENDER_LIST_COUNT][MAX_TILES];       /* Triangles binned per tile */
+static double tile_frags[RENDER_LIST_COUNT][MAX_TILES];   /* Fragments per tile */
+
+/* Preview */
+static int preview = 0;
+static float *depth;
+static float *color;        /* RGB, 0-1 */
+
+static uint32_t get_u16(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return get_u16(p) | (get_u16(p + 2) << 16);
+}
+
+static float get_f32(const uint8_t *p) {
+    uint32_t v = get_u32(p);
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+static float minf(float a, float b, float c) {
+    float m = a < b ? a : b;
+    return m < c ? m : c;
+}
+
+static float maxf(float a, float b, float c) {
+    float m = a > b ? a : b;
+    return m > c ? m : c;
+}
+
+static int clampi(int v, int lo, int hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static int strip_bucket(int n) {
+    if (n <= 3) return 0;
+    if (n == 4) return 1;
+    if (n <= 8) return 2;
+    if (n <= 16) return 3;
+    return 4;
+}
+
+/* Fill the preview and count fragments of one triangle */
+static void raster_triangle(int list, int header, const cap_vertex_t *a, const cap_vertex_t *b,
+                            const cap_vertex_t *c, float area) {
+    int x0 = clampi((int)minf(a->x, b->x, c->x), 0, width - 1);
+    int x1 = clampi((int)maxf(a->x, b->x, c->x), 0, width - 1);
+    int y0 = clampi((int)minf(a->y, b->y, c->y), 0, height - 1);
+    int y1 = clampi((int)maxf(a->y, b->y, c->y), 0, height - 1);
+    float inv_area = 1.0f / area;
+
+    for (int y = y0; y <= y1; y++) {
+        float py = y + 0.5f;
+        for (int x = x0; x <= x1; x++) {
+            float px = x + 0.5f;
+
+            /* Barycentrics, signed like area so either winding fills */
+            float w0 = ((b->x - px) * (c->y - py) - (b->y - py) * (c->x - px)) * inv_area;
+            float w1 = ((c->x - px) * (a->y - py) - (c->y - py) * (a->x - px)) * inv_area;
+            float w2 = 1.0f - w0 - w1;
+            if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+
+            stats[list].fragments += 1.0;
+            tile_frags[list][(y / TILE_SIZE) * tiles_x + x / TILE_SIZE] += 1.0;
+            if (!preview) continue;
+
+            /* 1/w interpolates linearly in screen space */
+            float z = w0 * a->z + w1 * b->z + w2 * c->z;
+            float *d = &depth[y * width + x];
+            if (list == RENDER_LIST_OPAQUE ? z <= *d : z < *d) continue;
+
+            float rgba[4];
+            for (int k = 0; k < 4; k++) {
+                int shift = k == 3 ? 24 : 16 - k * 8;
+                rgba[k] = (w0 * ((a->argb >> shift) & 0xFF) +
+                           w1 * ((b->argb >> shift) & 0xFF) +
+                           w2 * ((c->argb >> shift) & 0xFF)) / 255.0f;
+            }
+
+            float *out = &color[(y * width + x) * 3];
+            if (list == RENDER_LIST_OPAQUE) {
+                *d = z;
+                out[0] = rgba[0]; out[1] = rgba[1]; out[2] = rgba[2];
+            } else {
+                float alpha = rgba[3];
+                if (header == PVRCAP_HDR_FONT) alpha *= GLYPH_ALPHA_SCALE;
+                for (int k = 0; k < 3; k++) {
+                    out[k] += (rgba[k] - out[k]) * alpha;
+                }
+            }
+        }
+    }
+}
+
+/* One triangle of a strip */
+static void add_triangle(int list, int header, const cap_vertex_t *a, const cap_vertex_t *b,
+                         const cap_vertex_t *c) {
+    list_stats_t *s = &stats[list];
+    s->triangles++;
+    if ((a->flags | b->flags | c->flags) & PVRCAP_VERTEX_CLIPPED) s->clipped++;
+
+    float bx0 = minf(a->x, b->x, c->x), bx1 = maxf(a->x, b->x, c->x);
+    float by0 = minf(a->y, b->y, c->y), by1 = maxf(a->y, b->y, c->y);
+    if (bx1 < 0 || by1 < 0 || bx0 >= width || by0 >= height) {
+        s->offscreen++;
+        return;
+    }
+
+    float area = (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+    if (area == 0.0f) {
+        s->degenerate++;
+        return;
+    }
+
+    /* The PVR bins by bounding box, so do the same */
+    int tx0 = clampi((int)bx0 / TILE_SIZE, 0, tiles_x - 1);
+    int tx1 = clampi((int)bx1 / TILE_SIZE, 0, tiles_x - 1);
+    int ty0 = clampi((int)by0 / TILE_SIZE, 0, tiles_y - 1);
+    int ty1 = clampi((int)by1 / TILE_SIZE, 0, tiles_y - 1);
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            tile_bins[list][ty * tiles_x + tx]++;
+        }
+    }
+
+    raster_triangle(list, header, a, b, c, area);
+}
+
+/* Walk the records. Returns 0 on a malformed stream. */
+static int parse(const uint8_t *p, const uint8_t *end, uint32_t *background) {
+    int list = -1;
+    int header = PVRCAP_HDR_OPAQUE;
+    cap_vertex_t strip[2];
+    int strip_len = 0;
+
+    while (p < end) {
+        int tag = *p & PVRCAP_TAG_MASK;
+        int flags = *p & ~PVRCAP_TAG_MASK;
+        p++;
+
+        switch (tag) {
+            case PVRCAP_BACKGROUND:
+                if (end - p < 4) return 0;
+                *background = get_u32(p);
+                p += 4;
+                if (preview) {
+                    for (int i = 0; i < width * height; i++) {
+                        color[i * 3 + 0] = ((*background >> 16) & 0xFF) / 255.0f;
+                        color[i * 3 + 1] = ((*background >> 8) & 0xFF) / 255.0f;
+                        color[i * 3 + 2] = (*background & 0xFF) / 255.0f;
+                    }
+                }
+                break;
+
+            case PVRCAP_LIST_BEGIN:
+                if (end - p < 1 || *p >= RENDER_LIST_COUNT) return 0;
+                list = *p++;
+                strip_len = 0;
+                break;
+
+            case PVRCAP_HEADER:
+                if (end - p < 1 || list < 0) return 0;
+                header = *p++;
+                stats[list].headers++;
+                strip_len = 0;
+                break;
+
+            case PVRCAP_VERTEX: {
+                int bytes = header == PVRCAP_HDR_FONT ? 24 : 16;
+                if (end - p < bytes || list < 0) return 0;
+
+                cap_vertex_t v;
+                v.x = get_f32(p);
+                v.y = get_f32(p + 4);
+                v.z = get_f32(p + 8);
+                v.argb = get_u32(p + 12);
+                v.flags = flags;
+                p += bytes;
+
+                list_stats_t *s = &stats[list];
+                s->vertices++;
+                if (strip_len >= 2) {
+                    /* Strips alternate winding, the rasterizer takes either */
+                    add_triangle(list, header, &strip[0], &strip[1], &v);
+                    strip[0] = strip[1];
+                    strip[1] = v;
+                } else {
+                    strip[strip_len] = v;
+                }
+                strip_len++;
+
+                if (flags & PVRCAP_VERTEX_EOL) {
+                    s->strips++;
+                    s->strip_hist[strip_bucket(strip_len)]++;
+                    if (strip_len > s->longest_strip) s->longest_strip = strip_len;
+                    strip_len = 0;
+                }
+                break;
+            }
+
+            case PVRCAP_LIST_END:
+                list = -1;
+                break;
+
+            case PVRCAP_FRAME_END:
+                return 1;
+
+            default:
+                return 0;
+        }
+    }
+    return 0;
+}
+
+static void report(FILE *out, int truncated, uint32_t background, int show_tiles) {
+    static const char *list_names[RENDER_LIST_COUNT] = {"opaque", "translucent"};
+    int pixels = width * height;
+    int total_bytes = 0;
+
+    fprintf(out, "Frame %dx%d, background %08X%s\n\n", width, height, (unsigned)background,
+            truncated ? " (TRUNCATED: capture buffer overflowed, counts are low)" : "");
+
+    fprintf(out, "%-12s %7s %7s %8s %8s %8s %8s %8s %9s\n", "list", "headers", "strips",
+            "vertices", "tris", "clipped", "offscr", "bytes", "overdraw");
+    for (int l = 0; l < RENDER_LIST_COUNT; l++) {
+        const list_stats_t *s = &stats[l];
+        int bytes = (s->vertices + s->headers) * RENDER_VERTEX_BYTES;
+        total_bytes += bytes;
+        fprintf(out, "%-12s %7d %7d %8d %8d %8d %8d %8d %8.2fx\n", list_names[l], s->headers,
+                s->strips, s->vertices, s->triangles, s->clipped, s->offscreen, bytes,
+                s->fragments / pixels);
+    }
+    fprintf(out, "vertex buffer %d of %d bytes (%.1f%%)\n\n", total_bytes, RENDER_VERTEX_BUFFER_BYTES,
+            100.0 * total_bytes / RENDER_VERTEX_BUFFER_BYTES);
+
+    for (int l = 0; l < RENDER_LIST_COUNT; l++) {
+        const list_stats_t *s = &stats[l];
+        if (s->triangles == 0) continue;
+        fprintf(out, "%s: clipped %.1f%% of triangles, %.2f triangles per strip, longest %d vertices\n",
+                list_names[l], 100.0 * s->clipped / s->triangles,
+                s->strips ? (double)s->triangles / s->strips : 0.0, s->longest_strip);
+        fprintf(out, "  strip vertices:");
+        for (int b = 0; b < STRIP_BUCKETS; b++) {
+            fprintf(out, "  %s: %d", strip_bucket_names[b], s->strip_hist[b]);
+        }
+        fprintf(out, "\n");
+    }
+
+    /* Tiles with the most work, both lists together */
+    int tiles = tiles_x * tiles_y;
+    int order[MAX_TILES];
+    for (int t = 0; t < tiles; t++) order[t] = t;
+    for (int i = 0; i < REPORT_TILES && i < tiles; i++) {
+        int best = i;
+        for (int j = i + 1; j < tiles; j++) {
+            int tj = order[j], tb = order[best];
+            if (tile_bins[0][tj] + tile_bins[1][tj] > tile_bins[0][tb] + tile_bins[1][tb]) best = j;
+        }
+        int tmp = order[i]; order[i] = order[best]; order[best] = tmp;
+    }
+
+    double tile_pixels = TILE_SIZE * TILE_SIZE;
+    fprintf(out, "\nbusiest tiles (%dx%d px):\n", TILE_SIZE, TILE_SIZE);
+    for (int i = 0; i < REPORT_TILES && i < tiles; i++) {
+        int t = order[i];
+        fprintf(out, "  tile %2d,%2d  op %4d bins %5.2fx  tr %4d bins %5.2fx\n", t % tiles_x, t / tiles_x,
+                tile_bins[0][t], tile_frags[0][t] / tile_pixels, tile_bins[1][t], tile_frags[1][t] / tile_pixels);
+    }
+
+    if (!show_tiles) return;
+    for (int l = 0; l < RENDER_LIST_COUNT; l++) {
+        fprintf(out, "\n%s overdraw per tile:\n", list_names[l]);
+        for (int ty = 0; ty < tiles_y; ty++) {
+            for (int tx = 0; tx < tiles_x; tx++) {
+                fprintf(out, "%5.1f", tile_frags[l][ty * tiles_x + tx] / tile_pixels);
+            }
+            fprintf(out, "\n");
+        }
+    }
+}
+
+static int write_ppm(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return 0;
+
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    for (int i = 0; i < width * height * 3; i++) {
+        float c = color[i];
+        c = c < 0 ? 0 : (c > 1 ? 1 : c);
+        fputc((int)(c * 255.0f + 0.5f), f);
+    }
+    return fclose(f) == 0;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: retroracer_pvrcap FILE [--ppm OUT] [--tiles]\n"
+            "  --ppm OUT   rasterize a preview of the frame\n"
+            "  --tiles     print overdraw for every tile\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *file = NULL;
+    const char *ppm = NULL;
+    int show_tiles = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+            ppm = argv[++i];
+        } else if (strcmp(argv[i], "--tiles") == 0) {
+            show_tiles = 1;
+        } else if (argv[i][0] != '-' && !file) {
+            file = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (!file) {
+        usage();
+        return 1;
+    }
+
+    FILE *f = fopen(file, "rb");
+    if (!f) {
+        fprintf(stderr, "Cannot open %s\n", file);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = size > 0 ? (uint8_t *)malloc(size) : NULL;
+    if (!data || fread(data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "Cannot read %s\n", file);
+        fclose(f);
+        free(data);
+        return 1;
+    }
+    fclose(f);
+
+    if (size < PVRCAP_FILE_HEADER_BYTES || memcmp(data, PVRCAP_MAGIC, 4) != 0 || data[4] != PVRCAP_VERSION) {
+        fprintf(stderr, "%s is not a version %d PVR capture\n", file, PVRCAP_VERSION);
+        free(data);
+        return 1;
+    }
+    int truncated = data[5] & PVRCAP_TRUNCATED;
+    width = (int)get_u16(data + 6);
+    height = (int)get_u16(data + 8);
+    uint32_t record_bytes = get_u32(data + 10);
+    if (width <= 0 || height <= 0 || width > MAX_WIDTH || height > MAX_HEIGHT ||
+        record_bytes > (uint32_t)(size - PVRCAP_FILE_HEADER_BYTES)) {
+        fprintf(stderr, "%s has a bad header\n", file);
+        free(data);
+        return 1;
+    }
+    tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    if (ppm) {
+        preview = 1;
+        depth = (float *)calloc((size_t)width * height, sizeof(float));
+        color = (float *)calloc((size_t)width * height * 3, sizeof(float));
+        if (!depth || !color) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+    uint32_t background = 0;
+    const uint8_t *records = data + PVRCAP_FILE_HEADER_BYTES;
+    if (!parse(records, records + record_bytes, &background)) {
+        fprintf(stderr, "%s: malformed record stream\n", file);
+        free(data);
+        return 1;
+    }
+    free(data);
+
+    report(stdout, truncated, background, show_tiles);
+
+    if (ppm) {
+        if (!write_ppm(ppm)) {
+            fprintf(stderr, "Cannot write %s\n", ppm);
+            return 1;
+        }
+        printf("\nPreview written to %s\n", ppm);
+    }
+    return 0;
+}